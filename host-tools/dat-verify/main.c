@@ -0,0 +1,758 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Decode every block of the wiki?.dat files of one wiki on all the cores, check the blocks, the
+// CONCAT_ARTICLE_INFO entries and wiki.idx against each other, then report the block sizes, the
+// decode times and the slowest article to open as JSON on stdout. The errors go to stderr.
+//
+// The cost of opening an article is what retrieve_article() does for a block not in the cache:
+// decode its block (or segment) from the start up to the end of the article.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stddef.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LzmaDec.h"
+#include "lz4_dec.h"
+#include "search.h"
+#include "lcd_buf_draw.h"
+
+
+static struct option opts[] = {
+	{ "help", 0, 0, 'h' },
+	{ "verbose", 0, 0, 'v' },
+	{ "data", 1, 0, 'd' },
+	{ "threads", 1, 0, 't' },
+	{ "blocks", 1, 0, 'b' },
+	{ NULL, 0, NULL, 0 }
+};
+
+#define HISTOGRAM_BUCKETS 32	// powers of two of microseconds
+
+typedef struct _MAPPED_FILE {
+	const unsigned char *p;
+	uint64_t size;
+} MAPPED_FILE;
+
+typedef struct _BLOCK {
+	uint8_t file_id;
+	uint8_t codec;		// with DAT_CODEC_SEGMENTED
+	uint16_t nSegments;
+	uint32_t offset;
+	uint32_t nArticles;
+	uint32_t compressed_len;
+	uint32_t decoded_len;	// end of the last article
+	uint64_t us;		// decoding all of it
+	uint32_t errors;
+} BLOCK;
+
+typedef struct _WORST_OPEN {
+	uint64_t us;
+	uint32_t article_id;
+	int block;
+	uint32_t read_len;	// compressed bytes of the block or segment
+	uint32_t decoded_len;	// bytes decoded up to the end of the article
+} WORST_OPEN;
+
+typedef struct _WORKER {
+	pthread_t thread;
+	unsigned char *buf;
+	uint32_t buf_size;
+	CLzmaDec dec;
+	uint64_t block_histogram[HISTOGRAM_BUCKETS];
+	uint64_t open_histogram[HISTOGRAM_BUCKETS];
+	WORST_OPEN worst;
+} WORKER;
+
+bool verbose = false;
+
+static const char *data_directory = ".";
+static MAPPED_FILE idx_file;
+static MAPPED_FILE dat_files[MAX_DAT_FILES];
+static uint32_t nArticles;
+static const ARTICLE_PTR *article_ptrs;
+static uint8_t *article_seen;		// each article number is in exactly one block
+
+static BLOCK *blocks;
+static int nBlocks;
+static int nBlocksSize;
+static int nNextBlock;
+static uint32_t nErrors;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void usage(const char *message)
+{
+	if (NULL != message)
+	{
+		fprintf(stderr, "error: %s\n", message);
+	}
+	fprintf(stderr, "usage: %s <options>\n"
+		"      --help              this message\n"
+		"      --verbose           message output\n"
+		"      --data=dir          directory of the wiki.idx and wiki?.dat files [.]\n"
+		"      --threads=n         decoding threads [number of cores]\n"
+		"      --blocks=file       CSV of every block\n",
+		"dat-verify");
+	exit(1);
+}
+
+static void *SzAlloc(void *p, size_t size) { p = p; return malloc(size); }
+static void SzFree(void *p, void *address) { p = p; free(address); }
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+
+static uint64_t time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void block_error(BLOCK *pBlock, const char *format, ...)
+{
+	va_list ap;
+
+	pthread_mutex_lock(&lock);
+	fprintf(stderr, "error: wiki%d.dat offset %u: ", pBlock->file_id, pBlock->offset);
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	nErrors++;
+	pthread_mutex_unlock(&lock);
+	pBlock->errors++;
+}
+
+static int map_file(MAPPED_FILE *pFile, const char *name)
+{
+	char path[1024];
+	struct stat st;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", data_directory, name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || 0 == st.st_size)
+	{
+		close(fd);
+		return -1;
+	}
+	pFile->size = st.st_size;
+	pFile->p = mmap(NULL, pFile->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == pFile->p)
+	{
+		pFile->p = NULL;
+		return -1;
+	}
+	madvise((void *)pFile->p, pFile->size, MADV_SEQUENTIAL);
+	return 0;
+}
+
+static void histogram_add(uint64_t *histogram, uint64_t us)
+{
+	int i = 0;
+
+	while (i < HISTOGRAM_BUCKETS - 1 && us >= (1ULL << i))
+	{
+		i++;
+	}
+	histogram[i]++;
+}
+
+
+// list the blocks of one dat file, they follow each other to the end of the file
+static void scan_dat_file(int file_id)
+{
+	const MAPPED_FILE *pFile = &dat_files[file_id];
+	uint64_t offset = 0;
+	uint32_t len;
+	BLOCK *pBlock;
+
+	while (offset < pFile->size)
+	{
+		if (nBlocks >= nBlocksSize)
+		{
+			nBlocksSize = nBlocksSize ? nBlocksSize * 2 : 4096;
+			blocks = realloc(blocks, nBlocksSize * sizeof(BLOCK));
+			if (NULL == blocks)
+			{
+				fprintf(stderr, "error: out of memory\n");
+				exit(1);
+			}
+		}
+		pBlock = &blocks[nBlocks];
+		memset(pBlock, 0, sizeof(BLOCK));
+		pBlock->file_id = file_id;
+		pBlock->offset = offset;
+		pBlock->nArticles = pFile->p[offset];
+		offset += 1 + pBlock->nArticles * sizeof(CONCAT_ARTICLE_INFO);
+		if (offset + sizeof(len) > pFile->size)
+		{
+			block_error(pBlock, "header past the end of the file");
+			return;
+		}
+		memcpy(&len, &pFile->p[offset], sizeof(len));
+		pBlock->codec = len >> DAT_CODEC_SHIFT;
+		pBlock->compressed_len = len & DAT_LENGTH_MASK;
+		offset += sizeof(len) + pBlock->compressed_len;
+		if (offset > pFile->size)
+		{
+			block_error(pBlock, "data past the end of the file");
+			return;
+		}
+		nBlocks++;
+	}
+}
+
+
+// decode len bytes to the worker buffer, the ends (ascending) get the time it took to reach them
+static int decode_run(WORKER *pWorker, int codec, const unsigned char *src, uint32_t srcLen,
+		      uint32_t len, const uint32_t *ends, uint64_t *us, int nEnds)
+{
+	ELzmaStatus status;
+	SizeT inLen;
+	uint64_t start = time_us();
+	uint32_t decoded;
+	int i;
+
+	switch (codec)
+	{
+	case DAT_CODEC_LZMA:
+		if (srcLen < LZMA_PROPS_SIZE ||
+		    SZ_OK != LzmaDec_AllocateProbs(&pWorker->dec, src, LZMA_PROPS_SIZE, &g_Alloc))
+		{
+			return -1;
+		}
+		pWorker->dec.dic = pWorker->buf;
+		pWorker->dec.dicBufSize = len;
+		LzmaDec_Init(&pWorker->dec);
+		src += LZMA_PROPS_SIZE;
+		srcLen -= LZMA_PROPS_SIZE;
+		for (i = 0; i <= nEnds; i++)
+		{
+			SizeT dicLimit = i < nEnds ? ends[i] : len;
+
+			inLen = srcLen;
+			if (SZ_OK != LzmaDec_DecodeToDic(&pWorker->dec, dicLimit, src, &inLen, LZMA_FINISH_ANY, &status) ||
+			    pWorker->dec.dicPos != dicLimit)
+			{
+				return -1;
+			}
+			src += inLen;
+			srcLen -= inLen;
+			if (i < nEnds)
+			{
+				us[i] = time_us() - start;
+			}
+		}
+		return 0;
+
+	case DAT_CODEC_LZ4:
+		// LZ4 cannot stop and go on, its time is in proportion to the bytes decoded
+		decoded = len;
+		if (lz4_decode(pWorker->buf, &decoded, src, srcLen) || decoded != len)
+		{
+			return -1;
+		}
+		for (i = 0; i < nEnds; i++)
+		{
+			us[i] = len ? (time_us() - start) * ends[i] / len : 0;
+		}
+		return 0;
+
+	default:
+		return -1;
+	}
+}
+
+// check the article at offset of the decoded run
+static void check_article(BLOCK *pBlock, const CONCAT_ARTICLE_INFO *pInfo, const unsigned char *p)
+{
+	ARTICLE_HEADER header;
+	ARTICLE_CHECKPOINT checkpoint;
+	uint32_t links_len;
+	uint32_t offset_previous = 0;
+	uint32_t y_previous = 0;
+	int i;
+
+	if (pInfo->article_len < sizeof(ARTICLE_HEADER))
+	{
+		block_error(pBlock, "article %u: shorter than its header", pInfo->article_id);
+		return;
+	}
+	memcpy(&header, p, sizeof(header));
+	links_len = sizeof(ARTICLE_HEADER) + header.article_link_count * sizeof(ARTICLE_LINK) +
+		header.checkpoint_count * sizeof(ARTICLE_CHECKPOINT);
+	if (header.offset_article > pInfo->article_len || header.offset_article < links_len)
+	{
+		block_error(pBlock, "article %u: text offset %u links %u length %u", pInfo->article_id,
+			    header.offset_article, links_len, pInfo->article_len);
+		return;
+	}
+
+	// the device only starts drawing at a checkpoint inside the text and after the one before it
+	for (i = 0; i < header.checkpoint_count; i++)
+	{
+		memcpy(&checkpoint, p + sizeof(ARTICLE_HEADER) + header.article_link_count * sizeof(ARTICLE_LINK) +
+		       i * sizeof(ARTICLE_CHECKPOINT), sizeof(checkpoint));
+		if (checkpoint.offset > pInfo->article_len - header.offset_article ||
+		    (i && (checkpoint.offset <= offset_previous || checkpoint.y <= y_previous)))
+		{
+			block_error(pBlock, "article %u: checkpoint %d offset %u y %u", pInfo->article_id,
+				    i, checkpoint.offset, checkpoint.y);
+			return;
+		}
+		offset_previous = checkpoint.offset;
+		y_previous = checkpoint.y;
+	}
+}
+
+static void verify_block(WORKER *pWorker, int nBlock)
+{
+	BLOCK *pBlock = &blocks[nBlock];
+	const unsigned char *pHeader = dat_files[pBlock->file_id].p + pBlock->offset;
+	const unsigned char *pData = pHeader + 1 + pBlock->nArticles * sizeof(CONCAT_ARTICLE_INFO) + sizeof(uint32_t);
+	CONCAT_ARTICLE_INFO infos[MAX_ARTICLES_PER_COMPRESSION];
+	DAT_SEGMENT segments[MAX_ARTICLES_PER_COMPRESSION];
+	uint32_t ends[MAX_ARTICLES_PER_COMPRESSION];
+	uint64_t us[MAX_ARTICLES_PER_COMPRESSION];
+	int order[MAX_ARTICLES_PER_COMPRESSION];
+	int nSegments = 1;
+	uint64_t start;
+	uint32_t i, j;
+	int s, n, k;
+
+	memcpy(infos, pHeader + 1, pBlock->nArticles * sizeof(CONCAT_ARTICLE_INFO));
+	for (i = 0; i < pBlock->nArticles; i++)
+	{
+		uint32_t offset = infos[i].offset_article & ~0x80000000;
+		const ARTICLE_PTR *pPtr;
+
+		if (pBlock->decoded_len < offset + infos[i].article_len)
+		{
+			pBlock->decoded_len = offset + infos[i].article_len;
+		}
+		if (!infos[i].article_id || infos[i].article_id > nArticles)
+		{
+			block_error(pBlock, "article %u: not in wiki.idx", infos[i].article_id);
+			continue;
+		}
+		pPtr = &article_ptrs[infos[i].article_id - 1];
+		if (pPtr->file_id != pBlock->file_id || (pPtr->offset_dat & 0x7FFFFFFF) != pBlock->offset)
+		{
+			block_error(pBlock, "article %u: wiki.idx has wiki%d.dat offset %u", infos[i].article_id,
+				    pPtr->file_id, pPtr->offset_dat & 0x7FFFFFFF);
+		}
+		if (__sync_fetch_and_add(&article_seen[infos[i].article_id - 1], 1))
+		{
+			block_error(pBlock, "article %u: in more than one block", infos[i].article_id);
+		}
+	}
+	if (pBlock->decoded_len > pWorker->buf_size)
+	{
+		pWorker->buf_size = pBlock->decoded_len;
+		pWorker->buf = realloc(pWorker->buf, pWorker->buf_size);
+		if (NULL == pWorker->buf)
+		{
+			fprintf(stderr, "error: out of memory\n");
+			exit(1);
+		}
+	}
+
+	if (pBlock->codec & DAT_CODEC_SEGMENTED)
+	{
+		const MAPPED_FILE *pFile = &dat_files[pBlock->file_id];
+		uint64_t table_end;
+
+		// the table must be inside the block (and the file) before it is copied
+		nSegments = pBlock->compressed_len ? pData[0] : 0;
+		table_end = (pData - pFile->p) + 1 + (uint64_t)nSegments * sizeof(DAT_SEGMENT);
+		if (!nSegments || 1 + nSegments * sizeof(DAT_SEGMENT) > pBlock->compressed_len || table_end > pFile->size)
+		{
+			block_error(pBlock, "%d segments in %u bytes", nSegments, pBlock->compressed_len);
+			return;
+		}
+		memcpy(segments, pData + 1, nSegments * sizeof(DAT_SEGMENT));
+	}
+	else
+	{
+		segments[0].offset_article = 0;
+		segments[0].offset_compressed = 0;
+	}
+	pBlock->nSegments = nSegments;
+
+	start = time_us();
+	for (s = 0; s < nSegments; s++)
+	{
+		uint32_t first = segments[s].offset_article;
+		uint32_t last = s + 1 < nSegments ? segments[s + 1].offset_article : pBlock->decoded_len;
+		uint32_t offset_compressed = segments[s].offset_compressed;
+		uint32_t end_compressed = s + 1 < nSegments ? segments[s + 1].offset_compressed : pBlock->compressed_len;
+
+		if (first > last || offset_compressed > end_compressed || end_compressed > pBlock->compressed_len)
+		{
+			block_error(pBlock, "segment %d: offsets out of order", s);
+			return;
+		}
+
+		// the articles of the segment by their end
+		for (i = n = 0; i < pBlock->nArticles; i++)
+		{
+			uint32_t offset = infos[i].offset_article & ~0x80000000;
+
+			if (offset < first || offset >= last || (offset == last && s + 1 < nSegments))
+			{
+				continue;
+			}
+			if (offset + infos[i].article_len > last)
+			{
+				block_error(pBlock, "article %u: runs past its segment", infos[i].article_id);
+				return;
+			}
+			for (k = n; k > 0 && ends[k - 1] > offset + infos[i].article_len - first; k--)
+			{
+				ends[k] = ends[k - 1];
+				order[k] = order[k - 1];
+			}
+			ends[k] = offset + infos[i].article_len - first;
+			order[k] = i;
+			n++;
+		}
+
+		if (decode_run(pWorker, pBlock->codec & DAT_CODEC_MASK, pData + offset_compressed,
+			       end_compressed - offset_compressed, last - first, ends, us, n))
+		{
+			block_error(pBlock, "segment %d: cannot decode %u bytes", s, last - first);
+			return;
+		}
+		for (k = 0; k < n; k++)
+		{
+			const CONCAT_ARTICLE_INFO *pInfo = &infos[order[k]];
+
+			check_article(pBlock, pInfo, pWorker->buf + (pInfo->offset_article & ~0x80000000) - first);
+			histogram_add(pWorker->open_histogram, us[k]);
+			if (us[k] >= pWorker->worst.us)
+			{
+				pWorker->worst.us = us[k];
+				pWorker->worst.article_id = pInfo->article_id;
+				pWorker->worst.block = nBlock;
+				pWorker->worst.read_len = end_compressed - offset_compressed;
+				pWorker->worst.decoded_len = ends[k];
+			}
+		}
+	}
+	pBlock->us = time_us() - start;
+	histogram_add(pWorker->block_histogram, pBlock->us);
+
+	// all the articles are in the segments
+	for (i = 0; i < pBlock->nArticles; i++)
+	{
+		uint32_t offset = infos[i].offset_article & ~0x80000000;
+
+		for (j = 0; j + 1 < (uint32_t)nSegments && offset >= segments[j + 1].offset_article; j++)
+		{
+		}
+		if (offset < segments[j].offset_article)
+		{
+			block_error(pBlock, "article %u: before the first segment", infos[i].article_id);
+		}
+	}
+}
+
+static void *worker_run(void *arg)
+{
+	WORKER *pWorker = (WORKER *)arg;
+	int nBlock;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&lock);
+		nBlock = nNextBlock++;
+		pthread_mutex_unlock(&lock);
+		if (nBlock >= nBlocks)
+		{
+			break;
+		}
+		verify_block(pWorker, nBlock);
+		if (verbose && 0 == (nBlock + 1) % 10000)
+		{
+			fprintf(stderr, "verified %d of %d blocks\n", nBlock + 1, nBlocks);
+		}
+	}
+	LzmaDec_FreeProbs(&pWorker->dec, &g_Alloc);
+	return NULL;
+}
+
+
+static int compare_uint32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// nearest rank percentiles of one BLOCK field
+static void print_sizes(const char *name, size_t field)
+{
+	uint32_t *values = malloc((nBlocks + 1) * sizeof(uint32_t));
+	uint64_t total = 0;
+	int i;
+
+	if (NULL == values)
+	{
+		fprintf(stderr, "error: out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < nBlocks; i++)
+	{
+		memcpy(&values[i], (const char *)&blocks[i] + field, sizeof(uint32_t));
+		total += values[i];
+	}
+	qsort(values, nBlocks, sizeof(uint32_t), compare_uint32);
+#define PERCENTILE(p) (nBlocks ? values[(nBlocks * (p) + 99) / 100 - 1] : 0)
+	printf("  \"%s\": {\"total\": %llu, \"mean\": %llu, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u},\n",
+	       name, (unsigned long long)total, (unsigned long long)(nBlocks ? total / nBlocks : 0),
+	       PERCENTILE(50), PERCENTILE(90), PERCENTILE(99), nBlocks ? values[nBlocks - 1] : 0);
+#undef PERCENTILE
+	free(values);
+}
+
+static void print_histogram(const char *name, const uint64_t *histogram)
+{
+	const char *separator = "";
+	int i;
+
+	printf("  \"%s\": {", name);
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		if (histogram[i])
+		{
+			printf("%s\"<%llu\": %llu", separator, 1ULL << i, (unsigned long long)histogram[i]);
+			separator = ", ";
+		}
+	}
+	printf("},\n");
+}
+
+static void print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++)
+	{
+		if ('"' == *s || '\\' == *s)
+		{
+			putchar('\\');
+		}
+		if ((unsigned char)*s >= ' ')
+		{
+			putchar(*s);
+		}
+	}
+	putchar('"');
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *blocks_name = NULL;
+	int nThreads = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t block_histogram[HISTOGRAM_BUCKETS];
+	uint64_t open_histogram[HISTOGRAM_BUCKETS];
+	WORST_OPEN worst;
+	WORKER *workers;
+	uint32_t nMissing = 0;
+	uint32_t nRestricted = 0;
+	uint64_t start;
+	int nFiles = 0;
+	char name[32];
+	int i, j;
+
+	for (;;)
+	{
+		int c, option_index = 0;
+		c = getopt_long(argc, argv, "hvd:t:b:", opts, &option_index);
+		if (c == -1)
+		{
+			break;
+		}
+
+		switch (c)
+		{
+		case 'h':
+			usage(NULL);
+			break;
+		case 'd':
+			data_directory = optarg;
+			break;
+		case 't':
+			nThreads = atoi(optarg);
+			break;
+		case 'b':
+			blocks_name = optarg;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage("invalid arguments");
+		}
+	}
+	if (nThreads <= 0)
+	{
+		nThreads = 1;
+	}
+
+	if (map_file(&idx_file, "wiki.idx") || idx_file.size < sizeof(uint32_t))
+	{
+		usage("cannot read wiki.idx in --data=dir");
+	}
+	memcpy(&nArticles, idx_file.p, sizeof(nArticles));
+	if (sizeof(uint32_t) + (uint64_t)nArticles * sizeof(ARTICLE_PTR) > idx_file.size)
+	{
+		fprintf(stderr, "error: wiki.idx is shorter than its %u articles\n", nArticles);
+		exit(1);
+	}
+	article_ptrs = (const ARTICLE_PTR *)(idx_file.p + sizeof(uint32_t));
+	article_seen = calloc(nArticles + 1, 1);
+
+	for (i = 0; i < MAX_DAT_FILES; i++)
+	{
+		snprintf(name, sizeof(name), "wiki%d.dat", i);
+		if (map_file(&dat_files[i], name))
+		{
+			break;
+		}
+		nFiles++;
+		scan_dat_file(i);
+	}
+	if (!nFiles)
+	{
+		usage("no wiki0.dat in --data=dir");
+	}
+	if (verbose)
+	{
+		fprintf(stderr, "%d files %d blocks %u articles %d threads\n", nFiles, nBlocks, nArticles, nThreads);
+	}
+
+	start = time_us();
+	workers = calloc(nThreads, sizeof(WORKER));
+	if (NULL == workers || NULL == article_seen)
+	{
+		fprintf(stderr, "error: out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < nThreads; i++)
+	{
+		LzmaDec_Construct(&workers[i].dec);
+		if (pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]))
+		{
+			fprintf(stderr, "error: cannot start thread %d\n", i);
+			exit(1);
+		}
+	}
+	memset(block_histogram, 0, sizeof(block_histogram));
+	memset(open_histogram, 0, sizeof(open_histogram));
+	memset(&worst, 0, sizeof(worst));
+	worst.block = -1;
+	for (i = 0; i < nThreads; i++)
+	{
+		pthread_join(workers[i].thread, NULL);
+		for (j = 0; j < HISTOGRAM_BUCKETS; j++)
+		{
+			block_histogram[j] += workers[i].block_histogram[j];
+			open_histogram[j] += workers[i].open_histogram[j];
+		}
+		if (workers[i].worst.us >= worst.us && workers[i].worst.article_id)
+		{
+			worst = workers[i].worst;
+		}
+		free(workers[i].buf);
+	}
+
+	// every article of wiki.idx is in the block it points to
+	for (i = 0; (uint32_t)i < nArticles; i++)
+	{
+		if (!article_seen[i])
+		{
+			if (nMissing++ < 10 || verbose)
+			{
+				fprintf(stderr, "error: article %d: not in any block\n", i + 1);
+			}
+		}
+		if (article_ptrs[i].offset_dat & 0x80000000)
+		{
+			nRestricted++;
+		}
+	}
+	nErrors += nMissing;
+
+	if (NULL != blocks_name)
+	{
+		FILE *f = fopen(blocks_name, "w");
+
+		if (NULL == f)
+		{
+			usage("cannot create --blocks=file");
+		}
+		fprintf(f, "file,offset,codec,segments,articles,compressed,decoded,us,errors\n");
+		for (i = 0; i < nBlocks; i++)
+		{
+			fprintf(f, "%d,%u,%d,%d,%u,%u,%u,%llu,%u\n", blocks[i].file_id, blocks[i].offset,
+				blocks[i].codec & DAT_CODEC_MASK, blocks[i].nSegments, blocks[i].nArticles,
+				blocks[i].compressed_len, blocks[i].decoded_len, (unsigned long long)blocks[i].us,
+				blocks[i].errors);
+		}
+		fclose(f);
+	}
+
+	printf("{\n  \"data\": ");
+	print_json_string(data_directory);
+	printf(",\n  \"files\": %d,\n  \"blocks\": %d,\n  \"articles\": %u,\n  \"restricted\": %u,\n  \"threads\": %d,\n",
+	       nFiles, nBlocks, nArticles, nRestricted, nThreads);
+	printf("  \"elapsed_us\": %llu,\n", (unsigned long long)(time_us() - start));
+	print_sizes("articles_per_block", offsetof(BLOCK, nArticles));
+	print_sizes("compressed_bytes", offsetof(BLOCK, compressed_len));
+	print_sizes("decoded_bytes", offsetof(BLOCK, decoded_len));
+	print_histogram("block_decode_us", block_histogram);
+	print_histogram("article_open_us", open_histogram);
+	if (worst.block >= 0)
+	{
+		printf("  \"worst_open\": {\"article\": %u, \"file\": %d, \"offset\": %u, \"us\": %llu, "
+		       "\"read_bytes\": %u, \"decoded_bytes\": %u},\n",
+		       worst.article_id, blocks[worst.block].file_id, blocks[worst.block].offset,
+		       (unsigned long long)worst.us, worst.read_len, worst.decoded_len);
+	}
+	printf("  \"errors\": %u\n}\n", nErrors);
+
+	return nErrors ? 1 : 0;
+}
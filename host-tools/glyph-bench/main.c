@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Draw random glyphs at random places of an article sized buffer with the per pixel loops that
+// buf_draw_char(), buf_draw_bmf_char() and render_glyph() used, with glyph_blit() and from the
+// glyph cache, check the buffers are the same byte for byte and output the time per glyph of each
+// as JSON. The glyphs are the characters of a made up font, the first few drawn most often; the
+// cached drawing is compared with pres_bmfbm() and glyph_blit() for each glyph.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "glyph_blit.h"
+#include "glyph_cache.h"
+
+
+static struct option opts[] = {
+	{ "help", 0, 0, 'h' },
+	{ "glyphs", 1, 0, 'g' },
+	{ "rounds", 1, 0, 'r' },
+	{ "seed", 1, 0, 's' },
+	{ NULL, 0, NULL, 0 }
+};
+
+#define BUF_WIDTH_BYTES 32	// LCD_BUF_WIDTH_BYTES
+#define BUF_WIDTH_PIXELS 240	// LCD_BUF_WIDTH_PIXELS
+#define BUF_HEIGHT 1024
+#define MAX_GLYPH_BYTES 48	// charmetric_bmf.bitmap
+#define FONT_CHARS 96	// as many as the printable ASCII characters
+#define FONT_FREQUENT 40	// drawn 3 times in 4
+
+typedef struct _GLYPH {
+	ucs4_t u;
+	int x;
+	int y;
+	int width;
+	int height;
+	int widthBytes;
+	unsigned char bitmap[MAX_GLYPH_BYTES];
+} GLYPH;
+
+static unsigned char buf_pixel[BUF_WIDTH_BYTES * BUF_HEIGHT];
+static unsigned char buf_blit[BUF_WIDTH_BYTES * BUF_HEIGHT];
+static GLYPH font_glyphs[FONT_CHARS];
+static pcffont_bmf_t font;
+
+
+static void usage(const char *message)
+{
+	if (NULL != message)
+	{
+		fprintf(stderr, "error: %s\n", message);
+	}
+	fprintf(stderr, "usage: %s <options>\n"
+		"      --help              this message\n"
+		"      --glyphs=n          glyphs drawn per round [10000]\n"
+		"      --rounds=n          rounds of each drawing [20]\n"
+		"      --seed=n            random seed [1]\n",
+		"glyph-bench");
+	exit(1);
+}
+
+void *memory_allocate(size_t size, const char *tag)
+{
+	return malloc(size);
+}
+
+void memory_free(void *address, const char *tag)
+{
+	free(address);
+}
+
+// the glyph of the made up font
+int pres_bmfbm(ucs4_t val, pcffont_bmf_t *pFont, bmf_bm_t **bitmap, charmetric_bmf *Cmetrics)
+{
+	const GLYPH *g = &font_glyphs[val % FONT_CHARS];
+
+	memset(Cmetrics, 0, sizeof(charmetric_bmf));
+	Cmetrics->width = g->width;
+	Cmetrics->height = g->height;
+	Cmetrics->widthBytes = g->widthBytes;
+	Cmetrics->widthBits = g->widthBytes * 8;
+	Cmetrics->widthDevice = g->width + 1;
+	memcpy(Cmetrics->bitmap, g->bitmap, sizeof(Cmetrics->bitmap));
+	*bitmap = (bmf_bm_t *)Cmetrics->bitmap;
+	return 1;
+}
+
+static uint64_t time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// as guilib_buffer_set_pixel()
+static void set_pixel(unsigned char *membuffer, int x, int y)
+{
+	unsigned int byte = (x + BUF_WIDTH_BYTES * 8 * y) / 8;
+	unsigned int bit  = (x + BUF_WIDTH_BYTES * 8 * y) % 8;
+
+	membuffer[byte] |= (1 << (7 - bit));
+}
+
+// the loop of buf_draw_char() before glyph_blit()
+static void draw_pixels(unsigned char *buf, const GLYPH *g, int mode)
+{
+	int widthBits = g->widthBytes * 8;
+	int x_offset = 0;
+	int y_offset = 0;
+	int i, j;
+
+	for (i = 0; i < g->widthBytes * g->height; i++)
+	{
+		for (j = 7; j >= 0; j--)
+		{
+			if (x_offset >= widthBits)
+			{
+				x_offset = 0;
+				y_offset++;
+			}
+			if (x_offset < g->width && (g->bitmap[i] & (1 << j)) && g->x + x_offset < BUF_WIDTH_PIXELS)
+			{
+				if (GLYPH_BLIT_INVERT == mode)
+				{
+					unsigned int byte = (g->x + x_offset + BUF_WIDTH_BYTES * 8 * (g->y + y_offset)) / 8;
+					unsigned int bit  = (g->x + x_offset + BUF_WIDTH_BYTES * 8 * (g->y + y_offset)) % 8;
+
+					buf[byte] ^= (1 << (7 - bit));
+				}
+				else
+				{
+					set_pixel(buf, g->x + x_offset, g->y + y_offset);
+				}
+			}
+			x_offset++;
+		}
+	}
+}
+
+// the loop of render_glyph() before glyph_blit(), the rows are not padded to bytes
+static void draw_packed(unsigned char *buf, const GLYPH *g)
+{
+	int x, y, w, use, bit = 0;
+	const unsigned char *d = g->bitmap;
+
+	for (y = g->y; y < g->y + g->height; y++)
+	{
+		for (x = g->x, w = g->width; w > 0;)
+		{
+			unsigned byte = (x + BUF_WIDTH_BYTES * 8 * y) / 8;
+
+			use = 8 - (x % 8) < w ? 8 - (x % 8) : w;
+			use = 8 - bit < use ? 8 - bit : use;
+			buf[byte] |= (*d << bit & (unsigned char)(0xff << (8 - use))) >> (x % 8);
+			bit += use;
+			x += use;
+			w -= use;
+			if (bit == 8)
+			{
+				bit = 0;
+				d++;
+			}
+		}
+	}
+}
+
+static void draw_blit(unsigned char *buf, const GLYPH *g, int mode)
+{
+	glyph_blit(buf, BUF_WIDTH_BYTES, g->x, g->y, BUF_WIDTH_PIXELS, g->bitmap, 0,
+		   g->widthBytes * 8, g->width, g->height, mode);
+}
+
+// as buf_draw_char() before the glyph cache
+static void draw_font(unsigned char *buf, const GLYPH *g, int mode)
+{
+	bmf_bm_t *bitmap = NULL;
+	charmetric_bmf Cmetrics;
+
+	pres_bmfbm(g->u, &font, &bitmap, &Cmetrics);
+	glyph_blit(buf, BUF_WIDTH_BYTES, g->x, g->y, BUF_WIDTH_PIXELS, bitmap, 0,
+		   Cmetrics.widthBits, Cmetrics.width, Cmetrics.height, mode);
+}
+
+static void draw_cached(unsigned char *buf, const GLYPH *g, int mode)
+{
+	glyph_cache_draw(glyph_cache_get(&font, g->u), buf, BUF_WIDTH_BYTES, g->x, g->y, BUF_WIDTH_PIXELS, mode);
+}
+
+static void draw_blit_packed(unsigned char *buf, const GLYPH *g)
+{
+	glyph_blit(buf, BUF_WIDTH_BYTES, g->x, g->y, g->x + g->width, g->bitmap, 0,
+		   g->width, g->width, g->height, GLYPH_BLIT_SET);
+}
+
+
+// glyphs the sizes of the wiki fonts, some of them crossing the right edge
+static void make_glyphs(GLYPH *glyphs, int nGlyphs)
+{
+	GLYPH *g;
+	int i;
+
+	for (g = font_glyphs; g < font_glyphs + FONT_CHARS; g++)
+	{
+		g->u = g - font_glyphs;
+		g->width = 1 + rand() % 16;
+		if (0 == rand() % 8)
+		{
+			g->width = 17 + rand() % 8;
+		}
+		g->widthBytes = (g->width + 7) / 8;
+		g->height = 1 + rand() % (MAX_GLYPH_BYTES / g->widthBytes < 19 ? MAX_GLYPH_BYTES / g->widthBytes : 19);
+		for (i = 0; i < MAX_GLYPH_BYTES; i++)
+		{
+			g->bitmap[i] = rand();
+		}
+	}
+	for (g = glyphs; g < glyphs + nGlyphs; g++)
+	{
+		*g = font_glyphs[rand() % 4 ? rand() % FONT_FREQUENT : rand() % FONT_CHARS];
+		g->x = rand() % (BUF_WIDTH_PIXELS + 4);
+		g->y = rand() % (BUF_HEIGHT - g->height);
+	}
+}
+
+// microseconds per glyph of the best round
+static double time_drawing(const GLYPH *glyphs, int nGlyphs, int nRounds,
+			   unsigned char *buf, int method, int mode)
+{
+	uint64_t best = 0;
+	uint64_t start;
+	int r, i;
+
+	for (r = 0; r < nRounds; r++)
+	{
+		memset(buf, 0, BUF_WIDTH_BYTES * BUF_HEIGHT);
+		start = time_us();
+		for (i = 0; i < nGlyphs; i++)
+		{
+			switch (method)
+			{
+			case 0:
+				draw_pixels(buf, &glyphs[i], mode);
+				break;
+			case 1:
+				draw_blit(buf, &glyphs[i], mode);
+				break;
+			case 2:
+				draw_packed(buf, &glyphs[i]);
+				break;
+			case 3:
+				draw_blit_packed(buf, &glyphs[i]);
+				break;
+			case 4:
+				draw_cached(buf, &glyphs[i], mode);
+				break;
+			case 5:
+				draw_font(buf, &glyphs[i], mode);
+				break;
+			}
+		}
+		start = time_us() - start;
+		if (0 == r || start < best)
+		{
+			best = start;
+		}
+	}
+	return (double)best / nGlyphs;
+}
+
+static bool compare(const char *name)
+{
+	int i;
+
+	for (i = 0; i < BUF_WIDTH_BYTES * BUF_HEIGHT; i++)
+	{
+		if (buf_pixel[i] != buf_blit[i])
+		{
+			fprintf(stderr, "error: %s: byte %d (x %d, y %d) is %02x not %02x\n", name, i,
+				i % BUF_WIDTH_BYTES * 8, i / BUF_WIDTH_BYTES, buf_blit[i], buf_pixel[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+int main(int argc, char **argv)
+{
+	static const char *names[] = { "set", "invert", "packed", "cached_set", "cached_invert" };
+	static const int methods[][2] = { { 0, 1 }, { 0, 1 }, { 2, 3 }, { 5, 4 }, { 5, 4 } };
+	int nGlyphs = 10000;
+	int nRounds = 20;
+	GLYPH *glyphs;
+	bool same = true;
+	int i;
+
+	srand(1);
+	for (;;)
+	{
+		int c, option_index = 0;
+		c = getopt_long(argc, argv, "hg:r:s:", opts, &option_index);
+		if (c == -1)
+		{
+			break;
+		}
+
+		switch (c)
+		{
+		case 'h':
+			usage(NULL);
+			break;
+		case 'g':
+			nGlyphs = atoi(optarg);
+			break;
+		case 'r':
+			nRounds = atoi(optarg);
+			break;
+		case 's':
+			srand(atoi(optarg));
+			break;
+		default:
+			usage("invalid arguments");
+		}
+	}
+	if (nGlyphs <= 0 || nRounds <= 0)
+	{
+		usage("--glyphs and --rounds must be positive");
+	}
+
+	glyphs = malloc(nGlyphs * sizeof(GLYPH));
+	if (NULL == glyphs)
+	{
+		usage("out of memory");
+	}
+	make_glyphs(glyphs, nGlyphs);
+
+	printf("{\n  \"glyphs\": %d,\n  \"rounds\": %d,\n", nGlyphs, nRounds);
+	for (i = 0; i < 5; i++)
+	{
+		int mode = 1 == i || 4 == i ? GLYPH_BLIT_INVERT : GLYPH_BLIT_SET;
+		double us_pixel = time_drawing(glyphs, nGlyphs, nRounds, buf_pixel, methods[i][0], mode);
+		double us_blit = time_drawing(glyphs, nGlyphs, nRounds, buf_blit, methods[i][1], mode);
+		bool ok = compare(names[i]);
+
+		printf("  \"%s\": {\"before_us\": %.4f, \"after_us\": %.4f, \"speedup\": %.2f, \"identical\": %s},\n",
+		       names[i], us_pixel, us_blit, us_blit > 0 ? us_pixel / us_blit : 0, ok ? "true" : "false");
+		same = same && ok;
+	}
+	printf("  \"cache\": {\"bytes\": %u, \"entries\": %u, \"hits\": %u, \"misses\": %u, \"evictions\": %u},\n",
+	       glyph_cache_stats.bytes, glyph_cache_stats.entries, glyph_cache_stats.hits,
+	       glyph_cache_stats.misses, glyph_cache_stats.evictions);
+	printf("  \"identical\": %s\n}\n", same ? "true" : "false");
+
+	free(glyphs);
+	return same ? 0 : 1;
+}
@@ -32,6 +32,33 @@ MAXIMUM_TITLE_LENGTH =  63 # c-code is 64 including '\0'
 MAXIMUM_TITLE_ACTUAL = 255 # c-code is 256 including '\0'
 FND_FILE_SEGMENT_SIZE = 20 * 1024 * 1024
 
+# FND version 1: directory of restart points appended after the titles (see wiki/search.h)
+FND_MAGIC = 0x31444e46 # 'FND1'
+FND_VERSION = 1
+FND_RESTART_INTERVAL = 32 # must be a multiple of 16 (records stored uncompressed)
+FND_DIRECTORY_KEY_LEN = 12
+
+# PFX version 1: bitmap of the third chars present for each pair of first chars (see wiki/search_pfx.h)
+PFX_MAGIC = 0x31584650 # 'PFX1'
+PFX_VERSION = 1
+PFX_HEADER_STRUCT = '<6I'
+
+# title hash: minimal perfect hash of the actual titles to the article number (see wiki/search_ttl.h)
+TTL_MAGIC = 0x314c5454 # 'TTL1'
+TTL_VERSION = 1
+TTL_SEED_BUCKET = 0x811c9dc5
+TTL_SEED_SLOT = 0x9e3779b9
+TTL_SEED_CHECK = 0x7f4a7c15
+TTL_TITLES_PER_BUCKET = 4
+TTL_HEADER_STRUCT = '<7I'
+
+# fuzzy title search: deletion neighbourhood of the start of each search key (see wiki/search_fuzzy.h)
+FUZZY_MAGIC = 0x31595a46 # 'FZY1'
+FUZZY_VERSION = 1
+FUZZY_KEY_LENGTH = 4
+FUZZY_CHAR_COUNT = len(SearchKey.all_characters()) + 1 # c-code SEARCH_CHR_COUNT
+FUZZY_VARIANTS_PER_BLOCK = 512 # 4096 byte blocks
+
 # to catch loop in redirections
 class CycleError(Exception):
     pass
@@ -56,7 +83,7 @@ def usage(message):
     print('       --article-counts=file   File to store the counts [counts.text]')
     print('       --language=<xx>         Set language for index conversions [en]')
     print('       --limit=number          Limit the number of articles processed')
-    print('       --prefix=name           Device file name portion for .fnd/.pfx [pedia]')
+    print('       --prefix=name           Device file name portion for .fnd/.pfx/.fzy/.ttl [pedia]')
     print('       --ignore-templates=file File of templates to ignore(no default)')
     print('       --templates=file        Database for templates [templates.db]')
     print('       --truncate-title        Set when not using language links to save space')
@@ -90,6 +117,8 @@ def main():
     cnt_name = "counts.text"
     fnd_name = 'pedia{0:s}.fnd'
     pfx_name = 'pedia.pfx'
+    fzy_name = 'pedia.fzy'
+    ttl_name = 'pedia.ttl'
     template_name = 'templates.db'
     ignore_templates_name = None
     limit = 'all'
@@ -128,6 +157,8 @@ def main():
         elif opt in ('-p', '--prefix'):
             fnd_name = arg + '{0:s}.fnd'
             pfx_name = arg + '.pfx'
+            fzy_name = arg + '.fzy'
+            ttl_name = arg + '.ttl'
         elif opt in ('-L', '--language'):
             language = arg
         else:
@@ -198,6 +229,8 @@ def main():
 
     output_fnd(fnd_name, processor, language_convert, truncate_title)
     output_pfx(pfx_name)
+    output_fzy(fzy_name)
+    output_ttl(ttl_name)
     del processor
 
     # return non-zero status if there have been any errors
@@ -617,11 +650,14 @@ def bigram_encode(title):
 
 
 index_matrix = None # ensure initialised
+fuzzy_prefixes = None
 
 def output_fnd(filename_format, article_index, language_processor, truncate_title):
     """create bigram table"""
     global bigram
     global index_matrix
+    global fuzzy_prefixes
+    global actual_titles
     global MAXIMUM_TITLE_LENGTH
     global MAXIMUM_TITLE_ACTUAL
     global FND_FILE_SEGMENT_SIZE
@@ -670,10 +706,13 @@ def output_fnd(filename_format, article_index, language_processor, truncate_titl
 
     index_matrix = {}
     index_matrix['\0\0\0'] = out_f.tell()
+    fuzzy_prefixes = {}
+    actual_titles = {}
 
     previous_bigram_title = ''
     previous_utf8_title = ''
     mod_counter = 0
+    directory = []
 
     for stripped_title, title in article_list:
 
@@ -701,6 +740,14 @@ def output_fnd(filename_format, article_index, language_processor, truncate_titl
             index_matrix[key2] = offset
         if key3 not in index_matrix:
             index_matrix[key3] = offset
+        key = stripped_title[0:FUZZY_KEY_LENGTH].lower()
+        if '' != key and key not in fuzzy_prefixes:
+            fuzzy_prefixes[key] = offset
+        if utf8_title not in actual_titles:
+            actual_titles[utf8_title] = article_number
+
+        if 0 == mod_counter % FND_RESTART_INTERVAL:
+            directory.append(struct.pack('<I', offset) + (bigram_title + '\0' * FND_DIRECTORY_KEY_LEN)[:FND_DIRECTORY_KEY_LEN])
 
         if 0 == mod_counter & 0x0f:
             bigram_common_length = 0
@@ -720,6 +767,12 @@ def output_fnd(filename_format, article_index, language_processor, truncate_titl
 
         out_f.write(struct.pack('<I', article_number) + '\0' + bigram_title + '\0' + utf8_title + '\0')
 
+    PrintLog.message(u'Writing restart directory: {0:d} entries'.format(len(directory)))
+    offset_directory = out_f.tell()
+    for entry in directory:
+        out_f.write(entry)
+    out_f.write(struct.pack('<5I', offset_directory, len(directory), FND_RESTART_INTERVAL, FND_VERSION, FND_MAGIC))
+
     PrintLog.message(u'Final segment: {0:s}'.format(out_f.current_filename))
     out_f.close()
     PrintLog.message(u'Time: {0:7.1f}s'.format(time.time() - start_time))
@@ -738,24 +791,144 @@ def common_prefix_length(s1, s2, max = 32):
 
 
 def output_pfx(filename):
-    """output the pfx matrix"""
+    """output the pfx matrix: only the non-zero offsets with a bitmap for each pair of first chars"""
     global index_matrix
 
     PrintLog.message(u'Writing: {0:s}'.format(filename))
     start_time = time.time()
     out_f = open(filename, 'wb')
     list = '\0' + SearchKey.all_characters()
+    pairs = []
+    offsets = []
     for k1 in list:
         for k2 in list:
-            for k3 in list:
-                key = k1+k2+k3
-                if key in index_matrix:
-                    offset = index_matrix[key]
-                else:
-                    offset = 0
-                out_f.write(struct.pack('<I', offset))
+            bits = 0
+            first = len(offsets)
+            for i in range(len(list)):
+                key = k1 + k2 + list[i]
+                if key in index_matrix and 0 != index_matrix[key]:
+                    bits |= 1 << i
+                    offsets.append(index_matrix[key])
+            pairs.append(struct.pack('<3I', bits & 0xffffffff, bits >> 32, first))
+
+    offset_pairs = struct.calcsize(PFX_HEADER_STRUCT)
+    offset_offsets = offset_pairs + struct.calcsize('<3I') * len(pairs)
+    out_f.write(struct.pack(PFX_HEADER_STRUCT, PFX_MAGIC, PFX_VERSION, len(list), len(offsets),
+                            offset_pairs, offset_offsets))
+    out_f.write(''.join(pairs))
+    out_f.write(struct.pack('<{0:d}I'.format(len(offsets)), *offsets))
+
+    out_f.close()
+    PrintLog.message(u'Time: {0:7.1f}s'.format(time.time() - start_time))
+
+
+def fuzzy_key(text):
+    """pack the start of a search key as a number in the same way as the c-code"""
+    key = 0
+    for i in range(FUZZY_KEY_LENGTH):
+        key *= FUZZY_CHAR_COUNT
+        if i < len(text):
+            key += SearchKey.all_characters().index(text[i]) + 1
+    return key
+
+
+def output_fzy(filename):
+    """output the symmetric delete index of the title prefixes"""
+    global fuzzy_prefixes
+
+    PrintLog.message(u'Writing: {0:s}'.format(filename))
+    start_time = time.time()
+
+    prefixes = sorted(fuzzy_prefixes.items())
+    variants = []
+    for i in range(len(prefixes)):
+        key = prefixes[i][0]
+        neighbourhood = set([key] + [key[:j] + key[j + 1:] for j in range(len(key))])
+        neighbourhood.discard('')
+        for variant in neighbourhood:
+            variants.append((fuzzy_key(variant), i))
+    variants.sort()
+
+    header = '<10I'
+    offset_prefixes = struct.calcsize(header)
+    block_size = FUZZY_VARIANTS_PER_BLOCK * 8
+    offset_variants = (offset_prefixes + len(prefixes) * 8 + block_size - 1) // block_size * block_size
+    offset_block_index = offset_variants + len(variants) * 8
+
+    out_f = open(filename, 'wb')
+    out_f.write(struct.pack(header, FUZZY_MAGIC, FUZZY_VERSION, FUZZY_KEY_LENGTH, FUZZY_CHAR_COUNT,
+                            len(prefixes), offset_prefixes, len(variants), offset_variants,
+                            FUZZY_VARIANTS_PER_BLOCK, offset_block_index))
+    for key, offset in prefixes:
+        out_f.write(struct.pack('<2I', fuzzy_key(key), offset))
+    out_f.write('\0' * (offset_variants - out_f.tell()))
+    for variant in variants:
+        out_f.write(struct.pack('<2I', *variant))
+    for i in range(0, len(variants), FUZZY_VARIANTS_PER_BLOCK):
+        out_f.write(struct.pack('<I', variants[i][0]))
+
+    out_f.close()
+    PrintLog.message(u'Fuzzy prefixes: {0:d} variants: {1:d}'.format(len(prefixes), len(variants)))
+    PrintLog.message(u'Time: {0:7.1f}s'.format(time.time() - start_time))
+
+
+def ttl_hashes(title):
+    """FNV-1a of the title with each of the seeds in the same way as the c-code"""
+    h_bucket = TTL_SEED_BUCKET
+    h_slot = TTL_SEED_SLOT
+    h_check = TTL_SEED_CHECK
+    for c in title:
+        c = ord(c)
+        h_bucket = ((h_bucket ^ c) * 0x01000193) & 0xffffffff
+        h_slot = ((h_slot ^ c) * 0x01000193) & 0xffffffff
+        h_check = ((h_check ^ c) * 0x01000193) & 0xffffffff
+    return (h_bucket, h_slot, h_check)
+
+
+def output_ttl(filename):
+    """output the minimal perfect hash of the actual titles (hash and displace)"""
+    global actual_titles
+
+    PrintLog.message(u'Writing: {0:s}'.format(filename))
+    start_time = time.time()
+
+    bucket_count = max(1, (len(actual_titles) + TTL_TITLES_PER_BUCKET - 1) // TTL_TITLES_PER_BUCKET)
+    slot_count = max(1, len(actual_titles) + len(actual_titles) // 8)
+    buckets = [[] for i in range(bucket_count)]
+    for title, article_number in actual_titles.iteritems():
+        (h_bucket, h_slot, h_check) = ttl_hashes(title)
+        buckets[h_bucket % bucket_count].append((h_slot, h_check, article_number))
+
+    # place the largest buckets first while most slots are free
+    displacements = [0] * bucket_count
+    slots = [(0, 0)] * slot_count
+    for b in sorted(range(bucket_count), key = lambda i: len(buckets[i]), reverse = True):
+        if [] == buckets[b]:
+            break
+        for d in xrange(65536):
+            positions = [((h_slot + d * (h_check | 1)) & 0xffffffff) % slot_count
+                         for (h_slot, h_check, article_number) in buckets[b]]
+            if len(set(positions)) == len(positions) and all(0 == slots[p][1] for p in positions):
+                break
+        else:
+            raise ValueError('no displacement for title hash bucket {0:d}'.format(b))
+        displacements[b] = d
+        for p, (h_slot, h_check, article_number) in zip(positions, buckets[b]):
+            slots[p] = (h_check, article_number)
+
+    offset_buckets = struct.calcsize(TTL_HEADER_STRUCT)
+    offset_slots = (offset_buckets + bucket_count * 2 + 3) // 4 * 4
+
+    out_f = open(filename, 'wb')
+    out_f.write(struct.pack(TTL_HEADER_STRUCT, TTL_MAGIC, TTL_VERSION, len(actual_titles),
+                            bucket_count, offset_buckets, slot_count, offset_slots))
+    out_f.write(struct.pack('<{0:d}H'.format(bucket_count), *displacements))
+    out_f.write('\0' * (offset_slots - out_f.tell()))
+    for slot in slots:
+        out_f.write(struct.pack('<2I', *slot))
 
     out_f.close()
+    PrintLog.message(u'Title hash: {0:d} titles buckets: {1:d} slots: {2:d}'.format(len(actual_titles), bucket_count, slot_count))
     PrintLog.message(u'Time: {0:7.1f}s'.format(time.time() - start_time))
 
 
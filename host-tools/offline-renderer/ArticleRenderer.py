@@ -21,6 +21,7 @@ import bucket
 import PrintLog
 import LanguageTranslation
 import EscapeBuffer
+import BlockCodec
 
 try:
     import gd
@@ -99,6 +100,21 @@ CHARMETRIC_BMF  = '<8b48s'  # struct charmetric_bmf (font)
 FONT_BMF_HEADER_SIZE = struct.calcsize(FONT_BMF_HEADER)
 CHARMETRIC_BMF_SIZE  = struct.calcsize(CHARMETRIC_BMF)
 
+# from: wiki-app/bmf.h, a font written by pcf2bmf --compact
+BMF_COMPACT_MAGIC = 0x464d4243  # "CBMF"
+BMF_COMPACT_HEADER = '<I3bxiIII'  # struct bmf_compact_header
+BMF_COMPACT_PAGE = '<I256H'       # struct bmf_compact_page
+BMF_COMPACT_NONE = 0xffff
+BMF_COMPACT_METRICS = '<8b'       # the metrics of charmetric_bmf at the start of each glyph
+
+BMF_COMPACT_HEADER_SIZE = struct.calcsize(BMF_COMPACT_HEADER)
+BMF_COMPACT_PAGE_SIZE = struct.calcsize(BMF_COMPACT_PAGE)
+
+# from: wiki-app/lcd_buf_draw.h
+ARTICLE_CHECKPOINT = '<2I2Bh'  # struct ARTICLE_CHECKPOINT (offset, y, line height, font, x adjustment)
+
+ARTICLE_CHECKPOINT_SIZE = struct.calcsize(ARTICLE_CHECKPOINT)
+
 # font face defines - match the #defines of the same name in: wiki-app/lcd_buf_draw.h
 ITALIC_FONT_IDX         = 1
 DEFAULT_FONT_IDX        = 2
@@ -122,6 +138,11 @@ FONT_FACE_NAME = {
 LCD_WIDTH               = 240
 LCD_LEFT_MARGIN         = 6     # def. in lcd_buf_draw.h
 LCD_IMG_MARGIN          = 8
+LCD_BUF_HEIGHT_PIXELS   = 128 * 1024  # def. in lcd_buf_draw.h
+LINE_SPACE_ADDON        = 1     # def. in lcd_buf_draw.h
+
+# one checkpoint for drawing the article from the middle every this many pixels
+CHECKPOINT_INTERVAL     = 1024
 
 # Line Spaces (read directly from the font using gdbfed)
 H1_LSPACE               = 21     # 17 4
@@ -167,8 +188,10 @@ g_halign = 0
 g_this_article_title = 'NO TITLE'
 g_links = {}
 g_link_cnt = 0
+g_words = set()
 i_out = None
 f_out = None
+w_out = None
 file_number = 0
 
 article_db = None
@@ -191,19 +214,21 @@ def usage(message):
     print('       --font-path=dir                  Path to font files (*.bmf) [fonts]')
     print('       --article-index=file             Article index dictionary input [articles.db]')
     print('       --data-prefix=name               Directory and file name portion for .dat files [pedia]')
-    print('       --index-prefix=name              Directory and file name portion for .idx-tmp files [pedia]')
+    print('       --index-prefix=name              Directory and file name portion for .idx-tmp/.wrd-tmp files [pedia]')
     print('       --languages=<lang>               This data files language code [en]')
     print('       --languages-links=<YN>           Turn on/off inter-wiki links [YES]')
     print('       --images=<YN>                    Turn on/off in-line math images [YES]')
     print('       --articles=<N>                   Articles per block [32]')
     print('       --block-size=<bytes>             Max size for article block [262144]')
     print('       --max-article-length=<bytes>     Max length for individual articles [unlimited]')
+    print('       --codec=<lzma|lz4>               Block compression, lz4 is larger but quicker to open [lzma]')
+    print('       --seek-points=<bytes>            Start a separately compressed run of articles after this [0 = none]')
     exit(1)
 
 
 def main():
     global verbose, warnings, compress
-    global f_out, output, i_out
+    global f_out, output, i_out, w_out
     global font_id_values
     global file_number
     global article_count
@@ -214,7 +239,7 @@ def main():
 
     try:
         opts, args = getopt.getopt(sys.argv[1:],
-                                   'hvwn:d:p:i:t:f:L:l:a:b:m:',
+                                   'hvwn:d:p:i:t:f:L:l:a:b:m:c:s:',
                                    ['help',
                                     'verbose',
                                     'warnings',
@@ -230,6 +255,8 @@ def main():
                                     'articles=',
                                     'block-size=',
                                     'max-article-length=',
+                                    'codec=',
+                                    'seek-points=',
                                     ])
     except getopt.GetoptError as err:
         usage(err)
@@ -238,6 +265,7 @@ def main():
     warnings = False
     data_file = 'pedia{0:d}.dat'
     index_file = 'pedia{0:d}.idx-tmp'
+    word_file = 'pedia{0:d}.wrd-tmp'
     art_file = 'articles.db'
     file_number = 0
     test_file = ''
@@ -249,6 +277,8 @@ def main():
     articles_per_block = 32
     block_size = 262144
     max_article_length = 'unlimited'
+    codec = BlockCodec.CODEC_LZMA
+    seek_points = 0
 
     for opt, arg in opts:
         if opt in ('-v', '--verbose'):
@@ -270,6 +300,7 @@ def main():
             data_file = arg + '{0:d}.dat'
         elif opt in ('-p', '--index-prefix'):
             index_file = arg + '{0:d}.idx-tmp'
+            word_file = arg + '{0:d}.wrd-tmp'
         elif opt in ('-f', '--font-path'):
             font_path = arg
         elif opt in ('-L', '--language'):
@@ -304,6 +335,18 @@ def main():
                     usage('"{0:s}={1:s}" is not numeric'.format(opt, arg))
                 if max_article_length < 0:
                     usage('"{0:s}={1:s}" is out of range [0..unlimited]'.format(opt, arg))
+        elif opt in ('-c', '--codec'):
+            try:
+                codec = BlockCodec.CODECS[arg.lower()]
+            except KeyError:
+                usage('"{0:s}={1:s}" is not one of: {2:s}'.format(opt, arg, ', '.join(sorted(BlockCodec.CODECS.keys()))))
+        elif opt in ('-s', '--seek-points'):
+            try:
+                seek_points = int(arg)
+            except ValueError:
+                usage('"{0:s}={1:s}" is not numeric'.format(opt, arg))
+            if seek_points < 0:
+                usage('"{0:s}={1:s}" is out of range [0..]'.format(opt, arg))
         else:
             usage('unhandled option: ' + opt)
 
@@ -347,11 +390,14 @@ def main():
     if test_file == '':
         compress = True
         i_out = open(index_file.format(file_number), 'wb')
+        w_out = open(word_file.format(file_number), 'wb')
         f_out = open(data_file.format(file_number), 'wb')
         article_writer = ArticleWriter(file_number, f_out, i_out,
                                        max_buckets = 50,
                                        bucket_size = block_size,
-                                       max_items_per_bucket = articles_per_block)
+                                       max_items_per_bucket = articles_per_block,
+                                       codec = codec,
+                                       seek_points = seek_points)
     else:
         compress = False
         f_out = open(test_file, 'wb')
@@ -379,6 +425,8 @@ def main():
         f_out.close()
     if i_out != None:
         i_out.close()
+    if w_out != None:
+        w_out.close()
 
     if article_db != None:
         article_db.close()
@@ -416,6 +464,24 @@ def get_parameter_value(filename, parameter):
 #
 font_width_cache = {}
 font_default_cache = {}
+font_compact_cache = {}
+
+def get_compact_cwidth(font_file, face, c):
+    """the width of character c in a compact font, 0 if it has no glyph"""
+    global font_compact_cache
+
+    (char_count, page_dir, offset_pages, offset_glyphs) = font_compact_cache[face]
+    if ord(c) >= char_count or BMF_COMPACT_NONE == page_dir[ord(c) >> 8]:
+        return 0
+    font_file.seek(offset_pages + page_dir[ord(c) >> 8] * BMF_COMPACT_PAGE_SIZE)
+    page = struct.unpack(BMF_COMPACT_PAGE, font_file.read(BMF_COMPACT_PAGE_SIZE))
+    if BMF_COMPACT_NONE == page[1 + (ord(c) & 0xff)]:
+        return 0
+    font_file.seek(offset_glyphs + page[0] + page[1 + (ord(c) & 0xff)])
+    width, height, widthBytes, widthBits, ascent, descent, LSBearing, widthDevice = \
+        struct.unpack(BMF_COMPACT_METRICS, font_file.read(struct.calcsize(BMF_COMPACT_METRICS)))
+    return widthDevice
+
 
 def get_utf8_cwidth(c, face):
     global font_width_cache
@@ -437,24 +503,34 @@ def get_utf8_cwidth(c, face):
 
     if face not in font_default_cache:
         font_file.seek(0)
-        buffer = font_file.read(FONT_BMF_HEADER_SIZE)
-
-        if len(buffer) != 0:
-            linespace, ascent, descent, bmp_buffer_len, default_char = struct.unpack(FONT_BMF_HEADER, buffer)
+        buffer = font_file.read(BMF_COMPACT_HEADER_SIZE)
+
+        if len(buffer) == BMF_COMPACT_HEADER_SIZE and BMF_COMPACT_MAGIC == struct.unpack('<I', buffer[0:4])[0]:
+            magic, linespace, ascent, descent, default_char, char_count, page_count, offset_glyphs = \
+                struct.unpack(BMF_COMPACT_HEADER, buffer)
+            dir_count = (char_count + 255) // 256
+            page_dir = struct.unpack('<{0:d}H'.format(dir_count), font_file.read(2 * dir_count))
+            font_compact_cache[face] = (char_count, page_dir, BMF_COMPACT_HEADER_SIZE + 2 * dir_count, offset_glyphs)
+        elif len(buffer) >= FONT_BMF_HEADER_SIZE:
+            linespace, ascent, descent, bmp_buffer_len, default_char = \
+                struct.unpack(FONT_BMF_HEADER, buffer[0:FONT_BMF_HEADER_SIZE])
         else:
             linespace, ascent, descent, bmp_buffer_len, default_char = (0, 0, 0, 0, ord(u' '))
 
         font_default_cache[face] = unichr(default_char)
 
-    font_file.seek(ord(c) * CHARMETRIC_BMF_SIZE + FONT_BMF_HEADER_SIZE)
-    buffer = font_file.read(CHARMETRIC_BMF_SIZE)
-
-    if len(buffer) != 0:
-        width, height, widthBytes, widthBits, ascent, descent, LSBearing, widthDevice, bitmap = struct.unpack(CHARMETRIC_BMF, buffer)
+    if face in font_compact_cache:
+        character_width = get_compact_cwidth(font_file, face, c)
     else:
-        width, height, widthBytes, widthBits, ascent, descent, LSBearing, widthDevice, bitmap = (0,0,0,0,0,0,0,0,
-                                                                                               r'\x55' * 48)
-    character_width = widthDevice
+        font_file.seek(ord(c) * CHARMETRIC_BMF_SIZE + FONT_BMF_HEADER_SIZE)
+        buffer = font_file.read(CHARMETRIC_BMF_SIZE)
+
+        if len(buffer) != 0:
+            width, height, widthBytes, widthBits, ascent, descent, LSBearing, widthDevice, bitmap = struct.unpack(CHARMETRIC_BMF, buffer)
+        else:
+            width, height, widthBytes, widthBits, ascent, descent, LSBearing, widthDevice, bitmap = (0,0,0,0,0,0,0,0,
+                                                                                                   r'\x55' * 48)
+        character_width = widthDevice
 
     if 0 == character_width:
 
@@ -486,6 +562,21 @@ get_lineheight_values = {
     DEFAULT_ALL_FONT_IDX:  P_LSPACE
     }
 
+def get_font_linespace(face):
+    """the line space in the header of a font file"""
+    global font_id_values
+
+    font_file = font_id_values[face]
+    font_file.seek(0)
+    buffer = font_file.read(5)
+    if len(buffer) != 5:
+        return 0
+    (magic,) = struct.unpack('<I', buffer[0:4])
+    if BMF_COMPACT_MAGIC == magic:
+        return struct.unpack('<b', buffer[4])[0]
+    return struct.unpack('<b', buffer[0])[0]
+
+
 def get_lineheight(face):
     global get_lineheight_values
     return get_lineheight_values[face]
@@ -660,6 +751,73 @@ def esc_code14(width, height, data):
         g_starty += height - lineh + 3   # since Eric draws images 3px lower for alignment
 
 
+def article_checkpoints(body):
+    """the ARTICLE_CHECKPOINT blocks of the article text
+
+    follows the text the way buf_draw_UTF8_str() in lcd_buf_draw.c moves
+    down it and keeps its state after a new line escape every
+    CHECKPOINT_INTERVAL pixels, so the device can start drawing there"""
+
+    # a new line with the default font takes its line space from the font on the device
+    default_line_height = get_font_linespace(DEFAULT_FONT_IDX) + LINE_SPACE_ADDON
+    checkpoints = io.BytesIO('')
+    y = 0
+    line_height = 0
+    actual_height = 0
+    face = DEFAULT_FONT_IDX
+    x_adjustment = 0
+    next_y = CHECKPOINT_INTERVAL
+    i = 0
+    while i < len(body):
+        c = ord(body[i])
+        i += 1
+        if 0 == c:
+            break
+        elif c > 15:
+            continue
+        elif c in (1, 2, 3, 4):
+            y += actual_height
+            if 1 == c:
+                line_height = ord(body[i])
+                i += 1
+            elif 2 == c:
+                face = DEFAULT_FONT_IDX
+                line_height = default_line_height
+            elif 4 == c:
+                face = ord(body[i]) & 0x07
+                line_height = ord(body[i]) >> 3
+                i += 1
+            actual_height = line_height
+            if y + line_height >= LCD_BUF_HEIGHT_PIXELS:
+                break
+            if y >= next_y and -32768 <= x_adjustment < 32768:
+                checkpoints.write(struct.pack(ARTICLE_CHECKPOINT, i, y, line_height, face, x_adjustment))
+                next_y = y + CHECKPOINT_INTERVAL
+        elif 5 == c:
+            face = ord(body[i]) & 0x07
+            i += 1
+        elif 6 == c:
+            face = DEFAULT_FONT_IDX
+        elif 7 == c:
+            x_adjustment = 0
+        elif c in (8, 9, 11, 12):
+            i += 1
+        elif 10 == c:
+            x_adjustment += struct.unpack('<b', body[i])[0]
+            i += 1
+        elif 13 == c:
+            y += actual_height
+            line_height = 1
+            actual_height = line_height
+        elif 15 == c:
+            (width, height) = struct.unpack('<BH', body[i:i + 3])
+            i += 3 + (width + 7) // 8 * height
+            if line_height < height + 1:
+                actual_height = height + 3
+
+    return checkpoints.getvalue()
+
+
 #
 # Parse the HTML into the WikiReader's format
 #
@@ -687,7 +845,7 @@ class WrProcess(HTMLParser.HTMLParser):
     def local_init(self):
 
         global g_starty, g_curr_face, g_halign
-        global g_this_article_title, g_links, g_link_cnt
+        global g_this_article_title, g_links, g_link_cnt, g_words
 
         self.in_html = False
         self.in_title = False
@@ -733,6 +891,7 @@ class WrProcess(HTMLParser.HTMLParser):
         g_this_article_title = 'NO TITLE'
         g_links = {}
         g_link_cnt = 0
+        g_words = set()
 
 
     def handle_starttag(self, tag, attrs):
@@ -1220,6 +1379,8 @@ class WrProcess(HTMLParser.HTMLParser):
         if not self.in_body or self.in_table > 0 or not self.printing:
             return
 
+        g_words.update(SearchKey.make_words(data))
+
         # defaults
         data = re.sub("\s+" , " ", data)
         face = DEFAULT_FONT_IDX
@@ -1321,7 +1482,7 @@ start_time = 0 # ensure value is initialised
 def write_article(language_links):
     global compress
     global verbose
-    global output, f_out, i_out
+    global output, f_out, i_out, w_out
     global article_count
     global g_this_article_title
     global file_number
@@ -1378,18 +1539,23 @@ def write_article(language_links):
     langs = links_stream.getvalue()
     links_stream.close()
 
-    # create the header (header size = 8)
-    header = struct.pack('<I2H', 8 + len(links) + len(langs), g_link_cnt, 0)
     body = output.fetch()
+    checkpoints = article_checkpoints(body)
+
+    # create the header (header size = 8)
+    header = struct.pack('<I2H', 8 + len(links) + len(checkpoints) + len(langs), g_link_cnt,
+                         len(checkpoints) // ARTICLE_CHECKPOINT_SIZE)
 
     # combine the data
-    whole_article = header + links + langs + body
+    whole_article = header + links + checkpoints + langs + body
 
     if compress:
         try:
             (article_number, fnd_offset, restricted) = article_index(g_this_article_title)
             restricted =  bool(int(restricted))  # '0' is True so turn it into False
             article_writer.add_article(article_number, whole_article, fnd_offset, restricted)
+            # words for the full text index, merged into wiki.wrd by combine_wrd.py
+            w_out.write('{0:d} {1:s}\n'.format(article_number, ' '.join(sorted(g_words))).encode('utf-8'))
         except KeyError:
             PrintLog.message(u'Error in: write_article, Title not found')
             PrintLog.message(u'Title:  {0:s}'.format(g_this_article_title))
@@ -1403,7 +1569,8 @@ class ArticleWriter(bucket.Bucket):
     """to combine sets of articles and compress them together"""
 
     def __init__(self, file_number, data_file, index_file,
-                 max_buckets = 50, bucket_size = 524288, max_items_per_bucket = 64):
+                 max_buckets = 50, bucket_size = 524288, max_items_per_bucket = 64,
+                 codec = BlockCodec.CODEC_LZMA, seek_points = 0):
 
         super(ArticleWriter, self).__init__(max_buckets = max_buckets,
                                             bucket_size = bucket_size,
@@ -1411,6 +1578,8 @@ class ArticleWriter(bucket.Bucket):
         self.file_number = file_number
         self.index_file = index_file
         self.data_file = data_file
+        self.codec = codec
+        self.seek_points = seek_points
         self.index = {}
 
 
@@ -1436,10 +1605,11 @@ class ArticleWriter(bucket.Bucket):
         sizeof_one_block = struct.calcsize(BLOCK_STRUCT)
 
         ah = chr(len(blocks) / sizeof_one_block) + blocks
-        ac = CompressData(all_data)
+        starts = BlockCodec.segment_starts([size for size, item in data], self.seek_points)
+        codec, ac = BlockCodec.compress(all_data, self.codec, starts, CompressData)
         file_offset = self.data_file.tell()
 
-        data_length = struct.pack('<I', len(ac))
+        data_length = struct.pack('<I', len(ac) | (codec << BlockCodec.CODEC_SHIFT))
         self.data_file.write(ah + data_length + ac)
 
         for size, item in data:
@@ -0,0 +1,93 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# COPYRIGHT: Openmoko Inc. 2010
+# LICENSE: GPL Version 3 or later
+# DESCRIPTION: Compressed data of a .dat block
+#
+# the wiki-app must have the same values: search.h DAT_CODEC_*, DAT_SEGMENT
+#
+# block: uint8_t article count, article count * <3I> (id, offset, length),
+#        uint32_t compressed length | codec << 24, compressed data
+#
+# with seek points (CODEC_SEGMENTED) the compressed data is a table of segments,
+# each a run of articles that decodes on its own, then the data of each segment:
+#        uint8_t segment count, segment count * <2I> (decoded offset, compressed offset)
+
+import struct
+import LZ4Block
+
+
+CODEC_SHIFT = 24
+CODEC_LZMA = 0
+CODEC_LZ4 = 1
+CODEC_SEGMENTED = 0x80
+CODEC_MASK = 0x7f
+CODECS = {'lzma': CODEC_LZMA, 'lz4': CODEC_LZ4}
+
+# search.h MAX_COMPRESSED_ARTICLE
+MAXIMUM_COMPRESSED_BLOCK = 512 * 1024
+
+SEGMENT_STRUCT = '<2I'
+
+
+def segment_starts(sizes, seek_points):
+    """decoded offsets of the articles that start a segment: the first article after each seek_points bytes"""
+    starts = [0]
+    offset = 0
+    for size in sizes[:-1]:
+        offset += size
+        if 0 < seek_points and offset - starts[-1] >= seek_points:
+            starts.append(offset)
+    return starts
+
+
+def compress_one(data, codec, compress_lzma):
+    if CODEC_LZ4 == codec:
+        return LZ4Block.compress(data)
+    return compress_lzma(data)
+
+
+def compress_segments(data, codec, starts, compress_lzma):
+    if 1 == len(starts):
+        return compress_one(data, codec, compress_lzma)
+
+    pieces = [compress_one(data[start:end], codec, compress_lzma)
+              for start, end in zip(starts, starts[1:] + [len(data)])]
+    offset = 1 + len(starts) * struct.calcsize(SEGMENT_STRUCT)
+    table = chr(len(starts))
+    for start, piece in zip(starts, pieces):
+        table += struct.pack(SEGMENT_STRUCT, start, offset)
+        offset += len(piece)
+    return table + ''.join(pieces)
+
+
+def compress(data, codec, starts, compress_lzma):
+    """return (codec, compressed data) of a block, LZ4 that does not fit falls back to LZMA"""
+    c = compress_segments(data, codec, starts, compress_lzma)
+    if CODEC_LZ4 == codec and len(c) > MAXIMUM_COMPRESSED_BLOCK:
+        codec = CODEC_LZMA
+        c = compress_segments(data, codec, starts, compress_lzma)
+    if 1 < len(starts):
+        codec |= CODEC_SEGMENTED
+    return codec, c
+
+
+def decompress_one(data, codec, decompress_lzma):
+    if CODEC_LZ4 == codec & CODEC_MASK:
+        return LZ4Block.decompress(data)
+    return decompress_lzma(data)
+
+
+def segments(data, codec):
+    """[(decoded offset, compressed data)...] of a block"""
+    if 0 == codec & CODEC_SEGMENTED:
+        return [(0, data)]
+    count = ord(data[0])
+    table = [struct.unpack_from(SEGMENT_STRUCT, data, 1 + i * struct.calcsize(SEGMENT_STRUCT)) for i in range(count)]
+    ends = [offset for start, offset in table[1:]] + [len(data)]
+    return [(start, data[offset:end]) for (start, offset), end in zip(table, ends)]
+
+
+def decompress(data, codec, decompress_lzma):
+    """the articles of a block"""
+    return ''.join(decompress_one(d, codec, decompress_lzma) for start, d in segments(data, codec))
@@ -12,6 +12,7 @@ import getopt
 import PrintLog
 import locale
 from SegmentedFile import SegmentedFileReader
+import BlockCodec
 
 # try to find a lzma library interface
 no_compression = True
@@ -185,15 +186,20 @@ def process(index_number, idx_file, fnd_file, dat_format, extract):
     PrintLog.message('')
 
     data_length = struct.unpack('<I', dat_file.read(4))[0]
+    codec = data_length >> BlockCodec.CODEC_SHIFT
+    data_length &= (1 << BlockCodec.CODEC_SHIFT) - 1
     PrintLog.message('DataLength  = {0:13n} [0x{0:08x}]'.format(data_length))
+    PrintLog.message('Codec       = {0:s}'.format('LZ4' if BlockCodec.CODEC_LZ4 == codec & BlockCodec.CODEC_MASK else 'LZMA'))
 
     article_data = dat_file.read(data_length)
     dat_file.close()
+    for start, segment_data in BlockCodec.segments(article_data, codec)[1:]:
+        PrintLog.message('SeekPoint   = {0:13n} [0x{0:08x}]  {1:10n} bytes'.format(start, len(segment_data)))
     if extract is not None:
         output_file_name = extract + '-I' + str(index_number) + '-b' + str(data_length) + '.articles'
         PrintLog.message('Extracting uncompressed articles to: {0:s}'.format(output_file_name))
         out = open(output_file_name, 'wb')
-        out.write(DecompressData(article_data))
+        out.write(BlockCodec.decompress(article_data, codec, DecompressData))
         out.close()
 
     PrintLog.message('')
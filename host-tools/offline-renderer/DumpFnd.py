@@ -17,6 +17,13 @@ locale.setlocale(locale.LC_ALL, '')
 
 verbose = False
 
+# FND version 1: directory of restart points and a trailer after the titles (see wiki/search.h)
+FND_MAGIC = 0x31444e46 # 'FND1'
+FND_VERSION = 1
+FND_DIRECTORY_KEY_LEN = 12
+FND_DIRECTORY_ENTRY_STRUCT = '<I{0:d}s'.format(FND_DIRECTORY_KEY_LEN)
+FND_TRAILER_STRUCT = '<5I'
+
 
 def usage(message):
     if None != message:
@@ -57,6 +64,10 @@ def main():
 
     total_entries = 0
 
+    end_of_records, restart_interval, directory = read_directory(fnd_file)
+    fnd_file.seek(0)
+    directory_errors = 0
+
     bigram_table = {}
     for i in range(128,256):
         bigram_table[i] = fnd_file.read(2)
@@ -64,17 +75,27 @@ def main():
     previous_title1 = ''
     previous_title2 = ''
 
-    while True:
+    while fnd_file.tell() < end_of_records:
         fnd_offset = fnd_file.tell()
         header = fnd_file.read(uint32_size + 1)
 
-        if 0 == len(header):
+        if len(header) < uint32_size + 1:
+            PrintLog.message(u'Truncated record @ Offset: {of:13n} [0x{of:08x}]'.format(of = fnd_offset))
             break
 
         article_number, nul_byte = struct.unpack('<IB', header)
 
         title1 = get_title(fnd_file)
         title2 = get_title(fnd_file)
+
+        # the record at a restart point is uncompressed and starts with the key of its entry
+        if 0 != restart_interval and 0 == total_entries % restart_interval:
+            i = total_entries // restart_interval
+            key = (title1 + '\0' * FND_DIRECTORY_KEY_LEN)[:FND_DIRECTORY_KEY_LEN]
+            if i >= len(directory) or directory[i] != (fnd_offset, key):
+                PrintLog.message(u'Directory entry {0:d} does not match record {1:d} @ Offset: {2:13n}'
+                                 .format(i, total_entries, fnd_offset))
+                directory_errors += 1
         total_entries += 1
 
         length1 = len(title1)
@@ -114,6 +135,42 @@ def main():
     fnd_file.close()
 
     PrintLog.message(u'Total entries  = {0:13n}'.format(total_entries))
+    if 0 != restart_interval:
+        if verbose:
+            for i, (offset, key) in enumerate(directory):
+                PrintLog.message(u'Restart: {0:13n} @ Offset: {1:13n} [0x{1:08x}] Key: {2!r:s}'
+                                 .format(i, offset, key.rstrip('\0')))
+        expected = (total_entries + restart_interval - 1) // restart_interval
+        if len(directory) != expected:
+            PrintLog.message(u'Directory has {0:d} entries for {1:d} records, expected {2:d}'
+                             .format(len(directory), total_entries, expected))
+            directory_errors += 1
+        PrintLog.message(u'Directory      = {0:13n} entries every {1:d} records, {2:d} errors'
+                         .format(len(directory), restart_interval, directory_errors))
+
+
+def read_directory(fnd_file):
+    """end of the title records, restart interval and [(offset, key)...] of the directory
+
+    the interval is 0 and the directory empty for files without the trailer"""
+    trailer_size = struct.calcsize(FND_TRAILER_STRUCT)
+    entry_size = struct.calcsize(FND_DIRECTORY_ENTRY_STRUCT)
+    total_bytes = fnd_file.total_bytes
+    if total_bytes < trailer_size:
+        return total_bytes, 0, []
+
+    fnd_file.seek(total_bytes - trailer_size)
+    offset_directory, entries, restart_interval, version, magic = \
+        struct.unpack(FND_TRAILER_STRUCT, fnd_file.read(trailer_size))
+    if FND_MAGIC != magic or FND_VERSION != version or 0 == restart_interval or \
+            offset_directory + entries * entry_size + trailer_size != total_bytes:
+        return total_bytes, 0, []
+
+    fnd_file.seek(offset_directory)
+    directory = []
+    for i in range(entries):
+        directory.append(struct.unpack(FND_DIRECTORY_ENTRY_STRUCT, fnd_file.read(entry_size)))
+    return offset_directory, restart_interval, directory
 
 
 def truncated_utf8(text):
@@ -132,6 +189,8 @@ def get_title(f):
         title = ''
         while '\0' != c:
             c = f.read(1)
+            if '' == c:
+                return title
             title += c
         return title[:-1]
 
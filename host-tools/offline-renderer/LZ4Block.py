@@ -0,0 +1,101 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# COPYRIGHT: Openmoko Inc. 2010
+# LICENSE: GPL Version 3 or later
+# DESCRIPTION: LZ4 block compression for the article data
+#
+# The output is an LZ4 block (no frame) as decoded by wiki/lz4_dec.c:
+# quick to decode on the device at the cost of a larger .dat file than LZMA
+
+import struct
+
+
+MIN_MATCH = 4
+MAX_OFFSET = 65535
+LAST_LITERALS = 5     # the last bytes are always literals
+MATCH_FIND_LIMIT = 12 # no match starts in the last bytes
+
+
+def length_bytes(n):
+    """the bytes added to a length of 15 or more"""
+    return '\xff' * (n / 255) + chr(n % 255)
+
+
+def sequence(literals, offset, match_length):
+    """one token with its literals and the match, if any"""
+    literal_length = len(literals)
+    token = min(literal_length, 15) << 4
+    if match_length:
+        token |= min(match_length - MIN_MATCH, 15)
+    s = chr(token)
+    if literal_length >= 15:
+        s += length_bytes(literal_length - 15)
+    s += literals
+    if match_length:
+        s += struct.pack('<H', offset)
+        if match_length - MIN_MATCH >= 15:
+            s += length_bytes(match_length - MIN_MATCH - 15)
+    return s
+
+
+def compress(data):
+    """greedy match of the last position of each 4 byte string"""
+    size = len(data)
+    out = []
+    positions = {}
+    anchor = 0
+    i = 0
+    while i < size - MATCH_FIND_LIMIT:
+        key = data[i:i + MIN_MATCH]
+        ref = positions.get(key, -1)
+        positions[key] = i
+        if ref < 0 or i - ref > MAX_OFFSET:
+            i += 1
+            continue
+
+        # compare 8 bytes at a time, then the rest
+        length = MIN_MATCH
+        max_length = size - LAST_LITERALS - i
+        while length + 8 <= max_length and data[ref + length:ref + length + 8] == data[i + length:i + length + 8]:
+            length += 8
+        while length < max_length and data[ref + length] == data[i + length]:
+            length += 1
+
+        out.append(sequence(data[anchor:i], i - ref, length))
+        i += length
+        anchor = i
+
+    out.append(sequence(data[anchor:], 0, 0))
+    return ''.join(out)
+
+
+def read_length(data, i, length):
+    """a length of 15 continues in the following bytes"""
+    if 15 == length:
+        while True:
+            c = ord(data[i])
+            i += 1
+            length += c
+            if 255 != c:
+                break
+    return length, i
+
+
+def decompress(data):
+    """the whole block"""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        token = ord(data[i])
+        length, i = read_length(data, i + 1, token >> 4)
+        out += data[i:i + length]
+        i += length
+        if i >= len(data):
+            break
+
+        offset = struct.unpack('<H', data[i:i + 2])[0]
+        length, i = read_length(data, i + 2, token & 0x0f)
+        # the match may overlap the bytes it produces
+        for j in xrange(length + MIN_MATCH):
+            out.append(out[-offset])
+    return str(out)
@@ -16,6 +16,11 @@ KEYPAD_KEYS = """ !#$%&'()*+,-.0123456789=?@abcdefghijklmnopqrstuvwxyz"""
 # underscore and space
 whitespaces = re.compile(r'([\s_]+)', re.IGNORECASE)
 
+# words for the full text index (wiki.wrd), the c-code splits the search string the same way
+words = re.compile(r'[0-9a-z]+')
+MINIMUM_WORD_LENGTH = 2
+MAXIMUM_WORD_LENGTH = 15 # c-code is 16 including '\0'
+
 # list of unsupported punctuation
 PUNCTUATION = string.punctuation + u'、・\r\n \t'
 translation_table = dict.fromkeys(map(ord, KEYPAD_KEYS), None)
@@ -37,6 +42,15 @@ def make_key(text):
     return compact_spaces(result)
 
 
+def make_words(text):
+    """set of the words in a text for the full text index"""
+
+    global words
+
+    return set(w[:MAXIMUM_WORD_LENGTH] for w in words.findall(strip_accents(text).lower())
+               if len(w) >= MINIMUM_WORD_LENGTH)
+
+
 def all_characters():
     """string of all allowed characters in a search key"""
     return KEYPAD_KEYS
@@ -0,0 +1,220 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# COPYRIGHT: Openmoko Inc. 2010
+# LICENSE: GPL Version 3 or later
+# DESCRIPTION: Compression ratio against decode cost for a choice of --seek-points
+#
+# Every block of the .dat files is compressed again with each seek point interval.
+# The cost of opening an article is the bytes decoded up to its end, starting at
+# the beginning of its segment (the whole block without seek points).
+# The time is the measured decompression of each segment shared out by those bytes,
+# on the host: LZ4 is decoded in python here so compare codecs by the bytes decoded.
+
+import sys, os
+import struct
+import os.path
+import getopt
+import time
+import PrintLog
+import locale
+import BlockCodec
+
+# try to find a lzma library interface
+no_compression = True
+
+# python-lzma
+if no_compression:
+    try:
+        import lzma
+
+        def CompressData(data):
+            c = lzma.compress(data, options={'format': 'alone'})
+            return c[:5] + c[13:]
+
+        def DecompressData(data):
+            return lzma.decompress(data[:5] + '\xff'*8 + data[5:])
+
+        no_compression = False
+
+    except:
+        pass
+
+
+# PyLZMA
+if no_compression:
+    try:
+        import pylzma
+
+        def CompressData(data):
+            return pylzma.compress(data,
+                                   dictionary = 24, fastBytes = 32,
+                                   literalContextBits = 3,
+                                   literalPosBits = 0, posBits = 2,
+                                   algorithm = 1, eos = 1)
+
+        def DecompressData(data):
+            return pylzma.decompress(data)
+
+        no_compression = False
+
+    except:
+        pass
+
+
+# none detected
+if no_compression:
+    print('error: Missing python LZMA compression module')
+    print('alternative 1: (preferred)')
+    print('       sudo apt-get install python-lzma')
+    print('alternative 2:')
+    print('       sudo apt-get install python-pylzma')
+    print('alternative 3: compile/install local PyLZMA')
+    print('       make local-pylzma-install')
+    exit(1)
+
+
+locale.setlocale(locale.LC_ALL, '')
+
+verbose = False
+
+
+def usage(message):
+    if None != message:
+        print('error: {0:s}'.format(message))
+    print('usage: {0:s} <options>'.format(os.path.basename(__file__)))
+    print('       --help                  This message')
+    print('       --verbose               Enable verbose output')
+    print('       --dir=<dir>             Directory containing the wiki?.dat files [image/enpedia]')
+    print('       --intervals=<n,...>     Seek point intervals in bytes [0,8192,16384,32768,65536,131072]')
+    print('       --codec=<lzma|lz4>      Codec to compress with [codec of each block]')
+    print('       --blocks=<n>            Blocks to sample from each file [100]')
+    exit(1)
+
+
+def read_blocks(file_name, limit):
+    """[(article sizes, articles, codec)...] of the first limit blocks"""
+    blocks = []
+    f = open(file_name, 'rb')
+    while len(blocks) < limit:
+        count = f.read(1)
+        if '' == count:
+            break
+        count = ord(count)
+        sizes = [struct.unpack('<3I', f.read(12))[2] for i in range(count)]
+        data_length = struct.unpack('<I', f.read(4))[0]
+        codec = data_length >> BlockCodec.CODEC_SHIFT
+        data_length &= (1 << BlockCodec.CODEC_SHIFT) - 1
+        articles = BlockCodec.decompress(f.read(data_length), codec, DecompressData)
+        blocks.append((sizes, articles, codec & BlockCodec.CODEC_MASK))
+    f.close()
+    return blocks
+
+
+def measure(blocks, interval, codec):
+    """compressed bytes and [(decoded bytes, seconds)...] for each article"""
+    compressed = 0
+    costs = []
+    for sizes, articles, block_codec in blocks:
+        this_codec = block_codec if codec is None else codec
+        starts = BlockCodec.segment_starts(sizes, interval)
+        flags, c = BlockCodec.compress(articles, this_codec, starts, CompressData)
+        compressed += len(c)
+
+        seconds = {}
+        for start, data in BlockCodec.segments(c, flags):
+            t = time.time()
+            decoded = BlockCodec.decompress_one(data, flags, DecompressData)
+            seconds[start] = (time.time() - t) / max(len(decoded), 1)
+
+        offset = 0
+        for size in sizes:
+            start = max(s for s in starts if s <= offset)
+            decoded = offset + size - start
+            costs.append((decoded, decoded * seconds[start]))
+            offset += size
+    return compressed, costs
+
+
+def main():
+    global verbose
+
+    try:
+        opts, args = getopt.getopt(sys.argv[1:],
+                                   'hvd:i:c:b:',
+                                   ['help',
+                                    'verbose',
+                                    'dir=',
+                                    'intervals=',
+                                    'codec=',
+                                    'blocks=',
+                                    ])
+    except getopt.GetoptError as err:
+        usage(err)
+
+    verbose = False
+    dir = 'image/enpedia'
+    intervals = [0, 8192, 16384, 32768, 65536, 131072]
+    codec = None
+    limit = 100
+
+    for opt, arg in opts:
+        if opt in ('-v', '--verbose'):
+            verbose = True
+        elif opt in ('-h', '--help'):
+            usage(None)
+        elif opt in ('-d', '--dir'):
+            dir = arg
+        elif opt in ('-i', '--intervals'):
+            try:
+                intervals = [int(i) for i in arg.split(',')]
+            except ValueError:
+                usage('"{0:s}={1:s}" is not a list of numbers'.format(opt, arg))
+        elif opt in ('-c', '--codec'):
+            try:
+                codec = BlockCodec.CODECS[arg.lower()]
+            except KeyError:
+                usage('"{0:s}={1:s}" is not one of: {2:s}'.format(opt, arg, ', '.join(sorted(BlockCodec.CODECS.keys()))))
+        elif opt in ('-b', '--blocks'):
+            try:
+                limit = int(arg)
+            except ValueError:
+                usage('"{0:s}={1:s}" is not numeric'.format(opt, arg))
+        else:
+            usage('unhandled option: ' + opt)
+
+    if not os.path.isdir(dir):
+        usage('{0:s} is not a directory'.format(dir))
+
+    blocks = []
+    file_number = 0
+    while os.path.isfile(os.path.join(dir, 'wiki{0:d}.dat'.format(file_number))):
+        blocks += read_blocks(os.path.join(dir, 'wiki{0:d}.dat'.format(file_number)), limit)
+        file_number += 1
+    if [] == blocks:
+        usage('no wiki?.dat files in: {0:s}'.format(dir))
+
+    uncompressed = sum(len(articles) for sizes, articles, block_codec in blocks)
+    PrintLog.message('Blocks = {0:n}  Articles = {1:n}  Bytes = {2:n}'
+                     .format(len(blocks), sum(len(sizes) for sizes, articles, block_codec in blocks), uncompressed))
+    PrintLog.message('')
+    PrintLog.message('{0:>10s}  {1:>12s} {2:>7s} {3:>7s}  {4:>10s} {5:>10s} {6:>10s}  {7:>9s} {8:>9s}'
+                     .format('Interval', 'Compressed', 'Ratio', 'Size', 'Mean', 'p90', 'Max', 'Mean ms', 'p90 ms'))
+
+    base = None
+    for interval in intervals:
+        compressed, costs = measure(blocks, interval, codec)
+        if base is None:
+            base = compressed
+        decoded = sorted(d for d, s in costs)
+        seconds = sorted(s for d, s in costs)
+        p90 = (len(costs) * 9 + 9) / 10 - 1
+        PrintLog.message('{0:10n}  {1:12n} {2:7.3f} {3:6.1f}%  {4:10n} {5:10n} {6:10n}  {7:9.3f} {8:9.3f}'
+                         .format(interval, compressed, float(compressed) / uncompressed,
+                                 100.0 * compressed / base,
+                                 sum(decoded) / len(decoded), decoded[p90], decoded[-1],
+                                 1000.0 * sum(seconds) / len(seconds), 1000.0 * seconds[p90]))
+
+
+# run the program
+if __name__ == "__main__":
+    main()
@@ -79,6 +79,7 @@ class SegmentedFileReader(object):
                 self.file_number = i - 1
                 self.open_next()
                 self.file.seek(offset)
+                self.current_position = position
                 return
 
 
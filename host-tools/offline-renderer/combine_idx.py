@@ -17,6 +17,16 @@ import PrintLog
 UINT32_SIZE = 4
 INDEX_ITEM_SIZE = 2 * UINT32_SIZE + 1
 
+# wiki.rnd layout (see wiki/search_rnd.h): the article numbers with a title, i.e. the ones
+# random_article() may pick, as a bitmap with the rank of each superblock:
+#   header
+#   (superblocks + 1) * [uint32_t] - articles with a title before each superblock, then the total
+#   bitmap - bit (n - 1) % 32 of uint32_t (n - 1) / 32 is set for article n
+RND_MAGIC = 0x31444e52 # 'RND1'
+RND_VERSION = 1
+RND_HEADER_STRUCT = '<7I'
+RND_SUPERBLOCK_BITS = 512
+
 def usage(message):
     if None != message:
         print('error: {0:s}'.format(message))
@@ -25,6 +35,7 @@ def usage(message):
     print('       --verbose               Enable verbose output')
     print('       --prefix=name           Directory and file name portion for .idx-tmp files [pedia]')
     print('       --output=name              Directory and file name portion for .idx file [pedia.idx]')
+    print('       --random=name           Directory and file name portion for .rnd file [pedia.rnd]')
     exit(1)
 
 def main():
@@ -33,13 +44,14 @@ def main():
     global UINT32_SIZE
 
     try:
-        opts, args = getopt.getopt(sys.argv[1:], 'hvo:f:p:', ['help', 'verbose', 'output=', 'prefix='])
+        opts, args = getopt.getopt(sys.argv[1:], 'hvo:f:p:r:', ['help', 'verbose', 'output=', 'prefix=', 'random='])
     except getopt.GetoptError as err:
         usage(err)
 
     verbose = False
     in_format = 'pedia{0:d}.idx-tmp'
     out_name = 'pedia.idx'
+    rnd_name = 'pedia.rnd'
 
     for opt, arg in opts:
         if opt in ('-v', '--verbose'):
@@ -50,6 +62,8 @@ def main():
             in_format = arg + '{0:d}.idx-tmp'
         elif opt in ('-o', '--output'):
             out_name = arg
+        elif opt in ('-r', '--random'):
+            rnd_name = arg
         else:
             usage('unhandled option: ' + opt)
 
@@ -77,6 +91,38 @@ def main():
 
     PrintLog.message('Combined {0:d} files'.format(i))
 
+    output_rnd(rnd_name, [data[j] for j in range(i)], article_count)
+
+
+def output_rnd(filename, data, article_count):
+    """output the rank/select bitmap of the articles with a title"""
+
+    words = [0] * ((article_count + RND_SUPERBLOCK_BITS - 1) // RND_SUPERBLOCK_BITS * RND_SUPERBLOCK_BITS // 32)
+    n = 0
+    for d in data:
+        for offset in range(0, len(d) - INDEX_ITEM_SIZE + 1, INDEX_ITEM_SIZE):
+            (offset_dat, offset_fnd, file_id) = struct.unpack('<2IB', d[offset:offset + INDEX_ITEM_SIZE])
+            if 0 != offset_fnd:
+                words[n // 32] |= 1 << (n % 32)
+            n += 1
+
+    words_per_superblock = RND_SUPERBLOCK_BITS // 32
+    ranks = [0]
+    for i in range(0, len(words), words_per_superblock):
+        ranks.append(ranks[-1] + sum(bin(w).count('1') for w in words[i:i + words_per_superblock]))
+
+    offset_ranks = struct.calcsize(RND_HEADER_STRUCT)
+    offset_bits = offset_ranks + len(ranks) * UINT32_SIZE
+
+    out = open(filename, 'wb')
+    out.write(struct.pack(RND_HEADER_STRUCT, RND_MAGIC, RND_VERSION, article_count, ranks[-1],
+                          RND_SUPERBLOCK_BITS, offset_ranks, offset_bits))
+    out.write(struct.pack('<{0:d}I'.format(len(ranks)), *ranks))
+    out.write(struct.pack('<{0:d}I'.format(len(words)), *words))
+    out.close()
+
+    PrintLog.message('Random articles: {0:d} of {1:d}'.format(ranks[-1], article_count))
+
 
 # run the program
 if __name__ == "__main__":
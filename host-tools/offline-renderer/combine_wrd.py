@@ -0,0 +1,179 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# COPYRIGHT: Openmoko Inc. 2010
+# LICENSE: GPL Version 3 or later
+# DESCRIPTION: Combine the article words from rendering to build the full text index
+# AUTHORS: Sean Moss-Pultz <sean@openmoko.com>
+#          Christopher Hall <hsw@openmoko.com>
+
+import os
+import sys
+import os.path
+import struct
+import getopt
+import array
+import PrintLog
+
+
+# wiki.wrd layout (see wiki/search_wrd.h):
+#   header
+#   postings of each term: article numbers in ascending order
+#       df <= POSTINGS_PER_SKIP: varint first, varint deltas...
+#       otherwise: skip table of (first article, offset of group) then groups of
+#                  POSTINGS_PER_SKIP articles, each group as varint deltas after its first article
+#   term blocks: TERM_BLOCK_SIZE bytes each, entries of
+#       shared prefix length(1), suffix length(1), suffix, varint df, varint postings offset
+#       the rest of the block is zero
+#   term index: first term of each term block padded to TERM_INDEX_ENTRY_SIZE
+
+WRD_MAGIC = 0x31445257 # 'WRD1'
+WRD_VERSION = 1
+HEADER_STRUCT = '<8I'
+TERM_BLOCK_SIZE = 4096
+TERM_INDEX_ENTRY_SIZE = 16 # maximum word length + '\0'
+POSTINGS_PER_SKIP = 128
+
+
+def usage(message):
+    if None != message:
+        print('error: {0:s}'.format(message))
+    print('usage: {0:s} <options>'.format(os.path.basename(__file__)))
+    print('       --help                  This message')
+    print('       --verbose               Enable verbose output')
+    print('       --prefix=name           Directory and file name portion for .wrd-tmp files [pedia]')
+    print('       --output=name           Directory and file name portion for .wrd file [pedia.wrd]')
+    exit(1)
+
+
+def main():
+    global verbose
+
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'hvo:p:', ['help', 'verbose', 'output=', 'prefix='])
+    except getopt.GetoptError as err:
+        usage(err)
+
+    verbose = False
+    in_format = 'pedia{0:d}.wrd-tmp'
+    out_name = 'pedia.wrd'
+
+    for opt, arg in opts:
+        if opt in ('-v', '--verbose'):
+            verbose = True
+        elif opt in ('-h', '--help'):
+            usage(None)
+        elif opt in ('-p', '--prefix'):
+            in_format = arg + '{0:d}.wrd-tmp'
+        elif opt in ('-o', '--output'):
+            out_name = arg
+        else:
+            usage('unhandled option: ' + opt)
+
+    postings = {}
+    i = 0
+    while True:
+        in_name = in_format.format(i)
+        if not os.path.isfile(in_name):
+            break
+        if verbose:
+            PrintLog.message('combining: {0:s}'.format(in_name))
+        for line in open(in_name, 'rb'):
+            fields = line.split()
+            if [] == fields:
+                continue
+            article_number = int(fields[0])
+            for word in fields[1:]:
+                if word not in postings:
+                    postings[word] = array.array('I')
+                postings[word].append(article_number)
+        i += 1
+
+    write_index(out_name, postings)
+
+    PrintLog.message('Combined {0:d} files, {1:d} words'.format(i, len(postings)))
+
+
+def varint(n):
+    """little endian base 128"""
+    result = ''
+    while n >= 0x80:
+        result += chr((n & 0x7f) | 0x80)
+        n >>= 7
+    return result + chr(n)
+
+
+def encode_postings(articles):
+    """delta encoded article numbers with a skip table for long lists"""
+    if len(articles) <= POSTINGS_PER_SKIP:
+        data = [varint(articles[0])]
+        for j in range(1, len(articles)):
+            data.append(varint(articles[j] - articles[j - 1]))
+        return ''.join(data)
+
+    skips = []
+    groups = []
+    length = 0
+    for g in range(0, len(articles), POSTINGS_PER_SKIP):
+        skips.append(struct.pack('<2I', articles[g], length))
+        group = ''.join(varint(articles[j] - articles[j - 1])
+                        for j in range(g + 1, min(g + POSTINGS_PER_SKIP, len(articles))))
+        groups.append(group)
+        length += len(group)
+    return ''.join(skips) + ''.join(groups)
+
+
+def shared_length(s1, s2):
+    n = 0
+    while n < len(s1) and n < len(s2) and s1[n] == s2[n]:
+        n += 1
+    return n
+
+
+def write_index(filename, postings):
+    out = open(filename, 'wb')
+    out.write(struct.pack(HEADER_STRUCT, *([0] * 8)))
+
+    terms = sorted(postings.keys())
+    offsets = {}
+    for term in terms:
+        articles = sorted(set(postings[term]))
+        postings[term] = len(articles)
+        offsets[term] = out.tell()
+        out.write(encode_postings(articles))
+
+    offset_term_blocks = (out.tell() + TERM_BLOCK_SIZE - 1) // TERM_BLOCK_SIZE * TERM_BLOCK_SIZE
+    out.write('\0' * (offset_term_blocks - out.tell()))
+
+    index = []
+    block = ''
+    previous = ''
+    for term in terms:
+        if '' == block:
+            previous = ''
+        shared = shared_length(previous, term)
+        entry = chr(shared) + chr(len(term) - shared) + term[shared:] + varint(postings[term]) + varint(offsets[term])
+        if len(block) + len(entry) > TERM_BLOCK_SIZE - 2: # always leave the end marker
+            out.write(block + '\0' * (TERM_BLOCK_SIZE - len(block)))
+            block = ''
+            shared = 0
+            entry = chr(0) + chr(len(term)) + term + varint(postings[term]) + varint(offsets[term])
+        if '' == block:
+            index.append(term)
+        block += entry
+        previous = term
+    if '' != block:
+        out.write(block + '\0' * (TERM_BLOCK_SIZE - len(block)))
+
+    offset_term_index = out.tell()
+    for term in index:
+        out.write((term + '\0' * TERM_INDEX_ENTRY_SIZE)[:TERM_INDEX_ENTRY_SIZE])
+
+    out.seek(0)
+    out.write(struct.pack(HEADER_STRUCT, WRD_MAGIC, WRD_VERSION, len(terms), len(index),
+                          offset_term_blocks, TERM_BLOCK_SIZE, offset_term_index, POSTINGS_PER_SKIP))
+    out.close()
+
+
+# run the program
+if __name__ == "__main__":
+    main()
@@ -98,6 +98,27 @@ typedef struct font_bmf_ex{
        INT32  pos;
 }font_bmf_ex;
 
+
+/* compact font, see wiki/bmf.h */
+#define BMF_COMPACT_MAGIC 0x464d4243
+#define BMF_COMPACT_NONE 0xFFFF
+#define BMF_COMPACT_METRICS_LEN 8
+typedef struct __attribute__((packed)) bmf_compact_header{
+       uint32_t magic;
+       INT8   linespace;
+       INT8   ascent;
+       INT8   descent;
+       INT8   reserved;
+       INT32  default_char;
+       uint32_t char_count;
+       uint32_t page_count;
+       uint32_t offset_glyphs;
+}bmf_compact_header;
+typedef struct __attribute__((packed)) bmf_compact_page{
+       uint32_t offset;
+       uint16_t glyph[256];
+}bmf_compact_page;
+
 #ifdef DEBUG
 static void dump_Fmetrics(pcffont_t *);
 #endif
@@ -637,6 +658,137 @@ void Generate_new_font_with_header(pcffont_t *font, char *bmf_filename)
     free(buf);
 }
 
+/* rewrite a bmf font as a compact font: only the glyphs that are present, addressed by a page table */
+int Generate_compact_font(char *bmf_filename, char *out_filename)
+{
+    FILE *fd;
+    char *buf;
+    long size;
+    int i, j;
+    int count;
+    int page_count = 0;
+    int dir_count;
+    int glyph_len = 0;
+    int bitmap_len;
+    uint16_t *page_dir;
+    bmf_compact_page *pages;
+    char *glyphs;
+    font_bmf_header header;
+    bmf_compact_header compact_header;
+    font_bmf *glyph;
+
+    fd = fopen(bmf_filename, "rb");
+    if (NULL == fd)
+    {
+	printf("Failed to open bmf font: %s\n", bmf_filename);
+	return -1;
+    }
+    fseek(fd, 0, SEEK_END);
+    size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    if (size < (long)sizeof(font_bmf_header))
+    {
+	printf("Too short bmf font: %s\n", bmf_filename);
+	fclose(fd);
+	return -1;
+    }
+    buf = malloc(size);
+    if (!buf || fread(buf, size, 1, fd) != 1)
+    {
+	printf("Fail to read bmf font: %s\n", bmf_filename);
+	free(buf);
+	fclose(fd);
+	return -1;
+    }
+    fclose(fd);
+    memcpy(&header, buf, sizeof(header));
+    count = (size - sizeof(font_bmf_header)) / sizeof(font_bmf);
+    dir_count = (count + 255) / 256;
+
+    page_dir = malloc(dir_count * sizeof(uint16_t));
+    pages = calloc(dir_count, sizeof(bmf_compact_page));
+    glyphs = malloc(count * sizeof(font_bmf));
+    if (!page_dir || !pages || !glyphs)
+    {
+	printf("Fail to allocate buffers for %d characters\n", count);
+	free(buf);
+	free(page_dir);
+	free(pages);
+	free(glyphs);
+	return -1;
+    }
+
+    /* a glyph is present if any of its metrics is set, e.g. a space has only widthDevice */
+    for (i = 0; i < dir_count; i++)
+    {
+	page_dir[i] = BMF_COMPACT_NONE;
+	for (j = 0; j < 256; j++)
+	{
+	    static const char zero[BMF_COMPACT_METRICS_LEN];
+
+	    pages[page_count].glyph[j] = BMF_COMPACT_NONE;
+	    if (i * 256 + j >= count)
+		continue;
+	    glyph = (font_bmf *)(buf + sizeof(font_bmf_header) + (i * 256 + j) * sizeof(font_bmf));
+	    if (!memcmp(glyph, zero, BMF_COMPACT_METRICS_LEN))
+		continue;
+	    if (page_dir[i] == BMF_COMPACT_NONE)
+	    {
+		page_dir[i] = page_count;
+		pages[page_count].offset = glyph_len;
+	    }
+	    pages[page_count].glyph[j] = glyph_len - pages[page_count].offset;
+	    bitmap_len = 0;
+	    if (glyph->width > 0 && glyph->widthBytes > 0 && glyph->height > 0)
+		bitmap_len = glyph->widthBytes * glyph->height;
+	    if (bitmap_len > (int)sizeof(glyph->bitmap))
+		bitmap_len = sizeof(glyph->bitmap);
+	    memcpy(glyphs + glyph_len, glyph, BMF_COMPACT_METRICS_LEN + bitmap_len);
+	    glyph_len += BMF_COMPACT_METRICS_LEN + bitmap_len;
+	}
+	if (page_dir[i] != BMF_COMPACT_NONE)
+	    page_count++;
+    }
+
+    memset(&compact_header, 0, sizeof(compact_header));
+    compact_header.magic = BMF_COMPACT_MAGIC;
+    compact_header.linespace = header.linespace;
+    compact_header.ascent = header.ascent;
+    compact_header.descent = header.descent;
+    compact_header.default_char = header.default_char;
+    compact_header.char_count = count;
+    compact_header.page_count = page_count;
+    compact_header.offset_glyphs = sizeof(compact_header) + dir_count * sizeof(uint16_t) +
+	page_count * sizeof(bmf_compact_page);
+
+    fd = fopen(out_filename, "wb");
+    if (NULL == fd ||
+	fwrite(&compact_header, sizeof(compact_header), 1, fd) != 1 ||
+	fwrite(page_dir, sizeof(uint16_t), dir_count, fd) != (size_t)dir_count ||
+	fwrite(pages, sizeof(bmf_compact_page), page_count, fd) != (size_t)page_count ||
+	fwrite(glyphs, 1, glyph_len, fd) != (size_t)glyph_len)
+    {
+	printf("Fail to write compact font: %s\n", out_filename);
+	if (fd)
+	    fclose(fd);
+	free(buf);
+	free(page_dir);
+	free(pages);
+	free(glyphs);
+	return -1;
+    }
+    fclose(fd);
+    printf("%s: %d characters, %d pages, %ld resident bytes, %ld bytes (was %ld)\n", out_filename, count, page_count,
+	   (long)(dir_count * sizeof(uint16_t) + page_count * sizeof(bmf_compact_page)),
+	   (long)compact_header.offset_glyphs + glyph_len, size);
+
+    free(buf);
+    free(page_dir);
+    free(pages);
+    free(glyphs);
+    return 0;
+}
+
 void
 scaling_factors(pcffont_t *font, double ptsz, int Xres, int Yres)
 {
@@ -9,6 +9,7 @@
 char sOutFilename[256];
 int  nFontCount = 65535;
 int nAddGap = 0;
+int bCompact = 0;
 
 static void help(void)
 {
@@ -19,6 +20,7 @@ static void help(void)
 		"  -c --count\t\t\tgenerate font count\n"
 		"  -g --gap\t\t\tadd 1 pixel to the right of each character\n"
 		"  -m --merge\t\tbase bmf file name for the pcf file to be merged into\n"
+		"  -C --compact\t\t\twrite the bmf file given by --merge as a compact font to --output\n"
 		);
 }
 
@@ -29,6 +31,7 @@ static struct option opts[] = {
 	{ "count", 1, 0, 'c' },
 	{ "gap", 0, 0, 'g' },
 	{ "merge", 1, 0, 'm' },
+	{ "compact", 0, 0, 'C' },
 	{ NULL, 0, NULL, 0 }
 };
 
@@ -50,7 +53,7 @@ int main(int argc, char *argv[])
 	memset(sBmfFilename, 0, sizeof(sBmfFilename));
 	memset(sOutFilename, 0, sizeof(sOutFilename));
 
-	while((oc=getopt_long(argc,argv,"hf:m:n:o:c:gpq", opts, NULL))!=-1)
+	while((oc=getopt_long(argc,argv,"hf:m:n:o:c:gpqC", opts, NULL))!=-1)
 	{
 		switch (oc) {
 		case 'h':
@@ -75,13 +78,25 @@ int main(int argc, char *argv[])
 		case 'g':
 			nAddGap = 1;
 			break;
+		case 'C':
+			bCompact = 1;
+			break;
 		default:
 			help();
 			exit(2);
 		}
 	}
 
-	if (sPcfFilename[0])
+	if (bCompact)
+	{
+		if (!sBmfFilename[0] || !sOutFilename[0])
+		{
+			fprintf(stdout,"--compact needs --merge and --output\n");
+			return -1;
+		}
+		return Generate_compact_font(sBmfFilename, sOutFilename) < 0 ? -1 : 0;
+	}
+	else if (sPcfFilename[0])
 	{
 		pcfFont.file = sPcfFilename;
 		if (load_pcf(&pcfFont, sBmfFilename) >= 0)
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// POSIX implementation of the part of the grifo API used by the search code
+// (see samo-lib/grifo/simulator/api.cpp for the full simulation)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <grifo.h>
+
+#include "grifo_posix.h"
+
+GRIFO_IO_STATS grifo_io_stats;
+
+uint64_t grifo_posix_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+void panic(const char *format, ...)
+{
+	va_list arguments;
+
+	va_start(arguments, format);
+	fprintf(stderr, "PANIC: ");
+	vfprintf(stderr, format, arguments);
+	va_end(arguments);
+	exit(1);
+}
+
+void debug_print(const char *message)
+{
+	fputs(message, stderr);
+}
+
+int debug_printf(const char *format, ...)
+{
+	va_list arguments;
+	int rc;
+
+	va_start(arguments, format);
+	rc = vfprintf(stderr, format, arguments);
+	va_end(arguments);
+	return rc;
+}
+
+void delay_us(unsigned long microseconds)
+{
+	(void)microseconds;
+}
+
+// 60 ticks per microsecond, as the device timer
+unsigned long timer_get(void)
+{
+	return (unsigned long)(grifo_posix_time_us() * 60);
+}
+
+// a replayed keystroke is never interrupted by the next one
+event_item_t event_peek(event_t *event)
+{
+	(void)event;
+	return EVENT_NONE;
+}
+
+event_item_t event_get(event_t *event)
+{
+	(void)event;
+	return EVENT_NONE;
+}
+
+
+file_error_t file_size(const char *filename, unsigned long *length)
+{
+	struct stat sb;
+
+	if (0 != stat(filename, &sb))
+	{
+		return FILE_ERROR_DENIED;
+	}
+	*length = sb.st_size;
+	return FILE_ERROR_OK;
+}
+
+file_error_t file_open(const char *filename, file_access_t fam)
+{
+	int fd;
+
+	if (0 != (fam & (FILE_OPEN_WRITE | FILE_OPEN_CREATE | FILE_OPEN_TRUNCATE)))
+	{
+		return FILE_ERROR_DENIED;	// the wiki files are read only
+	}
+	fd = open(filename, O_RDONLY);
+	return -1 == fd ? FILE_ERROR_DENIED : (file_error_t)fd;
+}
+
+file_error_t file_close(int handle)
+{
+	close(handle);
+	return FILE_ERROR_OK;
+}
+
+ssize_t file_read(int handle, void *buffer, size_t length)
+{
+	ssize_t rc = read(handle, buffer, length);
+
+	grifo_io_stats.reads++;
+	if (rc > 0)
+	{
+		grifo_io_stats.bytes += rc;
+	}
+	return rc;
+}
+
+file_error_t file_lseek(int handle, unsigned long pos)
+{
+	off_t rc = lseek(handle, pos, SEEK_SET);
+
+	grifo_io_stats.seeks++;
+	return (off_t)-1 == rc ? FILE_ERROR_DENIED : FILE_ERROR_OK;
+}
+
+
+void *memory_allocate(size_t size, const char *tag)
+{
+	if (0 == size)
+	{
+		panic("memory_allocate zero bytes: %s\n", tag);
+	}
+	return malloc(size);
+}
+
+void memory_free(void *address, const char *tag)
+{
+	(void)tag;
+	free(address);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRIFO_POSIX_H
+#define GRIFO_POSIX_H
+
+#include <inttypes.h>
+
+// counters of the grifo file calls made by the wiki code
+typedef struct _GRIFO_IO_STATS {
+	unsigned long reads;	// file_read calls
+	unsigned long seeks;	// file_lseek calls
+	uint64_t bytes;		// bytes returned by file_read
+} GRIFO_IO_STATS;
+
+extern GRIFO_IO_STATS grifo_io_stats;
+
+// wall clock in microseconds
+uint64_t grifo_posix_time_us(void);
+
+#endif
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replay keystrokes against the search code of the wiki application and the wiki.* files
+// of one wiki, then report the latency and the file access as JSON on stdout.
+//
+// keys file: one search per line, typed from an empty search string
+//            '<' is a backspace, the other characters are added to the search string
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <grifo.h>
+
+#include "search.h"
+#include "search_fnd.h"
+#include "lcd_buf_draw.h"
+#include "wiki_info.h"
+#include "grifo_posix.h"
+
+
+static struct option opts[] = {
+	{ "help", 0, 0, 'h' },
+	{ "verbose", 0, 0, 'v' },
+	{ "data", 1, 0, 'd' },
+	{ "keys", 1, 0, 'k' },
+	{ "seek-latency", 1, 0, 'l' },
+	{ "scroll", 1, 0, 's' },
+	{ "prefetch", 0, 0, 'p' },
+	{ "trace", 1, 0, 't' },
+	{ NULL, 0, NULL, 0 }
+};
+
+bool verbose = false;
+
+extern unsigned char *file_buffer;
+
+typedef struct _LATENCY {
+	uint64_t *samples;	// microseconds
+	size_t count;
+	size_t size;
+} LATENCY;
+
+typedef struct _IO_TOTAL {
+	unsigned long reads;
+	unsigned long seeks;
+	uint64_t bytes;
+} IO_TOTAL;
+
+static const char *data_directory = ".";
+static char file_path[1024];
+static unsigned long seek_latency = 0;	// microseconds added for each file_lseek
+
+static LATENCY keystroke_latency;
+static LATENCY scroll_latency;
+static IO_TOTAL foreground;
+static IO_TOTAL background;
+static BLOCK_CACHE_STATS fnd_cache_foreground;
+static FILE *trace = NULL;
+
+
+// the only wiki is the one in the data directory
+int nCurrentWiki = 0;
+
+int get_wiki_count(void)
+{
+	return 1;
+}
+
+char *get_wiki_file_path(int nWikiIdx, char *file_name)
+{
+	(void)nWikiIdx;
+	snprintf(file_path, sizeof(file_path), "%s/%s", data_directory, file_name);
+	return file_path;
+}
+
+int get_wiki_idx_from_id(int wiki_id)
+{
+	(void)wiki_id;
+	return 0;
+}
+
+int get_wiki_id_from_idx(unsigned int wiki_idx)
+{
+	(void)wiki_idx;
+	return 1;
+}
+
+const unsigned char *get_nls_text(const char *key)
+{
+	return (const unsigned char *)key;
+}
+
+bool wiki_keyboard_conversion_needed()
+{
+	return false;
+}
+
+bool wiki_is_korean()
+{
+	return false;
+}
+
+
+static void usage(const char *message)
+{
+	if (NULL != message)
+	{
+		fprintf(stderr, "error: %s\n", message);
+	}
+	fprintf(stderr, "usage: %s <options>\n"
+		"      --help              this message\n"
+		"      --verbose           message output\n"
+		"      --data=dir          directory of the wiki.pfx, wiki.fnd and wiki.idx files [.]\n"
+		"      --keys=file         searches to replay, one per line, '<' is a backspace [stdin]\n"
+		"      --seek-latency=us   simulated SD card latency added for each seek [0]\n"
+		"      --scroll=n          titles read past the first page at the end of each search [0]\n"
+		"      --prefetch          read ahead between keystrokes as the idle loop does\n"
+		"      --trace=file        CSV of every keystroke\n",
+		"search-bench");
+	exit(1);
+}
+
+
+static void latency_add(LATENCY *latency, uint64_t us)
+{
+	if (latency->count >= latency->size)
+	{
+		latency->size = latency->size ? latency->size * 2 : 1024;
+		latency->samples = realloc(latency->samples, latency->size * sizeof(latency->samples[0]));
+		if (NULL == latency->samples)
+		{
+			fprintf(stderr, "error: out of memory\n");
+			exit(1);
+		}
+	}
+	latency->samples[latency->count++] = us;
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// nearest rank, samples must be sorted
+static uint64_t latency_percentile(const LATENCY *latency, unsigned int percent)
+{
+	size_t rank;
+
+	if (0 == latency->count)
+	{
+		return 0;
+	}
+	rank = (latency->count * percent + 99) / 100;
+	return latency->samples[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_latency(const char *name, LATENCY *latency)
+{
+	uint64_t total = 0;
+	size_t i;
+
+	qsort(latency->samples, latency->count, sizeof(latency->samples[0]), compare_samples);
+	for (i = 0; i < latency->count; i++)
+	{
+		total += latency->samples[i];
+	}
+	printf("  \"%s\": {\"count\": %lu, \"mean\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu},\n",
+	       name, (unsigned long)latency->count,
+	       (unsigned long long)(latency->count ? total / latency->count : 0),
+	       (unsigned long long)latency_percentile(latency, 50),
+	       (unsigned long long)latency_percentile(latency, 90),
+	       (unsigned long long)latency_percentile(latency, 99),
+	       (unsigned long long)(latency->count ? latency->samples[latency->count - 1] : 0));
+}
+
+static void print_io(const char *name, const IO_TOTAL *io)
+{
+	printf("  \"%s\": {\"reads\": %lu, \"seeks\": %lu, \"bytes\": %llu},\n",
+	       name, io->reads, io->seeks, (unsigned long long)io->bytes);
+}
+
+static void print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++)
+	{
+		if ('"' == *s || '\\' == *s)
+		{
+			putchar('\\');
+		}
+		if ((unsigned char)*s >= ' ')
+		{
+			putchar(*s);
+		}
+	}
+	putchar('"');
+}
+
+
+// time the work done for one user action: the measured time plus the simulated seek latency
+typedef struct _MEASURE {
+	GRIFO_IO_STATS io;
+	BLOCK_CACHE_STATS cache;
+	uint64_t start;
+} MEASURE;
+
+static void measure_start(MEASURE *measure)
+{
+	measure->io = grifo_io_stats;
+	measure->cache = fnd_cache.stats;
+	measure->start = grifo_posix_time_us();
+}
+
+static uint64_t measure_stop(MEASURE *measure, IO_TOTAL *io)
+{
+	uint64_t us = grifo_posix_time_us() - measure->start;
+
+	measure->io.reads = grifo_io_stats.reads - measure->io.reads;
+	measure->io.seeks = grifo_io_stats.seeks - measure->io.seeks;
+	measure->io.bytes = grifo_io_stats.bytes - measure->io.bytes;
+	io->reads += measure->io.reads;
+	io->seeks += measure->io.seeks;
+	io->bytes += measure->io.bytes;
+	return us + (uint64_t)measure->io.seeks * seek_latency;
+}
+
+static void measure_cache(MEASURE *measure)
+{
+	fnd_cache_foreground.hits += fnd_cache.stats.hits - measure->cache.hits;
+	fnd_cache_foreground.misses += fnd_cache.stats.misses - measure->cache.misses;
+}
+
+
+static void replay_keystroke(unsigned long line, char c)
+{
+	MEASURE measure;
+	uint64_t us;
+
+	measure_start(&measure);
+	if ('<' == c)
+	{
+		search_remove_char(1, timer_get());
+	}
+	else
+	{
+		search_add_char(c, timer_get());
+	}
+	// the main loop fetches until the result list is complete
+	while (fetch_search_result(0, 0, 0))
+	{
+	}
+	us = measure_stop(&measure, &foreground);
+	measure_cache(&measure);
+	latency_add(&keystroke_latency, us);
+
+	if (NULL != trace)
+	{
+		fprintf(trace, "%lu,%c,%d,%llu,%lu,%lu,%llu,%u\n", line, c, get_search_string_len(),
+			(unsigned long long)us, measure.io.reads, measure.io.seeks,
+			(unsigned long long)measure.io.bytes, search_result_count());
+	}
+}
+
+static void replay_scroll(int count)
+{
+	MEASURE measure;
+	long offset_next;
+	long idxArticle;
+	unsigned char sTitleActual[MAX_TITLE_ACTUAL];
+
+	if (count <= 0 || search_result_count() < NUMBER_OF_FIRST_PAGE_RESULTS)
+	{
+		return;
+	}
+	measure_start(&measure);
+	offset_next = result_list_offset_next();
+	while (count-- > 0 && (offset_next = result_list_next_result(offset_next, &idxArticle, sTitleActual)))
+	{
+	}
+	latency_add(&scroll_latency, measure_stop(&measure, &foreground));
+	measure_cache(&measure);
+}
+
+static void replay_idle(void)
+{
+	MEASURE measure;
+
+	measure_start(&measure);
+	while (search_prefetch())
+	{
+	}
+	(void)measure_stop(&measure, &background);
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *keys_name = NULL;
+	const char *trace_name = NULL;
+	int scroll = 0;
+	bool prefetch = false;
+	FILE *keys;
+	char line[1024];
+	unsigned long nLines = 0;
+	char *p;
+
+	for (;;)
+	{
+		int c, option_index = 0;
+		c = getopt_long(argc, argv, "hvd:k:l:s:pt:", opts, &option_index);
+		if (c == -1)
+		{
+			break;
+		}
+
+		switch (c)
+		{
+		case 'h':
+			usage(NULL);
+			break;
+		case 'd':
+			data_directory = optarg;
+			break;
+		case 'k':
+			keys_name = optarg;
+			break;
+		case 'l':
+			seek_latency = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			scroll = atoi(optarg);
+			break;
+		case 'p':
+			prefetch = true;
+			break;
+		case 't':
+			trace_name = optarg;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage("invalid arguments");
+		}
+	}
+
+	if (NULL == keys_name)
+	{
+		keys = stdin;
+	}
+	else if (NULL == (keys = fopen(keys_name, "r")))
+	{
+		usage("cannot open --keys=file");
+	}
+	if (NULL != trace_name)
+	{
+		if (NULL == (trace = fopen(trace_name, "w")))
+		{
+			usage("cannot create --trace=file");
+		}
+		fprintf(trace, "line,key,search_length,us,reads,seeks,bytes,results\n");
+	}
+
+	file_buffer = malloc(FILE_BUFFER_SIZE);
+	search_init();
+
+	while (NULL != fgets(line, sizeof(line), keys))
+	{
+		nLines++;
+		clear_search_string();
+		for (p = line; '\0' != *p && '\n' != *p && '\r' != *p; p++)
+		{
+			replay_keystroke(nLines, *p);
+			if (prefetch)
+			{
+				replay_idle();
+			}
+		}
+		replay_scroll(scroll);
+		if (verbose && 0 == nLines % 1000)
+		{
+			fprintf(stderr, "replayed %lu searches\n", nLines);
+		}
+	}
+
+	printf("{\n  \"data\": ");
+	print_json_string(data_directory);
+	printf(",\n  \"searches\": %lu,\n  \"seek_latency_us\": %lu,\n", nLines, seek_latency);
+	print_latency("keystroke_us", &keystroke_latency);
+	print_latency("scroll_us", &scroll_latency);
+	print_io("foreground", &foreground);
+	print_io("background", &background);
+	printf("  \"fnd_cache\": {\"hits\": %lu, \"misses\": %lu, \"hit_ratio\": %.4f},\n",
+	       (unsigned long)fnd_cache_foreground.hits, (unsigned long)fnd_cache_foreground.misses,
+	       fnd_cache_foreground.hits + fnd_cache_foreground.misses ?
+	       (double)fnd_cache_foreground.hits / (fnd_cache_foreground.hits + fnd_cache_foreground.misses) : 0.0);
+	printf("  \"article_prefetch\": {\"decoded\": %lu, \"hits\": %lu, \"dropped\": %lu}\n}\n",
+	       (unsigned long)article_prefetch_stats.decoded, (unsigned long)article_prefetch_stats.hits,
+	       (unsigned long)article_prefetch_stats.dropped);
+
+	if (NULL != trace)
+	{
+		fclose(trace);
+	}
+	if (stdin != keys)
+	{
+		fclose(keys);
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// the parts of the wiki application referenced by search.c that have nothing to do on the host:
+// drawing, the keyboard and the per language input conversions
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <grifo.h>
+
+#include "search.h"
+#include "keyboard.h"
+#include "guilib.h"
+#include "glyph.h"
+#include "wikilib.h"
+#include "lcd_buf_draw.h"
+#include "languages.h"
+
+ARTICLE_LINK articleLink[MAX_ARTICLE_LINKS];
+int article_link_count;
+int current_article_wiki_id;
+int last_display_mode;
+int restricted_article;
+long saved_idx_article;
+unsigned char *file_buffer;
+
+
+void fatal_error_print(const char *file, int line, const char *format, ...)
+{
+	va_list arguments;
+
+	va_start(arguments, format);
+	fprintf(stderr, "FATAL: %s:%d: ", file, line);
+	vfprintf(stderr, format, arguments);
+	fprintf(stderr, "\n");
+	va_end(arguments);
+	exit(1);
+}
+
+unsigned long time_diff(unsigned long t2, unsigned long t1)
+{
+	return t2 - t1;
+}
+
+unsigned long seconds_to_ticks(float sec)
+{
+	return sec * 60000000;
+}
+
+
+void guilib_fb_lock(void) {}
+void guilib_fb_unlock(void) {}
+void guilib_clear(void) {}
+void guilib_clear_area(int start_x, int start_y, int end_x, int end_y) {}
+unsigned int guilib_framebuffer_height(void) { return LCD_HEIGHT; }
+int render_string(const int font, int off_x, int off_y, const unsigned char *string, int len, int inverted) { return 0; }
+int render_string_right(const int font, int off_x, int off_y, const unsigned char *string, int len, int inverted) { return 0; }
+void draw_logo_or_type_a_word(int clear_start_x, int clear_start_y, int clear_end_x, int clear_end_y) {}
+void clear_logo_or_type_a_word(int clear_start_x, int clear_start_y, int clear_end_x, int clear_end_y) {}
+void invert_selection(int old_pos, int new_pos, int start_pos, int height) {}
+void display_link_article(long idx_article) {}
+
+int keyboard_get_mode() { return KEYBOARD_CHAR; }
+void keyboard_paint() {}
+int keyboard_key_reset_invert(int bFlag, unsigned long ev_time) { return 0; }
+int keyboard_key_inverted(void) { return 0; }
+void flash_keyboard_key_invert() {}
+int is_korean_special_key_enabled(void) { return 0; }
+
+// only used when wiki_keyboard_conversion_needed()
+int zh_jp_to_english(unsigned char *sEnglish, int maxLenEnglish, unsigned char *sHiragana, int *lenHiragana) { return 0; }
+void hiragana_romaji_conversion(unsigned char *search_string_per_language, int *search_str_per_language_len) {}
+int replace_japanese_sonant(unsigned char *search_string_per_language, int *search_str_per_language_len, unsigned char *search_string, int *search_str_len) { return 0; }
+int replace_hiragana_backward(unsigned char *search_string_per_language, int *search_str_per_language_len, unsigned char *search_string, int *search_str_len) { return 0; }
+int english_to_korean(unsigned char *out_str, int max_out_len, unsigned char *in_str, int *in_len) { return 0; }
+int english_to_korean_phonetic(unsigned char *out_str, int max_out_len, unsigned char *in_str, int *in_len) { return 0; }
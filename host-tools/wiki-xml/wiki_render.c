@@ -4614,7 +4614,7 @@ void compress_fnd(TITLE_SEARCH *titleSearches, long nIdxCount, unsigned char *bu
 	sLastTitleActual[0] = '\0';
 	for (i=0; i < nTitleSearches; i++)
 	{
-		if (!aKeepingFullTitle[i])
+		if (!aKeepingFullTitle[i] && i % FND_RESTART_INTERVAL) // restart points keep the full title
 		{
 			j = 0;
 			while (j < 31 && sLastTitleSearch[j] && sLastTitleSearch[j] == titleSearches[i].sTitleSearch[j])
@@ -4648,7 +4648,16 @@ void save_fnd(TITLE_SEARCH *titleSearches, long nIdxCount)
 	long offset;
 	int len;
 	char sTitle[MAX_TITLE_SEARCH];
+	FND_DIRECTORY_ENTRY *fndDirectory;
+	FND_TRAILER fndTrailer;
 	
+	fndDirectory = (FND_DIRECTORY_ENTRY *)malloc(sizeof(FND_DIRECTORY_ENTRY) * (nTitleSearches / FND_RESTART_INTERVAL + 1));
+	if (!fndDirectory)
+	{
+		showMsg(0, "malloc fndDirectory error\n");
+		exit(-1);
+	}
+	fndTrailer.nEntries = 0;
 	fdOutFnd = fopen("wiki.fnd", "wb");
 
 	fwrite(&aBigram[0][0], 1, SIZE_BIGRAM_BUF, fdOutFnd);
@@ -4661,6 +4670,12 @@ void save_fnd(TITLE_SEARCH *titleSearches, long nIdxCount)
 		offset += 5;
 		bigram_encode(sTitle, titleSearches[i].sTitleSearch);
 		len = strlen(sTitle) + 1;
+		if (!(i % FND_RESTART_INTERVAL))
+		{
+			fndDirectory[fndTrailer.nEntries].offset = offset - 5;
+			strncpy(fndDirectory[fndTrailer.nEntries].key, sTitle, FND_DIRECTORY_KEY_LEN);
+			fndTrailer.nEntries++;
+		}
 		fwrite(sTitle, 1, len, fdOutFnd);
 		offset += len;
 		// Actual title cannot be bigram encoded since it can contain any UTF8 characters
@@ -4668,7 +4683,14 @@ void save_fnd(TITLE_SEARCH *titleSearches, long nIdxCount)
 		fwrite(titleSearches[i].sTitleActual, 1, len, fdOutFnd);
 		offset += len;
 	}
+	fndTrailer.offset_directory = offset;
+	fndTrailer.nRestartInterval = FND_RESTART_INTERVAL;
+	fndTrailer.version = FND_VERSION;
+	fndTrailer.magic = FND_MAGIC;
+	fwrite(fndDirectory, sizeof(FND_DIRECTORY_ENTRY), fndTrailer.nEntries, fdOutFnd);
+	fwrite(&fndTrailer, sizeof(fndTrailer), 1, fdOutFnd);
 	fclose(fdOutFnd);
+	free(fndDirectory);
 }
 
 void reorg_pfx(long *firstThreeCharIndexing, unsigned char *bufFnd, TITLE_SEARCH *titleSearches)
@@ -28,6 +28,25 @@ typedef struct _TITLE_SEARCH { /* used to mask the porinter to the remainder of
 						/* in the fnd file, it will be concatnated immediately after the null terminator of sTitleSearch */
 } TITLE_SEARCH;
 
+/* FND version 1: restart point directory and trailer after the titles (see wiki/search.h) */
+#define FND_MAGIC 0x31444e46 /* "FND1" */
+#define FND_VERSION 1
+#define FND_RESTART_INTERVAL 32
+#define FND_DIRECTORY_KEY_LEN 12
+
+typedef struct __attribute__((packed)) _FND_DIRECTORY_ENTRY {
+	uint32_t offset; /* offset of the restart record (stored uncompressed) */
+	char key[FND_DIRECTORY_KEY_LEN]; /* bigram encoded title for search, not null terminated if truncated */
+} FND_DIRECTORY_ENTRY;
+
+typedef struct __attribute__((packed)) _FND_TRAILER {
+	uint32_t offset_directory;
+	uint32_t nEntries;
+	uint32_t nRestartInterval;
+	uint32_t version;
+	uint32_t magic;
+} FND_TRAILER;
+
 void render_article_node(int idxNode);
 void process_pass_1(MYSQL *conn, char *sFileName, int msgLevel, long titlesToProcess,
 	off64_t file_offset_for_pass_1, long max_article_idx);
@@ -141,7 +141,7 @@ REQUIRED_PHP = $(eval $(call REQUIRED_PHP_1,$(strip ${1}),$(strip ${2})))
 
 LICENSES := ${ROOT_DIR}/Licenses
 
-WIKI_APP = ${ROOT_DIR}/wiki-app/
+WIKI_APP = ${ROOT_DIR}/wiki/
 WIKI_APP_INCLUDE = ${WIKI_APP}
 WIKI_APP_SRC = ${WIKI_APP}
 
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "article_cache.h"
+
+ARTICLE_CACHE_STATS article_cache_stats;
+
+static ARTICLE_BLOCK article_blocks[ARTICLE_CACHE_ENTRIES];
+static uint32_t nArticleCacheUsed;	// bytes allocated for the entries
+static uint32_t nArticleCacheClock;
+
+static uint32_t block_size(uint32_t nArticles, uint32_t len)
+{
+	return nArticles * sizeof(CONCAT_ARTICLE_INFO) + len;
+}
+
+static void block_free(PARTICLE_BLOCK pBlock)
+{
+	nArticleCacheUsed -= block_size(pBlock->nArticles, pBlock->len);
+	memory_free(pBlock->pInfos, "articlecache1");
+	pBlock->pInfos = NULL;
+	pBlock->pData = NULL;
+	pBlock->len = 0;
+}
+
+static int block_match(PARTICLE_BLOCK pBlock, uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat)
+{
+	return pBlock->len && pBlock->offset_dat == offset_dat && pBlock->file_id == file_id && pBlock->wiki_id == wiki_id;
+}
+
+// return the cached block (or segment) if the article is decoded, otherwise NULL
+// and whether part of the block is decoded already
+PARTICLE_BLOCK article_cache_get(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t article_id, int *pbHot)
+{
+	PARTICLE_BLOCK pBlock;
+	uint32_t i;
+	int j;
+
+	*pbHot = 0;
+	for (j = 0; j < ARTICLE_CACHE_ENTRIES; j++)
+	{
+		pBlock = &article_blocks[j];
+		if (!block_match(pBlock, wiki_id, file_id, offset_dat))
+			continue;
+		pBlock->last_used = ++nArticleCacheClock;
+		for (i = 0; i < pBlock->nArticles; i++)
+		{
+			if (pBlock->pInfos[i].article_id == article_id &&
+			    (pBlock->pInfos[i].offset_article & ~0x80000000) + pBlock->pInfos[i].article_len <= pBlock->len)
+			{
+				article_cache_stats.hits++;
+				return pBlock;
+			}
+		}
+		*pbHot = 1;
+	}
+	article_cache_stats.misses++;
+	return NULL;
+}
+
+// as article_cache_get() but leaves the statistics and the age of the blocks as they are
+// (for the read ahead, which is not a use of the block)
+PARTICLE_BLOCK article_cache_peek(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t article_id, int *pbHot)
+{
+	PARTICLE_BLOCK pBlock;
+	uint32_t i;
+	int j;
+
+	*pbHot = 0;
+	for (j = 0; j < ARTICLE_CACHE_ENTRIES; j++)
+	{
+		pBlock = &article_blocks[j];
+		if (!block_match(pBlock, wiki_id, file_id, offset_dat))
+			continue;
+		for (i = 0; i < pBlock->nArticles; i++)
+		{
+			if (pBlock->pInfos[i].article_id == article_id &&
+			    (pBlock->pInfos[i].offset_article & ~0x80000000) + pBlock->pInfos[i].article_len <= pBlock->len)
+				return pBlock;
+		}
+		*pbHot = 1;
+	}
+	return NULL;
+}
+
+// a block of this size would be kept
+int article_cache_fits(uint32_t nArticles, uint32_t len)
+{
+	return len && block_size(nArticles, len) <= ARTICLE_CACHE_BUDGET;
+}
+
+void article_cache_add(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t segment,
+		       uint32_t nArticles, const CONCAT_ARTICLE_INFO *pInfos, const unsigned char *pData, uint32_t len)
+{
+	PARTICLE_BLOCK pBlock;
+	uint32_t size = block_size(nArticles, len);
+	int idxOldest;
+	int i;
+
+	if (!article_cache_fits(nArticles, len))
+		return;
+	// replaces the part of the block decoded before
+	for (i = 0; i < ARTICLE_CACHE_ENTRIES; i++)
+	{
+		if (block_match(&article_blocks[i], wiki_id, file_id, offset_dat) && article_blocks[i].segment == segment)
+			block_free(&article_blocks[i]);
+	}
+
+	// make room: a free entry and enough of the budget
+	for (;;)
+	{
+		idxOldest = -1;
+		pBlock = NULL;
+		for (i = 0; i < ARTICLE_CACHE_ENTRIES; i++)
+		{
+			if (!article_blocks[i].len)
+				pBlock = &article_blocks[i];
+			else if (idxOldest < 0 || article_blocks[i].last_used < article_blocks[idxOldest].last_used)
+				idxOldest = i;
+		}
+		if (pBlock && nArticleCacheUsed + size <= ARTICLE_CACHE_BUDGET)
+			break;
+		block_free(&article_blocks[idxOldest]);
+		article_cache_stats.evictions++;
+	}
+
+	pBlock->pInfos = (CONCAT_ARTICLE_INFO *)memory_allocate(size, "articlecache1");
+	if (!pBlock->pInfos)
+		return;
+	pBlock->pData = (unsigned char *)&pBlock->pInfos[nArticles];
+	memcpy(pBlock->pInfos, pInfos, nArticles * sizeof(CONCAT_ARTICLE_INFO));
+	memcpy(pBlock->pData, pData, len);
+	pBlock->wiki_id = wiki_id;
+	pBlock->file_id = file_id;
+	pBlock->offset_dat = offset_dat;
+	pBlock->segment = segment;
+	pBlock->nArticles = nArticles;
+	pBlock->len = len;
+	pBlock->last_used = ++nArticleCacheClock;
+	nArticleCacheUsed += size;
+}
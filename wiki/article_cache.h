@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARTICLE_CACHE_H
+#define ARTICLE_CACHE_H
+
+#include <inttypes.h>
+
+#include "lcd_buf_draw.h"
+
+// Decoded wiki?.dat blocks (the concatenated articles of one LZMA stream) keyed by
+// (wiki id, dat file id, block offset, segment), least recently used dropped first.
+// A block with seek points has an entry for each of its segments that was read, the offsets
+// of the articles in it are from the start of the segment; a block without them is segment 0.
+// A block is kept decoded up to the end of the article read, the whole block is only decoded
+// once another article of it is read (i.e. the block is hot). A budget of zero disables the cache.
+#define ARTICLE_CACHE_BUDGET (1024 * 1024)	// bytes of decoded articles
+#define ARTICLE_CACHE_ENTRIES 8
+
+typedef struct _ARTICLE_BLOCK {
+	uint32_t wiki_id;
+	uint32_t file_id;
+	uint32_t offset_dat;
+	uint32_t segment;
+	uint32_t nArticles;
+	CONCAT_ARTICLE_INFO *pInfos;
+	unsigned char *pData;
+	uint32_t len;		// bytes decoded, 0 if the entry is unused
+	uint32_t last_used;
+} ARTICLE_BLOCK, *PARTICLE_BLOCK;
+
+typedef struct _ARTICLE_CACHE_STATS {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+} ARTICLE_CACHE_STATS;
+
+extern ARTICLE_CACHE_STATS article_cache_stats;
+
+PARTICLE_BLOCK article_cache_get(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t article_id, int *pbHot);
+PARTICLE_BLOCK article_cache_peek(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t article_id, int *pbHot);
+int article_cache_fits(uint32_t nArticles, uint32_t len);
+void article_cache_add(uint32_t wiki_id, uint32_t file_id, uint32_t offset_dat, uint32_t segment,
+		       uint32_t nArticles, const CONCAT_ARTICLE_INFO *pInfos, const unsigned char *pData, uint32_t len);
+
+#endif
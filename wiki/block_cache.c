@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <grifo.h>
+
+#include "block_cache.h"
+
+static uint32_t block_hash(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset)
+{
+	return ((offset ^ (id * 0x9E3779B1)) * 0x9E3779B1) >> pCache->nHashShift;
+}
+
+static void queue_remove(PBLOCK_CACHE pCache, int32_t idx)
+{
+	PBLOCK_CACHE_ENTRY pEntry = &pCache->entries[idx];
+	BLOCK_QUEUE *pQueue = &pCache->queues[pEntry->queue];
+
+	if (pEntry->prev == BLOCK_CACHE_NONE)
+		pQueue->head = pEntry->next;
+	else
+		pCache->entries[pEntry->prev].next = pEntry->next;
+	if (pEntry->next == BLOCK_CACHE_NONE)
+		pQueue->tail = pEntry->prev;
+	else
+		pCache->entries[pEntry->next].prev = pEntry->prev;
+	pQueue->count--;
+}
+
+static void queue_push_head(PBLOCK_CACHE pCache, int queue, int32_t idx)
+{
+	PBLOCK_CACHE_ENTRY pEntry = &pCache->entries[idx];
+	BLOCK_QUEUE *pQueue = &pCache->queues[queue];
+
+	pEntry->queue = queue;
+	pEntry->prev = BLOCK_CACHE_NONE;
+	pEntry->next = pQueue->head;
+	if (pQueue->head == BLOCK_CACHE_NONE)
+		pQueue->tail = idx;
+	else
+		pCache->entries[pQueue->head].prev = idx;
+	pQueue->head = idx;
+	pQueue->count++;
+}
+
+static int32_t block_find(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset)
+{
+	int32_t idx = pCache->hash[block_hash(pCache, id, offset)];
+
+	while (idx != BLOCK_CACHE_NONE &&
+	       (pCache->entries[idx].id != id || pCache->entries[idx].offset != offset))
+		idx = pCache->entries[idx].hash_next;
+	return idx;
+}
+
+static void hash_insert(PBLOCK_CACHE pCache, int32_t idx)
+{
+	uint32_t nHash = block_hash(pCache, pCache->entries[idx].id, pCache->entries[idx].offset);
+
+	pCache->entries[idx].hash_next = pCache->hash[nHash];
+	pCache->hash[nHash] = idx;
+}
+
+static void hash_remove(PBLOCK_CACHE pCache, int32_t idx)
+{
+	int32_t *pIdx = &pCache->hash[block_hash(pCache, pCache->entries[idx].id, pCache->entries[idx].offset)];
+
+	while (*pIdx != idx)
+		pIdx = &pCache->entries[*pIdx].hash_next;
+	*pIdx = pCache->entries[idx].hash_next;
+}
+
+static void block_free(PBLOCK_CACHE pCache, int32_t idx)
+{
+	PBLOCK_CACHE_ENTRY pEntry = &pCache->entries[idx];
+
+	hash_remove(pCache, idx);
+	queue_remove(pCache, idx);
+	if (pEntry->buf_idx != BLOCK_CACHE_NONE)
+	{
+		pCache->free_bufs[pCache->nFreeBufs++] = pEntry->buf_idx;
+		pEntry->buf_idx = BLOCK_CACHE_NONE;
+	}
+	queue_push_head(pCache, BLOCK_QUEUE_FREE, idx);
+}
+
+// free one buffer: from A1in if it is over its share, otherwise the least recently used of Am
+static void block_reclaim(PBLOCK_CACHE pCache)
+{
+	int32_t idx;
+
+	if (pCache->queues[BLOCK_QUEUE_A1IN].count > pCache->nMaxA1in ||
+	    !pCache->queues[BLOCK_QUEUE_AM].count)
+	{
+		idx = pCache->queues[BLOCK_QUEUE_A1IN].tail;
+		queue_remove(pCache, idx);
+		pCache->free_bufs[pCache->nFreeBufs++] = pCache->entries[idx].buf_idx;
+		pCache->entries[idx].buf_idx = BLOCK_CACHE_NONE;
+		if (pCache->queues[BLOCK_QUEUE_A1OUT].count >= pCache->nMaxA1out)
+			block_free(pCache, pCache->queues[BLOCK_QUEUE_A1OUT].tail);
+		queue_push_head(pCache, BLOCK_QUEUE_A1OUT, idx);
+	}
+	else
+		block_free(pCache, pCache->queues[BLOCK_QUEUE_AM].tail);
+	pCache->stats.evictions++;
+}
+
+int block_cache_init(PBLOCK_CACHE pCache, int nBlocks, int nBlockSize, const char *tag)
+{
+	int nEntries;
+	int nHashBits;
+	int i;
+
+	memset(pCache, 0, sizeof(BLOCK_CACHE));
+	pCache->nBlocks = nBlocks;
+	pCache->nBlockSize = nBlockSize;
+	pCache->nMaxA1in = nBlocks / 4 > 0 ? nBlocks / 4 : 1;
+	pCache->nMaxA1out = nBlocks / 2 > 0 ? nBlocks / 2 : 1;
+	nEntries = nBlocks + pCache->nMaxA1out;
+	nHashBits = 1;
+	while ((1 << nHashBits) < nEntries * 2)
+		nHashBits++;
+	pCache->nHashShift = 32 - nHashBits;
+
+	pCache->hash = (int32_t *)memory_allocate(sizeof(int32_t) * (1 << nHashBits), tag);
+	pCache->entries = (PBLOCK_CACHE_ENTRY)memory_allocate(sizeof(BLOCK_CACHE_ENTRY) * nEntries, tag);
+	pCache->free_bufs = (int32_t *)memory_allocate(sizeof(int32_t) * nBlocks, tag);
+	pCache->bufs = (unsigned char *)memory_allocate(nBlocks * nBlockSize, tag);
+	if (!pCache->hash || !pCache->entries || !pCache->free_bufs || !pCache->bufs)
+		return -1;
+
+	for (i = 0; i < (1 << nHashBits); i++)
+		pCache->hash[i] = BLOCK_CACHE_NONE;
+	for (i = 0; i < BLOCK_QUEUE_COUNT; i++)
+	{
+		pCache->queues[i].head = BLOCK_CACHE_NONE;
+		pCache->queues[i].tail = BLOCK_CACHE_NONE;
+		pCache->queues[i].count = 0;
+	}
+	for (i = 0; i < nEntries; i++)
+	{
+		pCache->entries[i].buf_idx = BLOCK_CACHE_NONE;
+		queue_push_head(pCache, BLOCK_QUEUE_FREE, i);
+	}
+	for (i = 0; i < nBlocks; i++)
+		pCache->free_bufs[i] = nBlocks - 1 - i;
+	pCache->nFreeBufs = nBlocks;
+	pCache->last_added = BLOCK_CACHE_NONE;
+	return 0;
+}
+
+// return the cached block or NULL
+unsigned char *block_cache_get(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset, uint32_t *len)
+{
+	int32_t idx = block_find(pCache, id, offset);
+
+	if (idx == BLOCK_CACHE_NONE || pCache->entries[idx].queue == BLOCK_QUEUE_A1OUT)
+	{
+		pCache->stats.misses++;
+		return NULL;
+	}
+	if (pCache->entries[idx].queue == BLOCK_QUEUE_AM)
+	{
+		queue_remove(pCache, idx);
+		queue_push_head(pCache, BLOCK_QUEUE_AM, idx);
+	}
+	pCache->stats.hits++;
+	*len = pCache->entries[idx].len;
+	return &pCache->bufs[pCache->entries[idx].buf_idx * pCache->nBlockSize];
+}
+
+// check for a block without counting it as a reference
+int block_cache_contains(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset)
+{
+	int32_t idx = block_find(pCache, id, offset);
+
+	return idx != BLOCK_CACHE_NONE && pCache->entries[idx].queue != BLOCK_QUEUE_A1OUT;
+}
+
+// return the buffer (nBlockSize bytes) for a new block, to be followed by block_cache_commit()
+unsigned char *block_cache_add(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset)
+{
+	int32_t idx = block_find(pCache, id, offset);
+	int queue = BLOCK_QUEUE_A1IN;
+
+	if (idx != BLOCK_CACHE_NONE)
+	{
+		if (pCache->entries[idx].queue != BLOCK_QUEUE_A1OUT)
+		{
+			pCache->last_added = idx;
+			return &pCache->bufs[pCache->entries[idx].buf_idx * pCache->nBlockSize];
+		}
+		// referenced again shortly after leaving A1in
+		pCache->stats.ghost_hits++;
+		queue_remove(pCache, idx);
+		queue = BLOCK_QUEUE_AM;
+	}
+
+	if (!pCache->nFreeBufs)
+		block_reclaim(pCache);
+
+	if (idx == BLOCK_CACHE_NONE)
+	{
+		idx = pCache->queues[BLOCK_QUEUE_FREE].tail;
+		queue_remove(pCache, idx);
+		pCache->entries[idx].id = id;
+		pCache->entries[idx].offset = offset;
+		hash_insert(pCache, idx);
+	}
+	pCache->entries[idx].buf_idx = pCache->free_bufs[--pCache->nFreeBufs];
+	pCache->entries[idx].len = 0;
+	queue_push_head(pCache, queue, idx);
+	pCache->last_added = idx;
+	return &pCache->bufs[pCache->entries[idx].buf_idx * pCache->nBlockSize];
+}
+
+// set the length of the block just added, zero length drops the block
+void block_cache_commit(PBLOCK_CACHE pCache, uint32_t len)
+{
+	if (pCache->last_added == BLOCK_CACHE_NONE)
+		return;
+	if (len)
+		pCache->entries[pCache->last_added].len = len;
+	else
+		block_free(pCache, pCache->last_added);
+	pCache->last_added = BLOCK_CACHE_NONE;
+}
+
+// drop all the blocks with the id
+void block_cache_invalidate(PBLOCK_CACHE pCache, uint32_t id)
+{
+	int i;
+
+	for (i = 0; i < pCache->nBlocks + pCache->nMaxA1out; i++)
+	{
+		if (pCache->entries[i].queue != BLOCK_QUEUE_FREE && pCache->entries[i].id == id)
+			block_free(pCache, i);
+	}
+	pCache->last_added = BLOCK_CACHE_NONE;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <inttypes.h>
+
+// Cache of fixed size file blocks keyed by (id, offset) with 2Q replacement:
+//   A1in  - FIFO of the blocks referenced once (about a quarter of the blocks)
+//   Am    - LRU of the blocks referenced again
+//   A1out - keys (no data) of the blocks recently dropped from A1in
+// A block is only promoted to Am when it is referenced again after leaving A1in,
+// so a scan over many blocks (e.g. binary search probes) cannot evict the hot blocks in Am.
+
+#define BLOCK_CACHE_NONE -1
+
+enum {
+	BLOCK_QUEUE_FREE,
+	BLOCK_QUEUE_A1IN,
+	BLOCK_QUEUE_AM,
+	BLOCK_QUEUE_A1OUT,
+	BLOCK_QUEUE_COUNT
+};
+
+typedef struct _BLOCK_QUEUE {
+	int32_t head;		// most recent entry
+	int32_t tail;		// entry to be evicted next
+	int32_t count;
+} BLOCK_QUEUE;
+
+typedef struct _BLOCK_CACHE_ENTRY {
+	uint32_t id;
+	uint32_t offset;
+	uint32_t len;
+	int32_t hash_next;
+	int32_t prev;		// towards the head of the queue
+	int32_t next;		// towards the tail of the queue
+	int32_t buf_idx;	// BLOCK_CACHE_NONE for the entries in A1out
+	uint8_t queue;
+} BLOCK_CACHE_ENTRY, *PBLOCK_CACHE_ENTRY;
+
+typedef struct _BLOCK_CACHE_STATS {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t ghost_hits;	// misses on a block recently dropped from A1in
+} BLOCK_CACHE_STATS;
+
+typedef struct _BLOCK_CACHE {
+	int nBlocks;
+	int nBlockSize;
+	int nMaxA1in;
+	int nMaxA1out;
+	int nHashShift;
+	int32_t *hash;
+	PBLOCK_CACHE_ENTRY entries;
+	int32_t *free_bufs;
+	int nFreeBufs;
+	unsigned char *bufs;
+	BLOCK_QUEUE queues[BLOCK_QUEUE_COUNT];
+	int32_t last_added;
+	BLOCK_CACHE_STATS stats;
+} BLOCK_CACHE, *PBLOCK_CACHE;
+
+int block_cache_init(PBLOCK_CACHE pCache, int nBlocks, int nBlockSize, const char *tag);
+unsigned char *block_cache_get(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset, uint32_t *len);
+int block_cache_contains(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset);
+unsigned char *block_cache_add(PBLOCK_CACHE pCache, uint32_t id, uint32_t offset);
+void block_cache_commit(PBLOCK_CACHE pCache, uint32_t len);
+void block_cache_invalidate(PBLOCK_CACHE pCache, uint32_t id);
+
+#endif
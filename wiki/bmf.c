@@ -24,11 +24,49 @@
 #include "ustring.h"
 #include "bmf.h"
 #include "wikilib.h"
+#include "block_cache.h"
+
+BLOCK_CACHE bmf_compact_cache;
+
+// keep the page directory and the pages of a compact font, the glyphs are read when used
+static int load_compact_bmf(pcffont_bmf_t *font, int fd, const bmf_compact_header *pHeader)
+{
+	static int bFirstCall = 1;
+	uint32_t nDirLen = (pHeader->char_count + 255) / 256 * sizeof(uint16_t);
+	uint32_t nPagesLen = pHeader->page_count * sizeof(bmf_compact_page);
+
+	if (bFirstCall)
+	{
+		if (block_cache_init(&bmf_compact_cache, BMF_COMPACT_CACHE_PAGE_COUNT, BMF_COMPACT_CACHE_PAGE_SIZE, "bmf2"))
+			fatal_error("load_bmf malloc error on glyph cache");
+		bFirstCall = 0;
+	}
+	font->page_dir = (uint16_t *)memory_allocate(nDirLen + nPagesLen, "bmf");
+	if (!font->page_dir) {
+		fatal_error("load_bmf malloc error on: %s", font->file);
+	}
+	font->pages = (bmf_compact_page *)((char *)font->page_dir + nDirLen);
+	if (file_read(fd, font->page_dir, nDirLen + nPagesLen) != (ssize_t)(nDirLen + nPagesLen)) {
+		fatal_error("truncated font: %s", font->file);
+	}
+	font->bCompact = 1;
+	font->char_count = pHeader->char_count;
+	font->offset_glyphs = pHeader->offset_glyphs;
+	font->charmetric = NULL;
+
+	font->Fmetrics.linespace = pHeader->linespace;
+	font->Fmetrics.ascent    = pHeader->ascent;
+	font->Fmetrics.descent   = pHeader->descent;
+	font->Fmetrics.default_char = pHeader->default_char;
+
+	return fd;
+}
 
 int load_bmf(pcffont_bmf_t *font)
 {
 	int fd;
 	font_bmf_header header;
+	bmf_compact_header compact_header;
 
 	if (NULL == font || NULL == font->file) {
 		fatal_error("font is NULL");
@@ -45,6 +83,12 @@ int load_bmf(pcffont_bmf_t *font)
 	if (0 == font->file_size) {
 		fatal_error("zero size font: %s", font->file);
 	}
+	font->bCompact = 0;
+	if (file_read(fd, &compact_header, sizeof(compact_header)) == sizeof(compact_header) &&
+	    BMF_COMPACT_MAGIC == compact_header.magic) {
+		return load_compact_bmf(font, fd, &compact_header);
+	}
+	file_lseek(fd, 0);
 	font->charmetric = (char*)memory_allocate(font->file_size, "bmf");
 	if (!font->charmetric) {
 		fatal_error("load_bmf malloc error on: %s", font->file);
@@ -63,16 +107,107 @@ int load_bmf(pcffont_bmf_t *font)
 	return fd;
 }
 
+// copy len bytes of the glyphs of a compact font through the cache, a glyph may span two pages
+static int read_compact_glyph(pcffont_bmf_t *font, uint32_t offset, unsigned char *buf, uint32_t len)
+{
+	uint32_t page_offset;
+	uint32_t nPageLen;
+	uint32_t nCopyLen;
+	unsigned char *pPage;
+	int nRead;
+
+	while (len)
+	{
+		page_offset = offset & ~(BMF_COMPACT_CACHE_PAGE_SIZE - 1);
+		pPage = block_cache_get(&bmf_compact_cache, font->fd, page_offset, &nPageLen);
+		if (!pPage)
+		{
+			pPage = block_cache_add(&bmf_compact_cache, font->fd, page_offset);
+			file_lseek(font->fd, page_offset);
+			nRead = file_read(font->fd, pPage, BMF_COMPACT_CACHE_PAGE_SIZE);
+			nPageLen = nRead > 0 ? nRead : 0;
+			block_cache_commit(&bmf_compact_cache, nPageLen);
+		}
+		if (offset - page_offset >= nPageLen)
+			return -1;
+		nCopyLen = nPageLen - (offset - page_offset);
+		if (nCopyLen > len)
+			nCopyLen = len;
+		memcpy(buf, &pPage[offset - page_offset], nCopyLen);
+		buf += nCopyLen;
+		offset += nCopyLen;
+		len -= nCopyLen;
+	}
+	return 0;
+}
+
+// as pres_bmfbm() for the original format
+static int pres_compact_bmfbm(ucs4_t val, pcffont_bmf_t *font, bmf_bm_t **bitmap, charmetric_bmf *Cmetrics)
+{
+	bmf_compact_page *pPage;
+	uint32_t offset;
+	uint16_t nPage;
+	int nBitmapLen;
+
+	memset(Cmetrics, 0, sizeof(charmetric_bmf));
+	if (val >= font->char_count)
+	{
+		if (val <= 256)
+			return 1;
+		if (font->bPartialFont)
+		{ // character not defined in the current font file (and it is intended to include partial characters)
+			return pres_bmfbm(val, font->supplement_font, bitmap, Cmetrics);
+		}
+		return -1;
+	}
+
+	nPage = font->page_dir[val >> 8];
+	if (nPage != BMF_COMPACT_NONE && font->pages[nPage].glyph[val & 0xFF] != BMF_COMPACT_NONE)
+	{
+		pPage = &font->pages[nPage];
+		offset = font->offset_glyphs + pPage->offset + pPage->glyph[val & 0xFF];
+		if (read_compact_glyph(font, offset, (unsigned char *)Cmetrics, BMF_COMPACT_METRICS_LEN))
+		{
+			memset(Cmetrics, 0, sizeof(charmetric_bmf));
+		}
+		else if (Cmetrics->width > 0)
+		{
+			nBitmapLen = Cmetrics->widthBytes * Cmetrics->height;
+			if (nBitmapLen > (int)sizeof(Cmetrics->bitmap))
+				nBitmapLen = sizeof(Cmetrics->bitmap);
+			if (nBitmapLen > 0 &&
+			    read_compact_glyph(font, offset + BMF_COMPACT_METRICS_LEN, (unsigned char *)Cmetrics->bitmap, nBitmapLen))
+				memset(Cmetrics, 0, sizeof(charmetric_bmf));
+		}
+	}
+
+	if (Cmetrics->width > 0)
+		*bitmap = (bmf_bm_t *)Cmetrics->bitmap;
+	else if (val > 256)
+	{
+		if (font->Fmetrics.default_char && val != (ucs4_t)font->Fmetrics.default_char)
+		{
+			pres_bmfbm(font->Fmetrics.default_char, font, bitmap, Cmetrics);
+		}
+		if (!Cmetrics->width)
+		{
+			Cmetrics->width = 1;
+			Cmetrics->height = 0;
+		}
+	}
+	return 1;
+}
+
 int
 pres_bmfbm(ucs4_t val, pcffont_bmf_t *font, bmf_bm_t **bitmap,charmetric_bmf *Cmetrics)
 {
 	int size = 0;
 	int offset = 0;
-	char buffer[1024];
+	char buffer[sizeof(charmetric_bmf)];
 	int font_header;
 	int bFound = 0;
 
-	memset(buffer,0,1024);
+	memset(buffer,0,sizeof(buffer));
 
 	if(font==NULL || font->fd < 0)
 		return -1;
@@ -83,6 +218,8 @@ pres_bmfbm(ucs4_t val, pcffont_bmf_t *font, bmf_bm_t **bitmap,charmetric_bmf *Cm
 		if(font->fd < 0)
 			return -1;
 	}
+	if (font->bCompact)
+		return pres_compact_bmfbm(val, font, bitmap, Cmetrics);
 	font_header =  sizeof(font_bmf_header);
 
 	if(val <= 256)
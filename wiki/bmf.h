@@ -143,6 +143,40 @@ typedef struct font_bmf_header{
 }font_bmf_header;
 
 
+// Compact font file written by pcf2bmf --compact:
+//   bmf_compact_header
+//   uint16_t page_dir[(char_count + 255) / 256]: index of the page of 256 code points, BMF_COMPACT_NONE if empty
+//   bmf_compact_page[page_count]
+//   the glyphs: the 8 metric bytes of charmetric_bmf then widthBytes * height bytes of bitmap
+//   (none if width is 0), at offset_glyphs + page.offset + page.glyph[code point & 0xFF]
+// A code point below char_count without a glyph has BMF_COMPACT_NONE, as a zeroed charmetric_bmf
+// in the original format.
+#define BMF_COMPACT_MAGIC 0x464d4243	// "CBMF"
+#define BMF_COMPACT_NONE 0xFFFF
+#define BMF_COMPACT_METRICS_LEN 8
+
+typedef struct __attribute__((packed)) bmf_compact_header {
+	uint32_t magic;
+	int8_t   linespace;
+	int8_t   ascent;
+	int8_t   descent;
+	int8_t   reserved;
+	int32_t  default_char;
+	uint32_t char_count;
+	uint32_t page_count;
+	uint32_t offset_glyphs;
+} bmf_compact_header;
+
+typedef struct __attribute__((packed)) bmf_compact_page {
+	uint32_t offset;	// of the first glyph, from offset_glyphs
+	uint16_t glyph[256];	// from offset
+} bmf_compact_page;
+
+// glyph data read a page at a time, shared by all the compact fonts
+#define BMF_COMPACT_CACHE_PAGE_SIZE 1024
+#define BMF_COMPACT_CACHE_PAGE_COUNT 32
+
+
 typedef struct fontmetric pcf_fontmet_t;
 
 
@@ -155,6 +189,11 @@ struct pcffont_bmf {
 	char *charmetric;
 	unsigned long file_size;
 	int bmp_buffer_len;
+	int bCompact;
+	uint32_t char_count;
+	uint16_t *page_dir;		// resident part of a compact font
+	bmf_compact_page *pages;
+	uint32_t offset_glyphs;
 };
 
 typedef struct pcffont_bmf pcffont_bmf_t;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <grifo.h>
+
+#include "wiki_info.h"
+#include "file_pool.h"
+
+typedef struct _FILE_POOL_ENTRY {
+	int nWikiIdx;
+	int file_id;
+	int fd;			// -1 if the entry is unused
+	uint32_t last_used;
+} FILE_POOL_ENTRY, *PFILE_POOL_ENTRY;
+
+static FILE_POOL_ENTRY file_pool[FILE_POOL_HANDLES];
+static uint32_t nFilePoolClock;
+static int bFilePoolInited;
+
+static void file_pool_init(void)
+{
+	int i;
+
+	for (i = 0; i < FILE_POOL_HANDLES; i++)
+		file_pool[i].fd = -1;
+	bFilePoolInited = 1;
+}
+
+// return the handle of wiki<file_id>.dat of the wiki, the pool owns it and closes it
+int file_pool_open(int nWikiIdx, int file_id)
+{
+	PFILE_POOL_ENTRY pEntry = NULL;
+	char file_name[13];
+	int i;
+
+	if (!bFilePoolInited)
+		file_pool_init();
+
+	for (i = 0; i < FILE_POOL_HANDLES; i++)
+	{
+		if (file_pool[i].fd >= 0 && file_pool[i].file_id == file_id && file_pool[i].nWikiIdx == nWikiIdx)
+		{
+			file_pool[i].last_used = ++nFilePoolClock;
+			return file_pool[i].fd;
+		}
+		if (!pEntry || (pEntry->fd >= 0 && (file_pool[i].fd < 0 || file_pool[i].last_used < pEntry->last_used)))
+			pEntry = &file_pool[i];
+	}
+
+	if (pEntry->fd >= 0)
+	{
+		file_close(pEntry->fd);
+		pEntry->fd = -1;
+	}
+	sprintf(file_name, "wiki%d.dat", file_id);
+	pEntry->fd = file_open(get_wiki_file_path(nWikiIdx, file_name), FILE_OPEN_READ);
+	if (pEntry->fd < 0)
+		return -1;
+	pEntry->nWikiIdx = nWikiIdx;
+	pEntry->file_id = file_id;
+	pEntry->last_used = ++nFilePoolClock;
+	return pEntry->fd;
+}
+
+// close the handles of the wikis other than nWikiIdx (all of them if nWikiIdx < 0)
+void file_pool_invalidate(int nWikiIdx)
+{
+	int i;
+
+	if (!bFilePoolInited)
+		return;
+	for (i = 0; i < FILE_POOL_HANDLES; i++)
+	{
+		if (file_pool[i].fd >= 0 && (nWikiIdx < 0 || file_pool[i].nWikiIdx != nWikiIdx))
+		{
+			file_close(file_pool[i].fd);
+			file_pool[i].fd = -1;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILE_POOL_H
+#define FILE_POOL_H
+
+// wiki?.dat handles kept open between articles, keyed by (wiki index, dat file id) and the
+// least recently used one closed first. An open file keeps its position in the FAT cluster chain,
+// a new open has to look up the path and walk the chain from the start.
+#define FILE_POOL_HANDLES 8
+
+int file_pool_open(int nWikiIdx, int file_id);
+void file_pool_invalidate(int nWikiIdx);
+
+#endif
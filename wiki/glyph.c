@@ -27,6 +27,7 @@
 #include "guilib.h"
 #include "utf8.h"
 #include "glyph.h"
+#include "glyph_blit.h"
 #include "lcd_buf_draw.h"
 #include "search.h"
 
@@ -34,33 +35,18 @@
 
 void render_glyph(int start_x, int start_y, const struct glyph *glyph, char *buf)
 {
-	int x, y, w, bit = 0;
-	const char *d = glyph->data;
+	int height = glyph->height;
 
-	for (y = start_y; y < start_y + glyph->height; y++) {
-		for (x = start_x, w = glyph->width; w > 0;) {
-			int use;
-			unsigned byte = (x + LCD_BUFFER_WIDTH * y) / 8;
-
-			if (byte >= LCD_BUF_HEIGHT_PIXELS * LCD_BUF_WIDTH_BYTES)
-				return;
-
-			use = MIN(8 - (x % 8) , w);
-			use = MIN(8 - bit, use);
+	// the rows of the glyph data follow each other without padding
+	if (start_y + height > LCD_BUF_HEIGHT_PIXELS)
+		height = LCD_BUF_HEIGHT_PIXELS - start_y;
 #ifdef DISPLAY_INVERTED
-			buf[byte] &= ~((*d << bit & (unsigned char)(0xff << (8 - use))) >> (x % 8));
+	glyph_blit((unsigned char *)buf, LCD_BUF_WIDTH_BYTES, start_x, start_y, start_x + glyph->width,
+		   (const unsigned char *)glyph->data, 0, glyph->width, glyph->width, height, GLYPH_BLIT_CLEAR);
 #else
-			buf[byte] |= (*d << bit & (unsigned char)(0xff << (8 - use))) >> (x % 8);
+	glyph_blit((unsigned char *)buf, LCD_BUF_WIDTH_BYTES, start_x, start_y, start_x + glyph->width,
+		   (const unsigned char *)glyph->data, 0, glyph->width, glyph->width, height, GLYPH_BLIT_SET);
 #endif
-			bit += use;
-			x += use;
-			w -= use;
-			if (bit == 8) {
-				bit = 0;
-				d++;
-			}
-		}
-	}
 }
 
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+
+#include "glyph_blit.h"
+
+// pixels of a row drawn at once, with the shift to the buffer bit they fit in 32 bits
+#define GLYPH_BLIT_CHUNK 24
+
+void glyph_blit(unsigned char *buf, int buf_width_bytes, int x, int y, int clip_x,
+		const unsigned char *bitmap, int src_bit, int src_stride_bits, int width, int height, int mode)
+{
+	int row_bits = buf_width_bytes * 8;
+	int pos = x + row_bits * y;	// buffer bit of the start of the row
+	int r, c, n, s, d, shift;
+	const unsigned char *p;
+	unsigned char *q;
+	uint32_t bits;
+
+	if (width > clip_x - x)
+	{
+		width = clip_x - x;
+	}
+	for (r = 0; r < height; r++, pos += row_bits, src_bit += src_stride_bits)
+	{
+		for (c = 0; c < width; c += GLYPH_BLIT_CHUNK)
+		{
+			n = width - c < GLYPH_BLIT_CHUNK ? width - c : GLYPH_BLIT_CHUNK;
+			s = src_bit + c;
+			p = bitmap + (s >> 3);
+			s &= 0x07;
+
+			// the n bits at the top of the word
+			bits = (uint32_t)p[0] << 24;
+			if (s + n > 8)
+			{
+				bits |= (uint32_t)p[1] << 16;
+				if (s + n > 16)
+				{
+					bits |= (uint32_t)p[2] << 8;
+					if (s + n > 24)
+					{
+						bits |= p[3];
+					}
+				}
+			}
+			bits = (bits << s) & ~(0xFFFFFFFF >> n);
+
+			d = pos + c;
+			if (!bits || d < 0)
+			{
+				continue;
+			}
+			shift = d & 0x07;
+			bits >>= shift;
+			q = buf + (d >> 3);
+			n += shift;
+			switch (mode)
+			{
+			case GLYPH_BLIT_SET:
+				for (; n > 0; n -= 8, bits <<= 8)
+				{
+					*q++ |= bits >> 24;
+				}
+				break;
+			case GLYPH_BLIT_INVERT:
+				for (; n > 0; n -= 8, bits <<= 8)
+				{
+					*q++ ^= bits >> 24;
+				}
+				break;
+			case GLYPH_BLIT_CLEAR:
+				for (; n > 0; n -= 8, bits <<= 8)
+				{
+					*q++ &= ~(bits >> 24);
+				}
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLYPH_BLIT_H
+#define GLYPH_BLIT_H
+
+#define GLYPH_BLIT_SET 0	// buf |= glyph
+#define GLYPH_BLIT_INVERT 1	// buf ^= glyph
+#define GLYPH_BLIT_CLEAR 2	// buf &= ~glyph
+
+// draw height rows of width pixels of a 1 bit per pixel bitmap (MSB first) to a buffer of
+// buf_width_bytes per line at x, y; row r of the bitmap starts at bit src_bit + r * src_stride_bits
+// and the pixels from clip_x on are not drawn
+void glyph_blit(unsigned char *buf, int buf_width_bytes, int x, int y, int clip_x,
+		const unsigned char *bitmap, int src_bit, int src_stride_bits, int width, int height, int mode);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "glyph_blit.h"
+#include "glyph_cache.h"
+
+#define GLYPH_CACHE_HASH 64	// chains, a power of 2
+#define GLYPH_CACHE_ENTRIES (GLYPH_CACHE_BUDGET / sizeof(GLYPH_CACHE_ENTRY))
+
+GLYPH_CACHE_STATS glyph_cache_stats;
+
+static PGLYPH_CACHE_ENTRY glyph_entries;
+static int16_t glyph_hash[GLYPH_CACHE_HASH];
+static uint32_t nGlyphCacheClock;
+static GLYPH_CACHE_ENTRY glyph_uncached;	// when the cache is disabled
+
+static int hash_glyph(const pcffont_bmf_t *pFont, ucs4_t u)
+{
+	return (u ^ ((uintptr_t)pFont >> 4) * 31) & (GLYPH_CACHE_HASH - 1);
+}
+
+static void glyph_cache_init(void)
+{
+	int i;
+
+	if (!GLYPH_CACHE_ENTRIES)
+		return;
+	glyph_entries = (PGLYPH_CACHE_ENTRY)memory_allocate(GLYPH_CACHE_ENTRIES * sizeof(GLYPH_CACHE_ENTRY), "glyphcache1");
+	if (!glyph_entries)
+		return;
+	glyph_cache_stats.bytes = GLYPH_CACHE_ENTRIES * sizeof(GLYPH_CACHE_ENTRY);
+	for (i = 0; i < GLYPH_CACHE_HASH; i++)
+		glyph_hash[i] = -1;
+	for (i = 0; i < (int)GLYPH_CACHE_ENTRIES; i++)
+		glyph_entries[i].pFont = NULL;
+}
+
+// drop all the entries, e.g. when the fonts are loaded again
+void glyph_cache_clear(void)
+{
+	if (glyph_entries)
+	{
+		memory_free(glyph_entries, "glyphcache1");
+		glyph_entries = NULL;
+	}
+	glyph_cache_stats.bytes = 0;
+	glyph_cache_stats.entries = 0;
+}
+
+// a free entry or the least recently used one taken out of its chain
+static PGLYPH_CACHE_ENTRY glyph_cache_take(void)
+{
+	PGLYPH_CACHE_ENTRY pGlyph = NULL;
+	int16_t *pNext;
+	int i;
+
+	for (i = 0; i < (int)GLYPH_CACHE_ENTRIES; i++)
+	{
+		if (!glyph_entries[i].pFont)
+			return &glyph_entries[i];
+		if (!pGlyph || glyph_entries[i].last_used < pGlyph->last_used)
+			pGlyph = &glyph_entries[i];
+	}
+	pNext = &glyph_hash[hash_glyph(pGlyph->pFont, pGlyph->u)];
+	while (&glyph_entries[*pNext] != pGlyph)
+		pNext = &glyph_entries[*pNext].next;
+	*pNext = pGlyph->next;
+	pGlyph->pFont = NULL;
+	glyph_cache_stats.entries--;
+	glyph_cache_stats.evictions++;
+	return pGlyph;
+}
+
+static int glyph_cache_fill(PGLYPH_CACHE_ENTRY pGlyph, pcffont_bmf_t *pFont, ucs4_t u)
+{
+	bmf_bm_t *bitmap = NULL;
+	int shift;
+
+	if (pres_bmfbm(u, pFont, &bitmap, &pGlyph->Cmetrics) < 0)
+		return -1;
+	pGlyph->pFont = pFont;
+	pGlyph->u = u;
+	pGlyph->bBitmap = bitmap != NULL;
+	pGlyph->row_bytes = 0;
+	if (!pGlyph->bBitmap || pGlyph == &glyph_uncached ||
+	    pGlyph->Cmetrics.width > GLYPH_CACHE_MAX_WIDTH || pGlyph->Cmetrics.height > GLYPH_CACHE_MAX_HEIGHT)
+		return 0;
+
+	pGlyph->row_bytes = (pGlyph->Cmetrics.width + 7 + 7) / 8;
+	memset(pGlyph->shifted, 0, sizeof(pGlyph->shifted));
+	for (shift = 0; shift < 8; shift++)
+		glyph_blit(pGlyph->shifted[shift], pGlyph->row_bytes, shift, 0, shift + pGlyph->Cmetrics.width,
+			   (const unsigned char *)pGlyph->Cmetrics.bitmap, 0, pGlyph->Cmetrics.widthBits,
+			   pGlyph->Cmetrics.width, pGlyph->Cmetrics.height, GLYPH_BLIT_SET);
+	return 0;
+}
+
+// the metrics and bitmap of a glyph as pres_bmfbm() gives them, NULL if it fails
+const GLYPH_CACHE_ENTRY *glyph_cache_get(pcffont_bmf_t *pFont, ucs4_t u)
+{
+	PGLYPH_CACHE_ENTRY pGlyph;
+	int16_t i;
+	int h;
+
+	if (!glyph_entries)
+		glyph_cache_init();
+	if (!glyph_entries)
+	{
+		if (glyph_cache_fill(&glyph_uncached, pFont, u) < 0)
+			return NULL;
+		return &glyph_uncached;
+	}
+
+	h = hash_glyph(pFont, u);
+	for (i = glyph_hash[h]; i >= 0; i = glyph_entries[i].next)
+	{
+		if (glyph_entries[i].u == u && glyph_entries[i].pFont == pFont)
+		{
+			glyph_entries[i].last_used = ++nGlyphCacheClock;
+			glyph_cache_stats.hits++;
+			return &glyph_entries[i];
+		}
+	}
+
+	glyph_cache_stats.misses++;
+	pGlyph = glyph_cache_take();
+	if (glyph_cache_fill(pGlyph, pFont, u) < 0)
+	{
+		pGlyph->pFont = NULL;
+		return NULL;
+	}
+	glyph_cache_stats.entries++;
+	pGlyph->last_used = ++nGlyphCacheClock;
+	pGlyph->next = glyph_hash[h];
+	glyph_hash[h] = pGlyph - glyph_entries;
+	return pGlyph;
+}
+
+// as glyph_blit() of the glyph bitmap with its top left pixel at x, y
+void glyph_cache_draw(const GLYPH_CACHE_ENTRY *pGlyph, unsigned char *buf, int buf_width_bytes,
+		      int x, int y, int clip_x, int mode)
+{
+	const unsigned char *src;
+	unsigned char *dest;
+	int row_bytes = pGlyph->row_bytes;
+	int r, i;
+
+	if (!row_bytes || x < 0 || y < 0 || x + pGlyph->Cmetrics.width > clip_x)
+	{
+		glyph_blit(buf, buf_width_bytes, x, y, clip_x, (const unsigned char *)pGlyph->Cmetrics.bitmap, 0,
+			   pGlyph->Cmetrics.widthBits, pGlyph->Cmetrics.width, pGlyph->Cmetrics.height, mode);
+		return;
+	}
+
+	// the last byte of a row is past the glyph when it ends in the byte before
+	if (((x & 0x07) + pGlyph->Cmetrics.width + 7) / 8 < row_bytes)
+		row_bytes--;
+	src = pGlyph->shifted[x & 0x07];
+	dest = buf + y * buf_width_bytes + (x >> 3);
+	switch (mode)
+	{
+	case GLYPH_BLIT_SET:
+		for (r = 0; r < pGlyph->Cmetrics.height; r++, src += pGlyph->row_bytes, dest += buf_width_bytes)
+			for (i = 0; i < row_bytes; i++)
+				dest[i] |= src[i];
+		break;
+	case GLYPH_BLIT_INVERT:
+		for (r = 0; r < pGlyph->Cmetrics.height; r++, src += pGlyph->row_bytes, dest += buf_width_bytes)
+			for (i = 0; i < row_bytes; i++)
+				dest[i] ^= src[i];
+		break;
+	case GLYPH_BLIT_CLEAR:
+		for (r = 0; r < pGlyph->Cmetrics.height; r++, src += pGlyph->row_bytes, dest += buf_width_bytes)
+			for (i = 0; i < row_bytes; i++)
+				dest[i] &= ~src[i];
+		break;
+	}
+}
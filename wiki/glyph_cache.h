@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <inttypes.h>
+
+#include "bmf.h"
+
+// The glyphs drawn most recently keyed by (font, character), least recently used dropped first.
+// An entry keeps the metrics and bitmap from pres_bmfbm() and, for glyphs up to
+// GLYPH_CACHE_MAX_WIDTH x GLYPH_CACHE_MAX_HEIGHT, the rows shifted to each of the 8 bit
+// positions in a byte so drawing them is only ORing bytes. The entries are allocated at the
+// first glyph drawn and dropped with glyph_cache_clear(). A budget of zero disables the cache.
+#define GLYPH_CACHE_BUDGET (64 * 1024)	// bytes of entries
+#define GLYPH_CACHE_MAX_WIDTH 17	// pixels, shifted to bit 7 it takes 3 bytes
+#define GLYPH_CACHE_MAX_HEIGHT 20
+#define GLYPH_CACHE_ROW_BYTES ((GLYPH_CACHE_MAX_WIDTH + 7 + 7) / 8)
+
+typedef struct _GLYPH_CACHE_ENTRY {
+	const pcffont_bmf_t *pFont;
+	ucs4_t u;
+	uint32_t last_used;
+	int16_t next;			// in the hash chain
+	uint8_t bBitmap;		// pres_bmfbm() gave a bitmap
+	uint8_t row_bytes;		// of the shifted rows, 0 if the glyph is not shifted
+	charmetric_bmf Cmetrics;
+	unsigned char shifted[8][GLYPH_CACHE_ROW_BYTES * GLYPH_CACHE_MAX_HEIGHT];
+} GLYPH_CACHE_ENTRY, *PGLYPH_CACHE_ENTRY;
+
+typedef struct _GLYPH_CACHE_STATS {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t bytes;			// allocated for the entries
+	uint32_t entries;
+} GLYPH_CACHE_STATS;
+
+extern GLYPH_CACHE_STATS glyph_cache_stats;
+
+const GLYPH_CACHE_ENTRY *glyph_cache_get(pcffont_bmf_t *pFont, ucs4_t u);
+void glyph_cache_draw(const GLYPH_CACHE_ENTRY *pGlyph, unsigned char *buf, int buf_width_bytes,
+		      int x, int y, int clip_x, int mode);
+void glyph_cache_clear(void);
+
+#endif
@@ -81,6 +81,16 @@ long history_get_previous_idx(long current_idx_article, int b_drop_from_list)
 	return previous_idx_article;
 }
 
+// the article history_get_previous_idx() would return, without going back
+long history_peek_previous_idx(long current_idx_article)
+{
+	if (viewing_count > 1)
+		return viewing_list[viewing_count - 2].idx_article;
+	if (viewing_count > 0 && viewing_list[0].idx_article != current_idx_article)
+		return viewing_list[0].idx_article;
+	return 0;
+}
+
 void history_reload()
 {
 	rendered_history_count = 0;
@@ -47,6 +47,7 @@ void history_set_y_pos(const long idx_article);
 long history_get_y_pos();
 void draw_clear_history(int bFlag);
 long history_get_previous_idx(long current_idx_article, int b_drop_from_list);
+long history_peek_previous_idx(long current_idx_article);
 
 typedef struct __attribute__ ((packed)) _HISTORY {
 	int32_t idx_article;
@@ -28,6 +28,9 @@
 #include "history.h"
 #include "search.h"
 #include "glyph.h"
+#include "glyph_blit.h"
+#include "glyph_cache.h"
+#include "render_tile.h"
 #include "wikilib.h"
 #include "restricted.h"
 #include "wiki_info.h"
@@ -58,6 +61,7 @@
 extern long finger_move_speed;
 extern int last_display_mode;
 extern int display_mode;
+extern HISTORY history_list[MAX_HISTORY];
 pcffont_bmf_t pcfFonts[FONT_COUNT];
 static int lcd_draw_buf_inited = 0;
 LCD_DRAW_BUF lcd_draw_buf;
@@ -94,7 +98,7 @@ int display_first_page = 0;
 void display_link_article(long idx_article);
 void drawline_in_framebuffer_copy(unsigned char *buffer,int start_x,int start_y,int end_x,int end_y);
 void buf_draw_char_external(LCD_DRAW_BUF *lcd_draw_buf_external,ucs4_t u,int start_x,int end_x,int start_y,int end_y);
-void repaint_framebuffer(unsigned char *buf, int pos, int b_repaint_invert_link);
+void repaint_framebuffer(int pos, int b_repaint_invert_link);
 void repaint_invert_link(void);
 char* FontFile(int idx);
 int framebuffer_size();
@@ -110,6 +114,208 @@ int b_show_scroll_bar = 0;
 long saved_idx_article = 0;
 long saved_prev_idx_article = 0;
 
+// The article text is drawn in runs, an escape code and the characters up to the next one.
+// For each tile of the surface the state at the start of the first run drawing on it is kept,
+// so a tile dropped from the tile cache is drawn again from there when it is needed.
+typedef struct _SURFACE_RESTART {
+	const unsigned char *pBuf;
+	LCD_DRAW_BUF state;
+} SURFACE_RESTART, *PSURFACE_RESTART;
+
+// a run never draws further up than this above its line (a vertical line is up to 255 pixels)
+#define SURFACE_RUN_REACH 288
+// the lines above a checkpoint may draw a little below it (a glyph moved down by its font change)
+#define ARTICLE_CHECKPOINT_MARGIN 64
+
+static PSURFACE_RESTART surface_restart;	// [RENDER_TILE_MAX]
+static int surface_restart_count;		// tiles with a restart state
+static SURFACE_RESTART surface_run;		// the run being drawn
+static bool surface_in_run;
+static int surface_run_last;			// last tile the run drew on
+static const unsigned char *surface_run_end;	// the article text is drawn up to here
+static int surface_regenerating = -1;		// tile being drawn again
+static unsigned char *surface_window;		// see lcd_draw_get_cur_buffer()
+static int last_positioner_y = 0;
+static bool article_previewed;			// the screen shows article_preview() until the next repaint
+
+static void draw_positioner_mark(int y);
+static void fill_article_run(const unsigned char *p);
+
+static void surface_reset(void)
+{
+	render_tile_clear();
+	surface_restart_count = 0;
+	surface_in_run = false;
+	surface_run_end = NULL;
+}
+
+static void surface_run_begin(const unsigned char *p)
+{
+	surface_run.pBuf = p;
+	surface_run.state = lcd_draw_buf;
+	surface_run_last = -1;
+	surface_in_run = true;
+}
+
+static void surface_run_finish(const unsigned char *p)
+{
+	surface_in_run = false;
+	while (surface_restart_count <= surface_run_last)
+		surface_restart[surface_restart_count++] = surface_run;
+	surface_run_end = p;
+}
+
+// draw the runs from p with the draw state *pState, only on tile idx
+static void surface_redraw(int idx, const unsigned char *p, const LCD_DRAW_BUF *pState)
+{
+	LCD_DRAW_BUF saved = lcd_draw_buf;
+	long y_end = (long)(idx + 1) * RENDER_TILE_HEIGHT + SURFACE_RUN_REACH;
+	int y;
+
+	surface_regenerating = idx;
+	lcd_draw_buf = *pState;
+	while (p != surface_run_end && lcd_draw_buf.current_y < y_end)
+	{
+		fill_article_run(p);
+		if (!*p)
+			break;
+		buf_draw_UTF8_str(&p);
+	}
+	lcd_draw_buf = saved;
+	if (bShowPositioner)
+	{
+		for (y = article_start_y_pos + LCD_HEIGHT / 2; y <= last_positioner_y; y += LCD_HEIGHT / 2)
+			draw_positioner_mark(y);
+	}
+	surface_regenerating = -1;
+}
+
+// draw the runs from the restart state of tile idx again
+static void surface_regenerate(int idx)
+{
+	surface_redraw(idx, surface_restart[idx].pBuf, &surface_restart[idx].state);
+}
+
+// tile idx for reading, drawn again if it was dropped; a tile never drawn on is only made when bCreate
+static unsigned char *surface_tile(int idx, bool bCreate)
+{
+	unsigned char *p;
+
+	if (idx < 0 || idx >= RENDER_TILE_MAX)
+		return NULL;
+	p = render_tile_find(idx);
+	if (!p && idx < surface_restart_count)
+	{
+		p = render_tile_new(idx);
+		surface_regenerate(idx);
+	}
+	else if (!p && bCreate)
+		p = render_tile_new(idx);
+	return p;
+}
+
+// tile idx for drawing on, NULL if it is not drawn on now
+static unsigned char *surface_draw_tile(int idx)
+{
+	unsigned char *p;
+
+	if (surface_regenerating >= 0)
+		return idx == surface_regenerating ? render_tile_find(idx) : NULL;
+	p = surface_tile(idx, true);
+	if (!p)
+		return NULL;
+	if (!surface_in_run)
+		render_tile_pin(idx);
+	else if (idx > surface_run_last)
+		surface_run_last = idx;
+	return p;
+}
+
+// row y of the surface for drawing on, NULL if it is not drawn on now
+static unsigned char *surface_draw_row(long y)
+{
+	int idx = RENDER_TILE_IDX(y);
+	unsigned char *p;
+
+	if (y < 0 || !(p = surface_draw_tile(idx)))
+		return NULL;
+	return p + (y - RENDER_TILE_ORIGIN(idx)) * LCD_BUF_WIDTH_BYTES;
+}
+
+// row y of the surface for reading, NULL if it is blank
+static const unsigned char *surface_row(long y)
+{
+	int idx = RENDER_TILE_IDX(y);
+	unsigned char *p;
+
+	if (y < 0 || !(p = surface_tile(idx, false)))
+		return NULL;
+	return p + (y - RENDER_TILE_ORIGIN(idx)) * LCD_BUF_WIDTH_BYTES;
+}
+
+static void surface_set_pixel(int x, long y)
+{
+	unsigned char *p;
+
+	if (x < 0 || x >= LCD_BUFFER_WIDTH || !(p = surface_draw_row(y)))
+		return;
+	p[x >> 3] |= 0x80 >> (x & 0x07);
+}
+
+// copy rows y.. of the surface to buf, from two tiles at most for a screen
+static void surface_copy_rows(unsigned char *buf, long y, int rows)
+{
+	unsigned char *p;
+	int idx;
+	int n;
+
+	while (rows > 0)
+	{
+		idx = RENDER_TILE_IDX(y);
+		n = (idx + 1) * RENDER_TILE_HEIGHT - y;
+		if (n > rows)
+			n = rows;
+		if ((p = surface_tile(idx, false)))
+			memcpy(buf, p + (y - RENDER_TILE_ORIGIN(idx)) * LCD_BUF_WIDTH_BYTES, n * LCD_BUF_WIDTH_BYTES);
+		else
+			memset(buf, 0, n * LCD_BUF_WIDTH_BYTES);
+		buf += n * LCD_BUF_WIDTH_BYTES;
+		y += n;
+		rows -= n;
+	}
+}
+
+static void surface_write_rows(long y, const unsigned char *buf, int rows)
+{
+	unsigned char *p;
+
+	for (; rows > 0; rows--, y++, buf += LCD_BUF_WIDTH_BYTES)
+	{
+		if ((p = surface_draw_row(y)))
+			memcpy(p, buf, LCD_BUF_WIDTH_BYTES);
+	}
+}
+
+static void surface_invert_area(int start_x, int start_y, int end_x, int end_y)
+{
+	unsigned char *p;
+	int idx;
+	int top, bottom;
+
+	for (idx = RENDER_TILE_IDX(start_y); idx <= RENDER_TILE_IDX(end_y); idx++)
+	{
+		if (!(p = surface_draw_tile(idx)))
+			continue;
+		top = idx * RENDER_TILE_HEIGHT;
+		if (top < start_y)
+			top = start_y;
+		bottom = (idx + 1) * RENDER_TILE_HEIGHT - 1;
+		if (bottom > end_y)
+			bottom = end_y;
+		guilib_buffer_invert_area(p, start_x, top - RENDER_TILE_ORIGIN(idx), end_x, bottom - RENDER_TILE_ORIGIN(idx));
+	}
+}
+
 #define MIN_BAR_LEN 20
 void show_scroll_bar(int bShow)
 {
@@ -174,6 +380,7 @@ void load_all_fonts()
 	for (i=0; i < FONT_COUNT; i++)
 	{
 		if (pcfFonts[i].fd == FONT_FD_NOT_INITED) {
+			glyph_cache_clear();
 			pcfFonts[i].fd = load_bmf(&pcfFonts[i]);
 			if (pcfFonts[i].fd < 0) {
 				fatal_error("Missing font file: %s", pcfFonts[i].file);
@@ -191,9 +398,12 @@ void init_lcd_draw_buf()
 	{
 		framebuffersize = framebuffer_size();
 		framebuffer_copy = (unsigned char*)memory_allocate(framebuffersize, "bufdraw1");
-		lcd_draw_buf.screen_buf = (unsigned char *)memory_allocate(LCD_BUF_WIDTH_BYTES * LCD_BUF_HEIGHT_PIXELS, "bufdraw2");
-		if (!framebuffer_copy || !lcd_draw_buf.screen_buf)
+		surface_window = (unsigned char *)memory_allocate(framebuffersize, "bufdraw2");
+		surface_restart = (PSURFACE_RESTART)memory_allocate(sizeof(SURFACE_RESTART) * RENDER_TILE_MAX, "bufdraw4");
+		if (!framebuffer_copy || !surface_window || !surface_restart)
 			fatal_error("lcd_draw_buf allocation error");
+		render_tile_init();
+		lcd_draw_buf.screen_buf = NULL; // the article is drawn on the tiles
 
 		for (i=0; i < FONT_COUNT; i++)
 		{
@@ -244,9 +454,7 @@ void init_lcd_draw_buf()
 	lcd_draw_buf.line_height = 0;
 	lcd_draw_buf.y_adjustment = 0;
 	nArticleRenderedLines = 0;
-
-	if (lcd_draw_buf.screen_buf)
-		memset(lcd_draw_buf.screen_buf, 0, LCD_BUF_WIDTH_BYTES * LCD_BUF_HEIGHT_PIXELS);
+	surface_reset();
 }
 
 void draw_string(const unsigned char *s)
@@ -261,11 +469,22 @@ void draw_string(const unsigned char *s)
 	//}
 }
 
-void draw_article_positioner(int y_pos)
+static void draw_positioner_mark(int y)
 {
-	static int last_positioner_y = 0;
+	surface_set_pixel(0, y - 2);
+	surface_set_pixel(0, y - 1);
+	surface_set_pixel(1, y - 1);
+	surface_set_pixel(0, y);
+	surface_set_pixel(1, y);
+	surface_set_pixel(2, y);
+	surface_set_pixel(0, y + 1);
+	surface_set_pixel(1, y + 1);
+	surface_set_pixel(0, y + 2);
+}
 
-	if (!bShowPositioner)
+void draw_article_positioner(int y_pos)
+{
+	if (!bShowPositioner || surface_regenerating >= 0)
 		return;
 	if (y_pos == 0)
 		last_positioner_y = article_start_y_pos;
@@ -274,15 +493,7 @@ void draw_article_positioner(int y_pos)
 		while (y_pos - last_positioner_y - article_start_y_pos > LCD_HEIGHT / 2)
 		{
 			last_positioner_y += LCD_HEIGHT / 2;
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 0, last_positioner_y - 2);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 0, last_positioner_y - 1);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 1, last_positioner_y - 1);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 0, last_positioner_y);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 1, last_positioner_y);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 2, last_positioner_y);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 0, last_positioner_y + 1);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 1, last_positioner_y + 1);
-			guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, 0, last_positioner_y + 2);
+			draw_positioner_mark(last_positioner_y);
 		}
 	}
 }
@@ -362,6 +573,7 @@ void buf_draw_UTF8_str(const unsigned char **pUTF8)
 	int nImageY;
 	int i, j;
 	int nByteIdx, nBitIdx;
+	unsigned char *pRow;
 
 	if (NULL == pUTF8 || NULL == *pUTF8) {
 		return;
@@ -521,7 +733,8 @@ void buf_draw_UTF8_str(const unsigned char **pUTF8)
 				nByteIdx = (lcd_draw_buf.current_x  + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment) / 8;
 				for (i = 0; i < nHeight; i++)
 				{
-					memcpy(&lcd_draw_buf.screen_buf[nImageY * LCD_BUF_WIDTH_BYTES + nByteIdx], *pUTF8, nBytes);
+					if ((pRow = surface_draw_row(nImageY)))
+						memcpy(pRow + nByteIdx, *pUTF8, nBytes);
 					*pUTF8 += (nWidth + 7) / 8;
 					nImageY++;
 				}
@@ -536,8 +749,8 @@ void buf_draw_UTF8_str(const unsigned char **pUTF8)
 						nBitIdx = 7 - (j % 8);
 						if ((*pUTF8)[nByteIdx] & (1 << nBitIdx))
 						{
-							guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, lcd_draw_buf.current_x +
-										LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment + j, nImageY);
+							surface_set_pixel(lcd_draw_buf.current_x + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment + j,
+									  nImageY);
 						}
 					}
 					*pUTF8 += (nWidth + 7) / 8;
@@ -556,7 +769,8 @@ void buf_draw_UTF8_str(const unsigned char **pUTF8)
 		const unsigned char *pTemp = *pUTF8; // save the position before UTF8_to_UCS4 changes pUTF8
 		if ((u = UTF8_to_UCS4(pUTF8)))
 		{
-			if ((lcd_draw_buf.current_x <= 0 || nArticleRenderedLines == 0) && nArticleRenderedLines < MAX_LINES_PER_ARTICLE)
+			if ((lcd_draw_buf.current_x <= 0 || nArticleRenderedLines == 0) && nArticleRenderedLines < MAX_LINES_PER_ARTICLE &&
+			    surface_regenerating < 0)
 			{
 				nArticleRenderedLines++;
 				pArticleRenderInfo[nArticleRenderedLines - 1].start_y = lcd_draw_buf.current_y;
@@ -566,12 +780,13 @@ void buf_draw_UTF8_str(const unsigned char **pUTF8)
 			}
 
 			buf_draw_char(u);
-			if(display_first_page==0 && lcd_draw_buf.current_y > LCD_HEIGHT + article_start_y_pos)
+			if(display_first_page==0 && lcd_draw_buf.current_y > LCD_HEIGHT + article_start_y_pos && surface_regenerating < 0)
 			{
 				display_first_page = 1;
 				lcd_draw_cur_y_pos = article_start_y_pos;
 				finger_move_speed = 0;
-				repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 0);
+				if (!article_previewed)
+					repaint_framebuffer(lcd_draw_cur_y_pos, 0);
 				if (lcd_draw_init_y_pos < article_start_y_pos)
 					lcd_draw_init_y_pos = article_start_y_pos;
 				if (lcd_draw_init_y_pos > article_start_y_pos)
@@ -634,16 +849,18 @@ void draw_language_link_arrow()
 	}
 }
 
-void repaint_framebuffer(unsigned char *buf, int pos, int b_repaint_invert_link)
+void repaint_framebuffer(int pos, int b_repaint_invert_link)
 {
 	(void)b_repaint_invert_link; // *** unused argument
 	int framebuffersize;
 	framebuffersize = framebuffer_size();
 
+	article_previewed = false;
+
 	guilib_fb_lock();
 	//guilib_clear();
 
-	memcpy(lcd_get_framebuffer(),buf+(pos < 0 ? 0 : pos)*LCD_BUFFER_WIDTH/8,framebuffersize);
+	surface_copy_rows(lcd_get_framebuffer(), pos < 0 ? 0 : pos, framebuffersize / (LCD_BUF_WIDTH_BYTES));
 	if (display_mode == DISPLAY_MODE_ARTICLE && (language_link_count || restricted_article) && (pos == article_start_y_pos || pos == 0))
 	{
 		draw_language_link_arrow();
@@ -668,7 +885,7 @@ void buf_draw_horizontal_line(unsigned long start_x, unsigned long end_x)
 
 	for(i = start_x;i<end_x;i++)
 	{
-		guilib_buffer_set_pixel(lcd_draw_buf.screen_buf,i, h_line_y);
+		surface_set_pixel(i, h_line_y);
 	}
 
 }
@@ -676,34 +893,36 @@ void buf_draw_horizontal_line(unsigned long start_x, unsigned long end_x)
 void buf_draw_vertical_line(unsigned long start_y, unsigned long end_y)
 {
 	unsigned long idx_in_byte;
+	unsigned long byte_idx;
 	unsigned char *p;
 
 	if (lcd_draw_buf.current_x + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment < LCD_BUF_WIDTH_PIXELS)
 	{
 		idx_in_byte = 7 - ((lcd_draw_buf.current_x + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment) & 0x07);
-		p = lcd_draw_buf.screen_buf + start_y * LCD_BUF_WIDTH_BYTES + ((lcd_draw_buf.current_x + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment)>> 3);
+		byte_idx = (lcd_draw_buf.current_x + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment) >> 3;
 		while (start_y <= end_y)
 		{
-			*p |= 1 << idx_in_byte;
+			if ((p = surface_draw_row(start_y)))
+				p[byte_idx] |= 1 << idx_in_byte;
 			start_y++;
-			p += LCD_BUF_WIDTH_BYTES;
 		}
 	}
 }
 
 char lcd_draw_buf_get_byte(int x, int y)
 {
-	unsigned int byte = (x + LCD_BUFFER_WIDTH * y) / 8;
+	const unsigned char *p = surface_row(y);
 
-	return lcd_draw_buf.screen_buf[byte];
+	if (!p)
+		return 0;
+	return p[x / 8];
 }
 
 int lcd_draw_buf_get_pixel(int x, int y)
 {
-	unsigned int byte = (x + LCD_BUFFER_WIDTH * y) / 8;
-	unsigned int bit  = (x + LCD_BUFFER_WIDTH * y) % 8;
+	const unsigned char *p = surface_row(y);
 
-	if (lcd_draw_buf.screen_buf[byte] & (1 << (7 - bit)))
+	if (p && (p[x / 8] & (1 << (7 - x % 8))))
 		return 1;
 	else
 		return 0;
@@ -711,76 +930,51 @@ int lcd_draw_buf_get_pixel(int x, int y)
 
 void buf_draw_char(ucs4_t u)
 {
-	bmf_bm_t *bitmap = NULL;
-	charmetric_bmf Cmetrics;
-	int bytes_to_process;
+	const GLYPH_CACHE_ENTRY *pGlyph;
 	int x_base;
 	int y_base;
-	int x_offset;
 	int y_offset;
-	int x_bit_idx;
-	int i; // bitmap byte index
-	int j; // bitmap bit index
-	unsigned char *p; // pointer to lcd draw buffer
-
-
+	int idx;
+	int idx_first;
+	int idx_last;
+	unsigned char *p;
 
-	if(pres_bmfbm(u, lcd_draw_buf.pPcfFont, &bitmap, &Cmetrics)<0)
+	pGlyph = glyph_cache_get(lcd_draw_buf.pPcfFont, u);
+	if (pGlyph == NULL)
 	{
 		return;
 	}
 	if(u==32)
 	{
-		lcd_draw_buf.current_x += Cmetrics.widthDevice;
+		lcd_draw_buf.current_x += pGlyph->Cmetrics.widthDevice;
 		return;
 	}
 
-	if (bitmap == NULL)
+	if (!pGlyph->bBitmap)
 		return;
 
-	bytes_to_process = Cmetrics.widthBytes * Cmetrics.height;
-
-	x_base = lcd_draw_buf.current_x + Cmetrics.LSBearing + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment;
+	x_base = lcd_draw_buf.current_x + pGlyph->Cmetrics.LSBearing + LCD_LEFT_MARGIN + lcd_draw_buf.x_adjustment;
 	if (x_base < LCD_BUF_WIDTH_PIXELS)
 	{ // only draw the chracter if there is space left before the right margin of the LCD screen
 		y_base = lcd_draw_buf.current_y + lcd_draw_buf.y_adjustment;
-		x_offset = 0;
-		y_offset = lcd_draw_buf.line_height - (lcd_draw_buf.pPcfFont->Fmetrics.descent + Cmetrics.ascent);
-
-		x_bit_idx = x_base & 0x07;
-		//p = lcd_draw_buf.screen_buf + (y_base + y_offset) * LCD_BUF_WIDTH_BYTES + (x_base >> 3);
-
-		for (i = 0; i < bytes_to_process; i++)
+		y_offset = lcd_draw_buf.line_height - (lcd_draw_buf.pPcfFont->Fmetrics.descent + pGlyph->Cmetrics.ascent);
+		// on both tiles if it crosses their edge, the glyph is within the guard rows of each
+		idx_first = RENDER_TILE_IDX(y_base + y_offset);
+		idx_last = RENDER_TILE_IDX(y_base + y_offset + pGlyph->Cmetrics.height - 1);
+		// a dropped tile is drawn again first, that fetches other glyphs and may reuse the entry of this one
+		for (idx = idx_first; idx <= idx_last; idx++)
+			surface_draw_tile(idx);
+		pGlyph = glyph_cache_get(lcd_draw_buf.pPcfFont, u);
+		if (pGlyph == NULL)
+			return;
+		for (idx = idx_first; idx <= idx_last; idx++)
 		{
-			j = 7;
-			while (j >= 0)
-			{
-				if (x_offset >= Cmetrics.widthBits)
-				{
-					x_offset = 0;
-					y_offset++;
-					p = lcd_draw_buf.screen_buf + (y_base + y_offset) * LCD_BUF_WIDTH_BYTES + x_base;
-				}
-				if (x_offset < Cmetrics.width)
-				{
-					if ((bitmap[i] & (1 << j)) && x_base + x_offset < LCD_BUF_WIDTH_PIXELS)
-					{
-						//*p |= 1 << ((x_base + x_offset) & 0x07);
-						guilib_buffer_set_pixel(lcd_draw_buf.screen_buf,x_base + x_offset, y_base+y_offset);
-					}
-				}
-				x_offset++;
-				x_bit_idx++;
-				if (!(x_bit_idx & 0x07))
-				{
-					x_bit_idx = 0;
-					p++;
-				}
-				j--;
-			}
+			if ((p = surface_draw_tile(idx)))
+				glyph_cache_draw(pGlyph, p, LCD_BUF_WIDTH_BYTES, x_base, y_base + y_offset - RENDER_TILE_ORIGIN(idx),
+						 LCD_BUF_WIDTH_PIXELS, GLYPH_BLIT_SET);
 		}
 	}
-	lcd_draw_buf.current_x += Cmetrics.widthDevice;
+	lcd_draw_buf.current_x += pGlyph->Cmetrics.widthDevice;
 }
 
 int get_external_str_pixel_width(const unsigned char *pIn, int font_idx)
@@ -884,71 +1078,34 @@ void buf_draw_char_external(LCD_DRAW_BUF *lcd_draw_buf_external,ucs4_t u,int sta
 	(void)start_y; // *** unused argument
 	(void)end_y; // *** unused argument
 
-	bmf_bm_t *bitmap = NULL;
-	charmetric_bmf Cmetrics;
-	int bytes_to_process;
+	const GLYPH_CACHE_ENTRY *pGlyph;
 	int x_base;
 	int y_base;
-	int x_offset;
 	int y_offset;
-	int x_bit_idx;
-	int i; // bitmap byte index
-	int j; // bitmap bit index
-	unsigned char *p; // pointer to lcd draw buffer
 
-	if(pres_bmfbm(u, lcd_draw_buf_external->pPcfFont, &bitmap, &Cmetrics)<0)
+	pGlyph = glyph_cache_get(lcd_draw_buf_external->pPcfFont, u);
+	if (pGlyph == NULL)
 		return;
 	if(u==32)
 	{
-		lcd_draw_buf_external->current_x += Cmetrics.widthDevice;
+		lcd_draw_buf_external->current_x += pGlyph->Cmetrics.widthDevice;
 		return;
 	}
-	if (bitmap == NULL)
+	if (!pGlyph->bBitmap)
 		return;
 
-	bytes_to_process = Cmetrics.widthBytes * Cmetrics.height;
-
-	x_base = lcd_draw_buf_external->current_x + Cmetrics.LSBearing;
-	if((lcd_draw_buf_external->current_x + Cmetrics.widthDevice) > end_x)
+	x_base = lcd_draw_buf_external->current_x + pGlyph->Cmetrics.LSBearing;
+	if((lcd_draw_buf_external->current_x + pGlyph->Cmetrics.widthDevice) > end_x)
 	{
 		lcd_draw_buf_external->current_x = start_x;
-		x_base =  Cmetrics.LSBearing;
+		x_base =  pGlyph->Cmetrics.LSBearing;
 		lcd_draw_buf_external->current_y+=lcd_draw_buf_external->line_height;
 	}
 	y_base = lcd_draw_buf_external->current_y + lcd_draw_buf_external->y_adjustment;
-	x_offset = 0;
-	y_offset = lcd_draw_buf_external->line_height - (lcd_draw_buf_external->pPcfFont->Fmetrics.descent + Cmetrics.ascent);
-	x_bit_idx = x_base & 0x07;
-
-	for (i = 0; i < bytes_to_process; i++)
-	{
-		j = 7;
-		while (j >= 0)
-		{
-			if (x_offset >= Cmetrics.widthBits)
-			{
-				x_offset = 0;
-				y_offset++;
-			}
-			if (x_offset < Cmetrics.width)
-			{
-				if (bitmap[i] & (1 << j))
-				{
-					guilib_buffer_set_pixel(lcd_draw_buf_external->screen_buf,x_base + x_offset, y_base+y_offset);
-				}
-
-			}
-			x_offset++;
-			x_bit_idx++;
-			if (!(x_bit_idx & 0x07))
-			{
-				x_bit_idx = 0;
-				p++;
-			}
-			j--;
-		}
-	}
-	lcd_draw_buf_external->current_x += Cmetrics.widthDevice;
+	y_offset = lcd_draw_buf_external->line_height - (lcd_draw_buf_external->pPcfFont->Fmetrics.descent + pGlyph->Cmetrics.ascent);
+	glyph_cache_draw(pGlyph, lcd_draw_buf_external->screen_buf, LCD_BUF_WIDTH_BYTES, x_base, y_base + y_offset,
+			 x_base + pGlyph->Cmetrics.width, GLYPH_BLIT_SET);
+	lcd_draw_buf_external->current_x += pGlyph->Cmetrics.widthDevice;
 }
 
 int get_UTF8_char_width(int idxFont, const unsigned char **pContent, long *lenContent, int *nCharBytes)
@@ -1038,8 +1195,7 @@ void init_render_article(long init_y_pos)
 	//if(lcd_draw_buf.current_y>0)
 	//  memset(lcd_draw_buf.screen_buf,0,lcd_draw_buf.current_y*LCD_BUFFER_WIDTH/8);
 	highlight_reset(-1, -1, false);
-	if (lcd_draw_buf.screen_buf)
-		memset(lcd_draw_buf.screen_buf, 0, LCD_BUF_WIDTH_BYTES * LCD_BUF_HEIGHT_PIXELS);
+	surface_reset();
 
 	article_buf_pointer = NULL;
 	lcd_draw_buf.current_x = 0;
@@ -1059,6 +1215,7 @@ void init_render_article(long init_y_pos)
 	finger_move_speed = 0;
 	lcd_draw_buf_pos = 0;
 	nArticleRenderedLines = 0;
+	article_previewed = false;
 }
 
 void render_wikipedia_license_text(void)
@@ -1074,7 +1231,7 @@ void render_wikipedia_license_text(void)
 		draw_lines = license_draw->lines;
 	else
 		draw_lines = LCD_BUF_HEIGHT_PIXELS - lcd_draw_buf.current_y;
-	memcpy(&lcd_draw_buf.screen_buf[lcd_draw_buf.current_y * LCD_BUF_WIDTH_BYTES], license_draw->buf, draw_lines * LCD_BUF_WIDTH_BYTES);
+	surface_write_rows(lcd_draw_buf.current_y, (const unsigned char *)license_draw->buf, draw_lines);
 	for (i = 0; i < license_draw->link_count; i++)
 	{
 		start_x = license_draw->links[i].start_xy & 0xFF;
@@ -1092,13 +1249,55 @@ void render_wikipedia_license_text(void)
 		lcd_draw_buf.current_y = LCD_BUF_HEIGHT_PIXELS;
 }
 
+// decode the escape at p and the run of text after it before they are drawn,
+// a run cut short would be wrapped differently
+static void fill_article_run(const unsigned char *p)
+{
+	long len;
+
+	if (!retrieve_article_fill(p, ARTICLE_STREAM_LOOKAHEAD))
+		return;
+	switch (*p)
+	{
+	case ESC_0_SPACE_LINE:
+	case ESC_3_NEW_LINE_WITH_FONT:
+	case ESC_4_CHANGE_FONT:
+	case ESC_7_FORWARD:
+	case ESC_8_BACKWARD:
+	case ESC_9_Y_ADJUSTMENT:
+	case ESC_10_HORIZONTAL_LINE:
+	case ESC_11_VERTICAL_LINE:
+		len = 2;
+		break;
+	case ESC_14_BITMAP:
+		len = 4 + ((p[1] + 7) / 8) * (p[2] | (p[3] << 8));
+		if (!retrieve_article_fill(p, len + ARTICLE_STREAM_LOOKAHEAD))
+			return;
+		break;
+	default:
+		len = *p && *p <= MAX_ESC_CHAR ? 1 : 0;
+		break;
+	}
+	// while decoding, the text stops at a '\0' after the last byte decoded
+	for (p += len;;)
+	{
+		while (*p > MAX_ESC_CHAR)
+			p++;
+		if (*p || !retrieve_article_fill(p, ARTICLE_STREAM_LOOKAHEAD))
+			break;
+	}
+}
+
 int render_article_with_pcf()
 {
 
 	if (!article_buf_pointer)
 		return 0;
 
+	fill_article_run(article_buf_pointer);
+	surface_run_begin(article_buf_pointer);
 	buf_draw_UTF8_str(&article_buf_pointer);
+	surface_run_finish(article_buf_pointer);
 	if(stop_render_article == 1 && display_first_page == 1)
 	{
 		article_buf_pointer = NULL;
@@ -1124,7 +1323,7 @@ int render_article_with_pcf()
 				lcd_draw_cur_y_pos = article_start_y_pos;
 			}
 		}
-		repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+		repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 		request_display_next_page = 0;
 	}
 	if(!*article_buf_pointer)
@@ -1159,7 +1358,7 @@ int render_article_with_pcf()
 			else if(display_first_page==0 && lcd_draw_cur_y_pos < article_start_y_pos)
 				lcd_draw_cur_y_pos = article_start_y_pos;
 
-			repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+			repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 			display_first_page = 1;
 			request_display_next_page = 0;
 		}
@@ -1225,7 +1424,7 @@ int render_wiki_selection_with_pcf()
 			rendered_wiki_selection_count = -1;
 			if(display_first_page == 0)
 			{
-				repaint_framebuffer(lcd_draw_buf.screen_buf,0, 0);
+				repaint_framebuffer(0, 0);
 				display_first_page = 1;
 			}
 			else if (request_display_next_page > 0)
@@ -1234,7 +1433,7 @@ int render_wiki_selection_with_pcf()
 				if (y_pos < 0)
 					y_pos = 0;
 				lcd_draw_cur_y_pos = y_pos;
-				repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+				repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 				request_display_next_page = 0;
 			}
 		}
@@ -1248,7 +1447,7 @@ int render_wiki_selection_with_pcf()
 		if(request_display_next_page > 0 && lcd_draw_buf.current_y >= request_y_pos+LCD_HEIGHT)
 		{
 			lcd_draw_cur_y_pos = request_y_pos;
-			repaint_framebuffer(lcd_draw_buf.screen_buf,lcd_draw_cur_y_pos, 1);
+			repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 			request_display_next_page = 0;
 		}
 	}
@@ -1259,7 +1458,6 @@ int render_wiki_selection_with_pcf()
 
 extern int history_count;
 extern int rendered_history_count;
-extern HISTORY history_list[MAX_HISTORY];
 int render_history_with_pcf()
 {
 	int rc = 0;
@@ -1297,7 +1495,7 @@ int render_history_with_pcf()
 		lcd_draw_buf.line_height = pcfFonts[SEARCH_LIST_FONT_IDX - 1].Fmetrics.linespace;
 		draw_string(get_nls_text("no_history"));
 		rendered_history_count = -1;
-		repaint_framebuffer(lcd_draw_buf.screen_buf,0, 0);
+		repaint_framebuffer(0, 0);
 		display_first_page = 1;
 	} else if (rendered_history_count < history_count) {
 		start_x = 0;
@@ -1321,7 +1519,7 @@ int render_history_with_pcf()
 			rendered_history_count = -1;
 			if(display_first_page == 0)
 			{
-				repaint_framebuffer(lcd_draw_buf.screen_buf,0, 0);
+				repaint_framebuffer(0, 0);
 				display_first_page = 1;
 			}
 			else if (request_display_next_page > 0)
@@ -1330,7 +1528,7 @@ int render_history_with_pcf()
 				if (y_pos < 0)
 					y_pos = 0;
 				lcd_draw_cur_y_pos = y_pos;
-				repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+				repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 				request_display_next_page = 0;
 			}
 		}
@@ -1344,7 +1542,7 @@ int render_history_with_pcf()
 		if(request_display_next_page > 0 && lcd_draw_buf.current_y >= request_y_pos+LCD_HEIGHT)
 		{
 			lcd_draw_cur_y_pos = request_y_pos;
-			repaint_framebuffer(lcd_draw_buf.screen_buf,lcd_draw_cur_y_pos, 1);
+			repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 			request_display_next_page = 0;
 		}
 	}
@@ -1360,7 +1558,7 @@ void restore_search_list_page(void)
 	{
 		more_search_results = 0;
 		article_link_count = NUMBER_OF_FIRST_PAGE_RESULTS;
-		memcpy(lcd_get_framebuffer(), lcd_draw_buf.screen_buf, framebuffer_size()); // copy from the LCD frame buffer (for the first page)
+		surface_copy_rows(lcd_get_framebuffer(), 0, framebuffer_size() / (LCD_BUF_WIDTH_BYTES)); // copy to the LCD frame buffer (for the first page)
 	}
 }
 
@@ -1383,7 +1581,7 @@ int render_search_result_with_pcf(void)
 	{
 		offset_next = result_list_offset_next();
 		init_render_article(0);
-		memcpy(lcd_draw_buf.screen_buf, lcd_get_framebuffer(), framebuffer_size()); // copy from the LCD frame buffer (for the first page)
+		surface_write_rows(0, lcd_get_framebuffer(), framebuffer_size() / (LCD_BUF_WIDTH_BYTES)); // copy from the LCD frame buffer (for the first page)
 		display_first_page = 1;
 		lcd_draw_buf.pPcfFont = &pcfFonts[SEARCH_LIST_FONT_IDX - 1];
 		lcd_draw_buf.line_height = RESULT_HEIGHT;
@@ -1425,7 +1623,7 @@ int render_search_result_with_pcf(void)
 			if(request_display_next_page > 0 && lcd_draw_buf.current_y >= request_y_pos+LCD_HEIGHT)
 			{
 				lcd_draw_cur_y_pos = request_y_pos;
-				repaint_framebuffer(lcd_draw_buf.screen_buf,lcd_draw_cur_y_pos, 1);
+				repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 				request_display_next_page = 0;
 			}
 		}
@@ -1438,7 +1636,7 @@ int render_search_result_with_pcf(void)
 				if (y_pos < 0)
 					y_pos = 0;
 				lcd_draw_cur_y_pos = y_pos;
-				repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+				repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 				request_display_next_page = 0;
 			}
 		}
@@ -1459,7 +1657,8 @@ void display_article_with_pcf(int y_move)
 		request_display_next_page = 1;
 		request_y_pos = lcd_draw_cur_y_pos + y_move + LCD_HEIGHT;
 
-		display_str(get_nls_text("please_wait"));
+		if (!article_previewed)
+			display_str(get_nls_text("please_wait"));
 
 		return;
 	}
@@ -1490,7 +1689,7 @@ void display_article_with_pcf(int y_move)
 			history_log_y_pos(0);
 	}
 
-	repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+	repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 	display_first_page = 1;
 }
 
@@ -1565,7 +1764,7 @@ void scroll_article(void)
 			}
 		}
 
-		repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 1);
+		repaint_framebuffer(lcd_draw_cur_y_pos, 1);
 
 		if (finger_move_speed == 0 && b_show_scroll_bar)
 		{
@@ -1579,6 +1778,8 @@ void draw_icon(const unsigned char *pStr)
 {
 	int start_x, start_y, end_x, end_y;
 	int i, j;
+	int idx;
+	unsigned char *p;
 
 	get_external_str_pixel_rectangle(pStr, SUBTITLE_FONT_IDX, &start_x, &start_y, &end_x, &end_y);
 	for (i = 0; i < LANGUAGE_LINK_HEIGHT; i++)
@@ -1587,21 +1788,26 @@ void draw_icon(const unsigned char *pStr)
 		{
 			for (j = lcd_draw_buf.current_x + LCD_LEFT_MARGIN + 1; j < lcd_draw_buf.current_x + LCD_LEFT_MARGIN + LANGUAGE_LINK_WIDTH - 2; j++)
 			{
-				guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, j, lcd_draw_buf.current_y + i);
+				surface_set_pixel(j, lcd_draw_buf.current_y + i);
 			}
 		}
 		else if (1 < i && i < LANGUAGE_LINK_HEIGHT - 2)
 		{
 			for (j = lcd_draw_buf.current_x + LCD_LEFT_MARGIN; j < lcd_draw_buf.current_x + LCD_LEFT_MARGIN + LANGUAGE_LINK_WIDTH - 1; j++)
 			{
-				guilib_buffer_set_pixel(lcd_draw_buf.screen_buf, j, lcd_draw_buf.current_y + i);
+				surface_set_pixel(j, lcd_draw_buf.current_y + i);
 			}
 		}
 	}
-	buf_render_string(lcd_draw_buf.screen_buf, LCD_BUF_WIDTH_PIXELS, LCD_BUF_WIDTH_BYTES,
-			  SUBTITLE_FONT_IDX, lcd_draw_buf.current_x + LCD_LEFT_MARGIN +
-			  (LANGUAGE_LINK_WIDTH - (end_x - start_x + 1)) / 2 - start_x,
-			  lcd_draw_buf.current_y + (LANGUAGE_LINK_HEIGHT - (end_y - start_y + 1)) / 2 - start_y, pStr, ustrlen(pStr), 1);
+	for (idx = RENDER_TILE_IDX(lcd_draw_buf.current_y); idx <= RENDER_TILE_IDX(lcd_draw_buf.current_y + LANGUAGE_LINK_HEIGHT - 1); idx++)
+	{
+		if ((p = surface_draw_tile(idx)))
+			buf_render_string(p, LCD_BUF_WIDTH_PIXELS, LCD_BUF_WIDTH_BYTES,
+					  SUBTITLE_FONT_IDX, lcd_draw_buf.current_x + LCD_LEFT_MARGIN +
+					  (LANGUAGE_LINK_WIDTH - (end_x - start_x + 1)) / 2 - start_x,
+					  lcd_draw_buf.current_y + (LANGUAGE_LINK_HEIGHT - (end_y - start_y + 1)) / 2 - start_y -
+					  RENDER_TILE_ORIGIN(idx), pStr, ustrlen(pStr), 1);
+	}
 	lcd_draw_buf.current_x += LANGUAGE_LINK_WIDTH + LANGUAGE_LINK_WIDTH_GAP;
 }
 
@@ -1652,11 +1858,80 @@ void add_show_hide_language_link()
 	lcd_draw_buf.y_adjustment = 0;
 }
 
+// Show the screen the article is opened at before the article is drawn down to it: its text is
+// drawn on the tiles of that screen from the last checkpoint above it.  The tiles are dropped
+// again, the article is drawn from its start as usual and replaces the screen when it gets there.
+// A table with an offset past the end of the text or not in ascending order is not used.
+static void article_preview(const unsigned char *pCheckpoints, int nCheckpoints, uint32_t text_len)
+{
+	ARTICLE_CHECKPOINT checkpoint;
+	LCD_DRAW_BUF state;
+	const unsigned char *p = NULL;
+	uint32_t offset_previous = 0;
+	uint32_t y_previous = 0;
+	long y;
+	int font_idx;
+	int first, last;
+	int idx;
+	int i;
+
+	if (lcd_draw_init_y_pos <= article_start_y_pos)
+		return;
+	y = article_start_y_pos + lcd_draw_init_y_pos;
+	first = RENDER_TILE_IDX(y);
+	last = RENDER_TILE_IDX(y + LCD_HEIGHT - 1);
+	if (last >= RENDER_TILE_MAX)
+		return;
+	for (idx = first; idx <= last; idx++)
+	{
+		if (render_tile_find(idx)) // the language links
+			return;
+	}
+
+	for (i = 0; i < nCheckpoints; i++)
+	{
+		memcpy(&checkpoint, pCheckpoints + i * sizeof(ARTICLE_CHECKPOINT), sizeof(ARTICLE_CHECKPOINT));
+		if (checkpoint.offset > text_len ||
+		    (i && (checkpoint.offset <= offset_previous || checkpoint.y <= y_previous)))
+			return;
+		offset_previous = checkpoint.offset;
+		y_previous = checkpoint.y;
+		if (article_start_y_pos + (long)checkpoint.y + ARTICLE_CHECKPOINT_MARGIN > y ||
+		    article_start_y_pos + (long)checkpoint.y + checkpoint.line_height >= LCD_BUF_HEIGHT_PIXELS)
+			break;
+		font_idx = checkpoint.font_idx;
+		if (font_idx < 1 || font_idx > FONT_COUNT)
+			font_idx = DEFAULT_FONT_IDX;
+		p = article_buf_pointer + checkpoint.offset;
+		state = lcd_draw_buf;
+		state.current_x = 0;
+		state.current_y = article_start_y_pos + checkpoint.y;
+		state.pPcfFont = &pcfFonts[font_idx - 1];
+		state.line_height = checkpoint.line_height;
+		state.actual_height = checkpoint.line_height;
+		state.y_adjustment = 0;
+		state.x_adjustment = checkpoint.x_adjustment;
+	}
+	if (!p)
+		return;
+
+	for (idx = first; idx <= last; idx++)
+	{
+		render_tile_new(idx);
+		surface_redraw(idx, p, &state);
+	}
+	repaint_framebuffer(y, 0);
+	for (idx = first; idx <= last; idx++)
+		render_tile_drop(idx);
+	article_previewed = true;
+}
+
 void display_retrieved_article(long idx_article)
 {
 	int i;
 	unsigned int offset;
 	ARTICLE_HEADER article_header;
+	const unsigned char *pCheckpoints;
 	unsigned char title[MAX_TITLE_ACTUAL];
 	int bKeepPos = 0;
 	int nCurrentWikiId = get_wiki_id_from_idx(nCurrentWiki);
@@ -1675,7 +1950,7 @@ void display_retrieved_article(long idx_article)
 		init_render_article(0);
 	}
 	memset(articleLinkBeforeAfter, 0, sizeof(articleLinkBeforeAfter));
-	memcpy(&article_header,file_buffer,sizeof(ARTICLE_HEADER));
+	memcpy(&article_header,article_buffer,sizeof(ARTICLE_HEADER));
 	articleLink[0].start_xy = 0;
 	articleLink[0].end_xy = 0;
 	articleLink[0].article_id = PREVIOUS_ARTICLE_LINK;
@@ -1684,6 +1959,8 @@ void display_retrieved_article(long idx_article)
 	language_link_count = 0;
 
 	offset = sizeof(ARTICLE_HEADER) + sizeof(ARTICLE_LINK) * article_header.article_link_count;
+	pCheckpoints = article_buffer + offset;
+	offset += sizeof(ARTICLE_CHECKPOINT) * article_header.checkpoint_count;
 	// externalLink[] is for storing the pointer to the language link string.
 	// A corresponding artileLink (with the same index) will be used to store the start_xy and end_xy information.
 	// The corresponding articleLink.article_id will be set to EXTERNAL_ARTICLE_LINK for distinguishing with normal article links.
@@ -1692,7 +1969,7 @@ void display_retrieved_article(long idx_article)
 		while (offset < article_header.offset_article && article_link_count < MAX_EXTERNAL_LINKS)
 		{
 			unsigned char *link_str;
-			link_str = file_buffer + offset;
+			link_str = article_buffer + offset;
 			if (wiki_lang_exist(link_str))
 			{
 				int bDuplicated = 0;
@@ -1728,7 +2005,7 @@ void display_retrieved_article(long idx_article)
 					language_link_count++;
 				}
 			}
-			offset += ustrlen(file_buffer + offset) + 1;
+			offset += ustrlen(article_buffer + offset) + 1;
 		}
 	}
 
@@ -1765,7 +2042,7 @@ void display_retrieved_article(long idx_article)
 	offset = sizeof(ARTICLE_HEADER);
 	for(i = 0; i < article_header.article_link_count && article_link_count < MAX_ARTICLE_LINKS; i++)
 	{
-		memcpy(&articleLink[article_link_count],file_buffer+offset,sizeof(ARTICLE_LINK));
+		memcpy(&articleLink[article_link_count],article_buffer+offset,sizeof(ARTICLE_LINK));
 		nLinkWikiId = articleLink[article_link_count].article_id >> 24;
 		if (((!nArticleWikiId || nArticleWikiId == nCurrentWikiId || get_wiki_idx_from_id(nArticleWikiId) >= 0) && !nLinkWikiId) ||
 		    (nLinkWikiId && get_wiki_idx_from_id(nLinkWikiId) >= 0))
@@ -1786,7 +2063,12 @@ void display_retrieved_article(long idx_article)
 		offset+=sizeof(ARTICLE_LINK);
 	}
 
-	article_buf_pointer = file_buffer+article_header.offset_article;
+	article_buf_pointer = article_buffer+article_header.offset_article;
+	// the checkpoints are only used if the table is before the text
+	if (pCheckpoints + sizeof(ARTICLE_CHECKPOINT) * article_header.checkpoint_count <= article_buf_pointer &&
+	    article_header.offset_article < article_buffer_len)
+		article_preview(pCheckpoints, article_header.checkpoint_count,
+				article_buffer_len - article_header.offset_article);
 
 	display_first_page = 0; // use this to disable scrolling until the first page of the linked article is loaded
 	//get_article_title_from_idx(idx_article, title);
@@ -1978,6 +2260,39 @@ void display_link_article(long idx_article)
 	display_retrieved_article(idx_article);
 }
 
+// Read ahead the articles likely opened next in the idle time: the previous article, the links
+// on the screen from the top, then the articles read last. Return 1 if there may be more to do.
+int article_prefetch(void)
+{
+	static long planned_idx_article = 0;
+	static int planned_y_pos = -1;
+	event_t ev;
+	long y;
+	int i;
+
+	if (article_buf_pointer || !saved_idx_article)
+		return 0;
+	if (planned_idx_article != saved_idx_article || planned_y_pos != lcd_draw_cur_y_pos)
+	{
+		planned_idx_article = saved_idx_article;
+		planned_y_pos = lcd_draw_cur_y_pos;
+		article_prefetch_clear();
+		article_prefetch_add(history_peek_previous_idx(saved_idx_article));
+		for (i = 0; i < article_link_count; i++)
+		{
+			y = (articleLink[i].start_xy >> 8) & 0xFFFFFF;
+			if (y >= lcd_draw_cur_y_pos && y < lcd_draw_cur_y_pos + LCD_HEIGHT &&
+			    (articleLink[i].article_id & 0xFFFFFF) && (articleLink[i].article_id & 0xFFFFFF) < HIDE_LANGUAGE_LINK)
+				article_prefetch_add(articleLink[i].article_id);
+		}
+		for (i = 0; i < (int)history_get_count(); i++)
+			article_prefetch_add(history_list[i].idx_article);
+	}
+	if (event_peek(&ev) != EVENT_NONE)
+		return 0;
+	return article_prefetch_step();
+}
+
 void display_str(const unsigned char *str)
 {
 	int start_x,end_x,start_y,end_y;
@@ -2005,7 +2320,11 @@ void display_str(const unsigned char *str)
 	//offset_y = 0;
 	buf_draw_UTF8_str_in_copy_buffer(framebuffer_copy,&str,start_x,end_x,start_y,end_y,offset_x,DEFAULT_FONT_IDX);
 
-	repaint_framebuffer(framebuffer_copy,-1, 0);
+	guilib_fb_lock();
+	memcpy(lcd_get_framebuffer(), framebuffer_copy, framebuffer_size());
+	if (b_show_scroll_bar)
+		show_scroll_bar(1);
+	guilib_fb_unlock();
 
 }
 
@@ -2452,40 +2771,33 @@ int draw_bmf_char(ucs4_t u,int font,int x,int y, int inverted, int b_clear)
 int buf_draw_bmf_char(unsigned char *buf, int buf_width_pixels, int buf_width_bytes,
 		      ucs4_t u,int font,int x,int y, int inverted, int b_clear)
 {
-	bmf_bm_t *bitmap = NULL;
-	charmetric_bmf Cmetrics;
+	const GLYPH_CACHE_ENTRY *pGlyph;
 	//pcf_SCcharmet_t sm;
-	int bytes_to_process;
 	int x_base;
-	int x_offset;
 	int y_offset;
-	int x_bit_idx;
-	int i; // bitmap byte index
-	int j; // bitmap bit index
+	int i;
+	int j;
 	pcffont_bmf_t *pPcfFont;
 	unsigned int byte;
 	unsigned int bit;
 
 	pPcfFont = &pcfFonts[font];
 
-	pres_bmfbm(u, pPcfFont, &bitmap, &Cmetrics);
-	if (bitmap == NULL)
+	pGlyph = glyph_cache_get(pPcfFont, u);
+	if (pGlyph == NULL || !pGlyph->bBitmap)
 	{
 		return -1;
 	}
 
-	bytes_to_process = Cmetrics.widthBytes * Cmetrics.height;
-	x_base = x + Cmetrics.LSBearing;
-	x_offset = 0;
-	y_offset = pPcfFont->Fmetrics.linespace - (pPcfFont->Fmetrics.descent + Cmetrics.ascent);
-	x_bit_idx = x_base & 0x07;
+	x_base = x + pGlyph->Cmetrics.LSBearing;
+	y_offset = pPcfFont->Fmetrics.linespace - (pPcfFont->Fmetrics.descent + pGlyph->Cmetrics.ascent);
 
 	if (b_clear)
 	{
 		for (i = 0; i <= pPcfFont->Fmetrics.linespace; i++)
 			// need to clear 1 pixel more than linespace for subtitle font
 		{
-			for (j = 0; j < Cmetrics.widthDevice; j++)
+			for (j = 0; j < pGlyph->Cmetrics.widthDevice; j++)
 			{
 				byte = ((x + j) + buf_width_bytes * 8 * (y + i)) / 8;
 				bit  = ((x + j) + buf_width_bytes * 8 * (y + i)) % 8;
@@ -2498,50 +2810,16 @@ int buf_draw_bmf_char(unsigned char *buf, int buf_width_pixels, int buf_width_by
 	}
 	if(u==32)
 	{
-		x += Cmetrics.widthDevice;
+		x += pGlyph->Cmetrics.widthDevice;
 		return x;
 	}
 
-	if (x + Cmetrics.widthDevice >= buf_width_pixels)
+	if (x + pGlyph->Cmetrics.widthDevice >= buf_width_pixels)
 		return -1;
 
-	for (i = 0; i < bytes_to_process; i++)
-	{
-		j = 7;
-		while (j >= 0)
-		{
-			if (x_offset >= Cmetrics.widthBits)
-			{
-				x_offset = 0;
-				y_offset++;
-			}
-			if (x_offset < Cmetrics.width)
-			{
-				byte = ((x_base+x_offset) + buf_width_bytes * 8 * (y+y_offset)) / 8;
-				bit  = ((x_base+x_offset) + buf_width_bytes * 8 * (y+y_offset)) % 8;
-				if (bitmap[i] & (1 << j))
-				{
-					if (inverted)
-					{
-						buf[byte] ^= (1 << (7 - bit));
-					}
-					else
-					{
-						buf[byte] |= (1 << (7 - bit));
-					}
-				}
-			}
-			x_offset++;
-			x_bit_idx++;
-			if (!(x_bit_idx & 0x07))
-			{
-				x_bit_idx = 0;
-
-			}
-			j--;
-		}
-	}
-	x += Cmetrics.widthDevice;
+	glyph_cache_draw(pGlyph, buf, buf_width_bytes, x_base, y + y_offset, x_base + pGlyph->Cmetrics.width,
+			 inverted ? GLYPH_BLIT_INVERT : GLYPH_BLIT_SET);
+	x += pGlyph->Cmetrics.widthDevice;
 	return x;
 }
 
@@ -2574,7 +2852,7 @@ void extract_title_from_article(unsigned char *article_buf, unsigned char *title
 	int lenTitle = 0;
 
 	if (!article_buf)
-		article_buf = file_buffer;
+		article_buf = article_buffer;
 	memcpy(&article_header, article_buf, sizeof(ARTICLE_HEADER));
 	article_buf += article_header.offset_article;
 
@@ -2970,7 +3248,7 @@ void draw_highlight_area(int start_line, int end_line, int start_x, int end_x,
 				ye = pArticleRenderInfo[i + 1].start_y - 1;
 			else
 				ye = pArticleRenderInfo[i].end_y;
-			guilib_buffer_invert_area(lcd_draw_buf.screen_buf, xs, ys, xe, ye);
+			surface_invert_area(xs, ys, xe, ye);
 		}
 	}
 
@@ -3020,7 +3298,7 @@ void draw_highlight_area(int start_line, int end_line, int start_x, int end_x,
 				ye = pArticleRenderInfo[i + 1].start_y - 1;
 			else
 				ye = pArticleRenderInfo[i].end_y;
-			guilib_buffer_invert_area(lcd_draw_buf.screen_buf, xs, ys, xe, ye);
+			surface_invert_area(xs, ys, xe, ye);
 
 			if (i == iLineStart)
 			{
@@ -3061,7 +3339,7 @@ void draw_highlight_area(int start_line, int end_line, int start_x, int end_x,
 		iLineStart = -1;
 	}
 	if (bRepaint)
-		repaint_framebuffer(lcd_draw_buf.screen_buf, lcd_draw_cur_y_pos, 0);
+		repaint_framebuffer(lcd_draw_cur_y_pos, 0);
 }
 
 bool lcd_draw_highlight(int start_x, int start_y, int end_x, int end_y,
@@ -3100,9 +3378,11 @@ bool lcd_draw_highlight(int start_x, int start_y, int end_x, int end_y,
 		return false;
 }
 
+// the rows on the screen, composed from the tiles
 unsigned char *lcd_draw_get_cur_buffer()
 {
-	return &lcd_draw_buf.screen_buf[lcd_draw_cur_y_pos * LCD_BUF_WIDTH_BYTES];
+	surface_copy_rows(surface_window, lcd_draw_cur_y_pos, framebuffer_size() / (LCD_BUF_WIDTH_BYTES));
+	return surface_window;
 }
 
 int lcd_draw_get_cur_y_pos()
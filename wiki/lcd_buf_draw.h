@@ -242,16 +242,16 @@ typedef struct _LCD_DRAW_BUF
 /* Structure of a single article in a file with mutiple articles */
 /* byte 0~3: (long) offset from the beginning of the article header to the start of article text */
 /* byte 4~5: (short) number of ARTICLE_LINK blocks */
-/* byte 6~7: (short) number of EXTERNAL_LINK blocks */
+/* byte 6~7: (short) number of ARTICLE_CHECKPOINT blocks */
 /* section for a number of ARTICLE_LINK blocks */
-/* section for a number of EXTERNAL_LINK blocks */
+/* section for a number of ARTICLE_CHECKPOINT blocks */
 /* section for a number of external link strings */
 /* section for the article string */
 typedef struct __attribute__ ((packed)) _ARTICLE_HEADER
 {
 	uint32_t offset_article;
 	uint16_t article_link_count;
-	uint16_t external_link_count;
+	uint16_t checkpoint_count;
 } ARTICLE_HEADER;
 
 typedef struct __attribute__ ((packed)) _ARTICLE_LINK
@@ -261,6 +261,16 @@ typedef struct __attribute__ ((packed)) _ARTICLE_LINK
 	uint32_t article_id;
 } ARTICLE_LINK;
 
+/* the draw state just after a new line escape, every few screens of the article (ascending y) */
+typedef struct __attribute__ ((packed)) _ARTICLE_CHECKPOINT
+{
+	uint32_t offset; /* of the text after the escape, from the start of the article text */
+	uint32_t y; /* of the new line, from the start of the article text */
+	uint8_t line_height;
+	uint8_t font_idx;
+	int16_t x_adjustment;
+} ARTICLE_CHECKPOINT;
+
 typedef struct __attribute__ ((packed)) _EXTERNAL_LINK
 {
 	unsigned char *link_str;
@@ -289,6 +299,7 @@ void buf_draw_vertical_line(unsigned long start_y, unsigned long end_y);
 void buf_draw_char(ucs4_t u);
 int get_UTF8_char_width(int idxFont, const unsigned char **pContent, long *lenContent, int *nCharBytes);
 int render_article_with_pcf();
+int article_prefetch(void);
 int render_history_with_pcf();
 int render_wiki_selection_with_pcf();
 void restore_search_list_page(void);
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "lz4_dec.h"
+
+static int read_length(const unsigned char **pp, const unsigned char *pEnd, uint32_t *pLen)
+{
+	unsigned char c;
+
+	do
+	{
+		if (*pp >= pEnd)
+			return -1;
+		c = *(*pp)++;
+		*pLen += c;
+	} while (c == 255);
+	return 0;
+}
+
+// decode up to *pDestLen bytes, return 0 with *pDestLen set to the bytes decoded or -1 if src is corrupt
+int lz4_decode(unsigned char *dest, uint32_t *pDestLen, const unsigned char *src, uint32_t srcLen)
+{
+	const unsigned char *ip = src;
+	const unsigned char *ipEnd = src + srcLen;
+	unsigned char *op = dest;
+	unsigned char *opEnd = dest + *pDestLen;
+	const unsigned char *match;
+	uint32_t len;
+	uint32_t offset;
+	unsigned char token;
+
+	while (ip < ipEnd && op < opEnd)
+	{
+		token = *ip++;
+
+		len = token >> 4;
+		if (len == 15 && read_length(&ip, ipEnd, &len))
+			return -1;
+		if (len > (uint32_t)(ipEnd - ip))
+			return -1;
+		if (len > (uint32_t)(opEnd - op))
+			len = opEnd - op;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+		if (ip >= ipEnd || op >= opEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (!offset || offset > (uint32_t)(op - dest))
+			return -1;
+		len = token & 0x0f;
+		if (len == 15 && read_length(&ip, ipEnd, &len))
+			return -1;
+		len += 4;
+		if (len > (uint32_t)(opEnd - op))
+			len = opEnd - op;
+		// the match may overlap the bytes it produces
+		match = op - offset;
+		while (len--)
+			*op++ = *match++;
+	}
+	*pDestLen = op - dest;
+	return 0;
+}
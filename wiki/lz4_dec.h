@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LZ4_DEC_H
+#define LZ4_DEC_H
+
+#include <inttypes.h>
+
+// LZ4 block format (no frame): sequences of
+//   token: literal length (high 4 bits), match length - 4 (low 4 bits), 15 = more length bytes follow
+//   [255...] literal length, literals, uint16_t match offset, [255...] match length
+// the last sequence has the literals only
+int lz4_decode(unsigned char *dest, uint32_t *pDestLen, const unsigned char *src, uint32_t srcLen);
+
+#endif
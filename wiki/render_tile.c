@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <grifo.h>
+
+#include "lcd_buf_draw.h"
+#include "render_tile.h"
+#include "wikilib.h"
+
+#define RENDER_TILE_BYTES (RENDER_TILE_ROWS * LCD_BUF_WIDTH_BYTES)
+
+typedef struct _RENDER_TILE {
+	int idx;			// tile of the surface, -1 if free
+	bool bPinned;
+	uint32_t last_used;
+} RENDER_TILE, *PRENDER_TILE;
+
+static RENDER_TILE render_tiles[RENDER_TILE_COUNT];
+static unsigned char *render_tile_buf;
+static uint32_t nRenderTileClock;
+static int nRenderTileLast;	// slot found last, most draws are on the same tile
+
+void render_tile_init(void)
+{
+	if (!render_tile_buf)
+	{
+		render_tile_buf = (unsigned char *)memory_allocate(RENDER_TILE_COUNT * RENDER_TILE_BYTES, "rendertile");
+		if (!render_tile_buf)
+			fatal_error("render_tile allocation error");
+	}
+	render_tile_clear();
+}
+
+// drop all the tiles, e.g. before drawing another article
+void render_tile_clear(void)
+{
+	int i;
+
+	for (i = 0; i < RENDER_TILE_COUNT; i++)
+	{
+		render_tiles[i].idx = -1;
+		render_tiles[i].bPinned = false;
+	}
+	nRenderTileLast = 0;
+}
+
+static int render_tile_slot(int idx)
+{
+	int i;
+
+	if (render_tiles[nRenderTileLast].idx == idx)
+		return nRenderTileLast;
+	for (i = 0; i < RENDER_TILE_COUNT; i++)
+	{
+		if (render_tiles[i].idx == idx)
+		{
+			nRenderTileLast = i;
+			return i;
+		}
+	}
+	return -1;
+}
+
+// the memory of tile idx, NULL if it is not kept
+unsigned char *render_tile_find(int idx)
+{
+	int i = render_tile_slot(idx);
+
+	if (i < 0)
+		return NULL;
+	render_tiles[i].last_used = ++nRenderTileClock;
+	return render_tile_buf + i * RENDER_TILE_BYTES;
+}
+
+// a blank tile idx in a free slot or the one of the least recently used tile, unpinned if there is one
+unsigned char *render_tile_new(int idx)
+{
+	PRENDER_TILE pTile = NULL;
+	int i;
+
+	for (i = 0; i < RENDER_TILE_COUNT; i++)
+	{
+		if (render_tiles[i].idx < 0)
+		{
+			pTile = &render_tiles[i];
+			break;
+		}
+		if (!pTile || (pTile->bPinned && !render_tiles[i].bPinned) ||
+		    (pTile->bPinned == render_tiles[i].bPinned && render_tiles[i].last_used < pTile->last_used))
+			pTile = &render_tiles[i];
+	}
+	i = pTile - render_tiles;
+	pTile->idx = idx;
+	pTile->bPinned = false;
+	pTile->last_used = ++nRenderTileClock;
+	nRenderTileLast = i;
+	memset(render_tile_buf + i * RENDER_TILE_BYTES, 0, RENDER_TILE_BYTES);
+	return render_tile_buf + i * RENDER_TILE_BYTES;
+}
+
+// keep tile idx until the surface is cleared
+void render_tile_pin(int idx)
+{
+	int i = render_tile_slot(idx);
+
+	if (i >= 0)
+		render_tiles[i].bPinned = true;
+}
+
+// drop tile idx, e.g. one drawn only for a moment
+void render_tile_drop(int idx)
+{
+	int i = render_tile_slot(idx);
+
+	if (i >= 0)
+	{
+		render_tiles[i].idx = -1;
+		render_tiles[i].bPinned = false;
+	}
+}
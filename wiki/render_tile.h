@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDER_TILE_H
+#define RENDER_TILE_H
+
+#include <stdbool.h>
+
+// The surface articles and lists are drawn on (LCD_BUF_HEIGHT_PIXELS rows) is cut into tiles
+// of RENDER_TILE_HEIGHT rows and only RENDER_TILE_COUNT of them are kept, least recently
+// used dropped first. A tile has RENDER_TILE_GUARD spare rows above and below its own so a
+// glyph crossing its edge can be drawn into it whole; only a tile's own rows are read back.
+// A pinned tile holds something that cannot be drawn again from the article text (a list,
+// the language links, the license, a highlight) and is only dropped when all tiles are pinned.
+#define RENDER_TILE_HEIGHT 512	// at least LCD_HEIGHT, so a screen spans two tiles at most
+#define RENDER_TILE_GUARD 64	// more than the tallest glyph
+#define RENDER_TILE_COUNT 20	// the longest search result list (MAX_RESULT_LIST) fits
+#define RENDER_TILE_ROWS (RENDER_TILE_GUARD + RENDER_TILE_HEIGHT + RENDER_TILE_GUARD)
+#define RENDER_TILE_MAX ((LCD_BUF_HEIGHT_PIXELS) / RENDER_TILE_HEIGHT)
+
+// the tile holding row y of the surface and the surface row at the start of a tile's memory
+#define RENDER_TILE_IDX(y) ((int)((y) / RENDER_TILE_HEIGHT))
+#define RENDER_TILE_ORIGIN(idx) ((long)(idx) * RENDER_TILE_HEIGHT - RENDER_TILE_GUARD)
+
+void render_tile_init(void);
+void render_tile_clear(void);
+unsigned char *render_tile_find(int idx);
+unsigned char *render_tile_new(int idx);
+void render_tile_pin(int idx);
+void render_tile_drop(int idx);
+
+#endif
@@ -39,6 +39,15 @@
 #include "history.h"
 #include "wikilib.h"
 #include "search_fnd.h"
+#include "search_wrd.h"
+#include "search_fuzzy.h"
+#include "search_pfx.h"
+#include "search_ttl.h"
+#include "search_idx.h"
+#include "search_rnd.h"
+#include "article_cache.h"
+#include "file_pool.h"
+#include "lz4_dec.h"
 #include "wiki_info.h"
 #include "utf8.h"
 #include "languages.h"
@@ -70,20 +79,57 @@ static SEARCH_RESULTS *result_list = NULL;
 
 typedef struct _search_info {
 	int32_t inited;
-	int32_t fd_pfx;
 	int32_t fd_idx;
 	uint32_t max_article_idx;
-	uint32_t *prefix_index_table; 	// each SEARCH_INFO used to have private prefix_index_table.
-	//now it points to the common g_prefix_index_table for all SEARCH_INFO
-	uint32_t b_prefix_index_block_loaded[SEARCH_CHR_COUNT];
 	unsigned char *buf;	// buf correspond to result_list
 	uint32_t buf_len;
 	uint32_t offset_current;	// offset (wiki.fnd) of the content of buffer
 } SEARCH_INFO;
 static SEARCH_INFO *search_info = NULL;
-uint32_t *g_prefix_index_table = NULL; // common prefix_index_table
 unsigned char *g_search_info_buf = NULL; // common SEARCH_INFO buf
 
+// The titles matching a prefix are always a subrange of the titles matching any shorter prefix,
+// so the search session keeps the known range of every prefix length typed so far.
+// Adding a char only searches inside the range of the longest cached prefix and removing a char
+// goes straight back to the cached range without going through the prefix table again.
+enum {
+	SEARCH_RANGE_BOUNDED,	// offset_start is a lower bound, the first match is not known yet
+	SEARCH_RANGE_FOUND,	// offset_start is the first match
+	SEARCH_RANGE_EMPTY,	// no title matches the prefix
+};
+
+typedef struct _search_range {
+	unsigned char c;	// last char of the prefix of this range
+	uint8_t state;
+	int32_t offset_start;	// offset (wiki.fnd) of the first match or the lower bound
+	int32_t offset_end;	// offset (wiki.fnd) of a title after the last match, -1 if unknown
+} SEARCH_RANGE;
+
+typedef struct _search_session {
+	int32_t wiki_idx;
+	int32_t len;		// number of valid ranges, range[i] is for search_string[0..i]
+	SEARCH_RANGE range[MAX_TITLE_SEARCH];
+} SEARCH_SESSION;
+static SEARCH_SESSION search_session;
+
+// FND blocks to be read ahead while waiting for the next keystroke
+#define SEARCH_PREFETCH_MAX_BLOCKS 64
+typedef struct _search_prefetch {
+	int32_t planned;	// the list below is for the current search string
+	int32_t count;
+	int32_t next;
+	uint32_t offset[SEARCH_PREFETCH_MAX_BLOCKS];
+} SEARCH_PREFETCH;
+static SEARCH_PREFETCH search_prefetch_list;
+
+// the search string is a word query (WRD_QUERY_PREFIX) answered from the word index
+static int search_words_mode = 0;
+// no title matches the search string, the result list has the titles within one typo of it
+static int search_fuzzy_mode = 0;
+// the matches of the search string decoded a block at a time, for the first page and the scrolled results
+static SEARCH_CURSOR search_cursor;
+static int32_t search_cursor_page_end = -1;	// cursor position after the first page, -1 if the cursor is not in use
+
 //#define SIZE_PREFIX_INDEX_TABLE SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * sizeof(long)
 //static struct search_state state;
 //static struct search_state last_first_hit;
@@ -101,7 +147,9 @@ static int temp_search_str_per_language_len = 0;
 
 //static char s_find_first = 1;
 
-static void *SzAlloc(void *p, size_t size) { p = p; return memory_allocate(size, "search0"); }
+ARTICLE_DECODER_STATS article_decoder_stats;
+
+static void *SzAlloc(void *p, size_t size) { p = p; article_decoder_stats.allocations++; return memory_allocate(size, "search0"); }
 static void SzFree(void *p, void *address) { p = p; if (address) memory_free(address, "search0"); }
 static ISzAlloc g_Alloc = { SzAlloc, SzFree };
 
@@ -123,6 +171,68 @@ void restore_search_criteria()
 	search_str_per_language_len = temp_search_str_per_language_len;
 }
 
+static void search_session_reset(void)
+{
+	search_session.wiki_idx = nCurrentWiki;
+	search_session.len = 0;
+}
+
+// return the length of the longest cached prefix of search_string
+// the ranges of other prefixes are dropped
+static int search_session_match(void)
+{
+	int len = 0;
+
+	if (search_session.wiki_idx != nCurrentWiki)
+		search_session_reset();
+	while (len < search_session.len && len < search_str_len &&
+	       search_session.range[len].c == search_string[len])
+		len++;
+	search_session.len = len;
+	return len;
+}
+
+// return the range of the current search string if it is the one being populated
+static SEARCH_RANGE *search_session_current(int len)
+{
+	if (len > 0 && len == search_str_len && len == search_session.len &&
+	    search_session.wiki_idx == nCurrentWiki &&
+	    search_session.range[len - 1].c == search_string[len - 1])
+		return &search_session.range[len - 1];
+	return NULL;
+}
+
+// add the ranges from the longest cached prefix up to the current search string
+// bInherited: the range comes from a cached prefix so it bounds all the prefixes in between,
+// otherwise the ranges in between are left unknown (offset_start = -1)
+static void search_session_push(int state, long offset_start, long offset_end, bool bInherited)
+{
+	SEARCH_RANGE *pRange;
+
+	while (search_session.len < search_str_len)
+	{
+		pRange = &search_session.range[search_session.len];
+		pRange->c = search_string[search_session.len];
+		if (bInherited)
+		{
+			pRange->state = state == SEARCH_RANGE_EMPTY ? SEARCH_RANGE_EMPTY : SEARCH_RANGE_BOUNDED;
+			pRange->offset_start = offset_start;
+			pRange->offset_end = offset_end;
+		}
+		else
+		{
+			pRange->state = SEARCH_RANGE_BOUNDED;
+			pRange->offset_start = -1;
+			pRange->offset_end = -1;
+		}
+		search_session.len++;
+	}
+	pRange = &search_session.range[search_session.len - 1];
+	pRange->state = state;
+	pRange->offset_start = offset_start;
+	pRange->offset_end = offset_end;
+}
+
 long result_list_offset_next(void)
 {
 	return result_list->offset_next;
@@ -133,6 +243,39 @@ long result_list_next_result(long offset_next, long *idxArticle, unsigned char *
 	TITLE_SEARCH titleSearch;
 	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
 
+	if (search_words_mode)
+	{
+		// offset_next is only a token for the word query, the cursors keep the position
+		if (!(*idxArticle = search_wrd_next()))
+			return 0;
+		get_article_title_from_idx(*idxArticle, sTitleActual);
+		return offset_next + 1;
+	}
+	if (search_fuzzy_mode)
+	{
+		int rc;
+
+		while ((rc = search_fuzzy_next(idxArticle, sTitleActual)) < 0)
+			;
+		return rc ? offset_next + 1 : 0;
+	}
+	if (search_cursor_page_end >= 0)
+	{
+		PSEARCH_CURSOR_ENTRY pEntry;
+
+		// rendering again from the end of the first page
+		if (offset_next == (long)result_list->offset_next && search_cursor.nPos > search_cursor_page_end)
+			search_cursor_prev(&search_cursor, search_cursor.nPos - search_cursor_page_end);
+		if (offset_next == search_cursor_offset_next(&search_cursor))
+		{
+			if (!search_cursor_next(&search_cursor, 1) || !(pEntry = search_cursor_entry(&search_cursor)))
+				return 0;
+			*idxArticle = pEntry->idxArticle;
+			ustrcpy(sTitleActual, pEntry->sTitleActual);
+			return search_cursor_offset_next(&search_cursor);
+		}
+	}
+
 	copy_fnd_to_buf(offset_next, (void *)&titleSearch, sizeof(TITLE_SEARCH));
 	retrieve_titles_from_fnd(offset_next, sTitleSearch, sTitleActual);
 	if (!search_string_cmp(sTitleSearch, search_string, search_str_len)) // match!
@@ -166,8 +309,7 @@ void get_article_title_from_idx(long idx, unsigned char *title)
 		nCurrentWiki = wiki_idx;
 	}
 
-	file_lseek(search_info[nCurrentWiki].fd_idx, (idx - 1) * sizeof(ARTICLE_PTR) + 4);
-	file_read(search_info[nCurrentWiki].fd_idx, (void *)&article_ptr, sizeof(article_ptr));
+	get_article_ptr(nCurrentWiki, idx, &article_ptr);
 	if (article_ptr.offset_fnd)
 	{
 		copy_fnd_to_buf(article_ptr.offset_fnd, (unsigned char *)&title_search, sizeof(title_search));
@@ -181,13 +323,12 @@ void load_prefix_index(int nWikiIdx)
 {
 	if (!search_info[nWikiIdx].inited)
 	{
-		search_info[nWikiIdx].fd_pfx = file_open(get_wiki_file_path(nWikiIdx, "wiki.pfx"), FILE_OPEN_READ);
+		search_pfx_open(nWikiIdx);
 		search_info[nWikiIdx].fd_idx = file_open(get_wiki_file_path(nWikiIdx, "wiki.idx"), FILE_OPEN_READ);
 		search_info[nWikiIdx].offset_current = -1;
-		if (search_info[nWikiIdx].fd_pfx >= 0 && search_info[nWikiIdx].fd_idx >= 0)
+		if (search_info[nWikiIdx].fd_idx >= 0)
 		{
 			file_read(search_info[nWikiIdx].fd_idx, (void *)&search_info[nWikiIdx].max_article_idx, sizeof(search_info[nWikiIdx].max_article_idx));
-			memset(search_info[nWikiIdx].b_prefix_index_block_loaded, 0, sizeof(search_info[nWikiIdx].b_prefix_index_block_loaded));
 			search_info[nWikiIdx].inited = 1;
 		}
 		else
@@ -195,11 +336,27 @@ void load_prefix_index(int nWikiIdx)
 	}
 }
 
+// the ARTICLE_PTRs of articles of a wiki (zeroed if not found), return the number not found
+int get_article_ptrs(int nWikiIdx, const uint32_t *idx_articles, ARTICLE_PTR *article_ptrs, int n)
+{
+	load_prefix_index(nWikiIdx);
+	return search_idx_read(search_info[nWikiIdx].fd_idx, nWikiIdx, idx_articles, article_ptrs, n);
+}
+
+int get_article_ptr(int nWikiIdx, uint32_t idx_article, ARTICLE_PTR *pArticlePtr)
+{
+	return get_article_ptrs(nWikiIdx, &idx_article, pArticlePtr, 1) ? -1 : 0;
+}
+
 void reset_search_info(int nWikiIdx)
 {
 	load_prefix_index(nWikiIdx);
 	search_info[nWikiIdx].offset_current = -1;
-	memset(search_info[nWikiIdx].b_prefix_index_block_loaded, 0, sizeof(search_info[nWikiIdx].b_prefix_index_block_loaded));
+	search_session_reset();
+	search_prefetch_list.planned = 0;
+	search_words_mode = 0;
+	search_fuzzy_mode = 0;
+	search_cursor_page_end = -1;
 }
 
 void search_init()
@@ -220,15 +377,13 @@ void search_init()
 			fatal_error("search_init malloc error");
 		else
 		{
-			g_prefix_index_table = (uint32_t *)memory_allocate(sizeof(uint32_t) * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT, "search3");
 			g_search_info_buf = (unsigned char *)memory_allocate(NUMBER_OF_FIRST_PAGE_RESULTS * sizeof(TITLE_SEARCH), "search4");
-			if (!g_prefix_index_table || !g_search_info_buf)
+			if (!g_search_info_buf)
 				fatal_error("search_init malloc error");
 
 			for (i = 0; i < nWikiCount; i++)
 			{
 				search_info[i].inited = 0;
-				search_info[i].prefix_index_table = g_prefix_index_table;
 				search_info[i].buf = g_search_info_buf;
 			}
 		}
@@ -352,6 +507,12 @@ uint32_t get_article_idx_from_offset_range(const unsigned char *sInputTitleActua
 	unsigned int offsetNextTitleSearch = 0;
 	bool bFound = false;
 
+	if (fnd_has_directory())
+	{
+		offset_fnd_start = locate_fnd_restart_point(search_string, search_str_len, offset_fnd_start, offset_fnd_end);
+		offset_fnd_end = -1;
+	}
+
 	while (!bFound && offset_fnd_start >= 0)
 	{
 		if (search_info[nCurrentWiki].offset_current != (uint32_t)offset_fnd_start)
@@ -480,6 +641,110 @@ out:
 	return article_idx;
 }
 
+// fill the result list from the word index, one article each call as the title search does
+static int fetch_search_words(int bInit)
+{
+	uint32_t idxArticle;
+
+	if (bInit)
+	{
+		result_list->result_populated = 0;
+		result_list->count = 0;
+		result_list->offset_next = 0;
+		is_title_in_result_list(0, NULL);
+	}
+	if (result_list->result_populated)
+		return 0;
+
+	if ((idxArticle = search_wrd_next()))
+	{
+		result_list->idx_article[result_list->count] = idxArticle;
+		result_list->title_search[result_list->count][0] = '\0';
+		result_list->offset_list[result_list->count] = 0;
+		get_article_title_from_idx(idxArticle, result_list->title[result_list->count]);
+		result_list->offset_next++;
+		if (!is_title_in_result_list(idxArticle, result_list->title[result_list->count]))
+			result_list->count++;
+		if (result_list->count < NUMBER_OF_FIRST_PAGE_RESULTS)
+			return 1;
+	}
+	result_list->result_populated = 1;
+	if (!bInit) // just completed search result
+		search_to_be_reloaded(SEARCH_TO_BE_RELOADED_SET, SEARCH_RELOAD_NORMAL);
+	return 0;
+}
+
+// switch to the titles within one typo when the search string has no match
+static int search_fuzzy_begin(void)
+{
+	if (search_words_mode || !search_fuzzy_start(search_string, search_str_len))
+		return 0;
+	search_fuzzy_mode = 1;
+	result_list->result_populated = 0;
+	result_list->count = 0;
+	result_list->offset_next = 0;
+	is_title_in_result_list(0, NULL);
+	return 1;
+}
+
+// fill the result list with the titles within one typo, one corrected string or title each call
+static int fetch_search_fuzzy(int bInit)
+{
+	long idxArticle;
+	int rc;
+
+	if (result_list->result_populated)
+		return 0;
+
+	rc = search_fuzzy_next(&idxArticle, result_list->title[result_list->count]);
+	if (rc < 0)
+		return 1;
+	if (rc > 0)
+	{
+		result_list->idx_article[result_list->count] = idxArticle;
+		result_list->title_search[result_list->count][0] = '\0';
+		result_list->offset_list[result_list->count] = 0;
+		result_list->offset_next++;
+		if (!is_title_in_result_list(idxArticle, result_list->title[result_list->count]))
+			result_list->count++;
+		if (result_list->count < NUMBER_OF_FIRST_PAGE_RESULTS)
+			return 1;
+	}
+	result_list->result_populated = 1;
+	if (!bInit) // just completed search result
+		search_to_be_reloaded(SEARCH_TO_BE_RELOADED_SET, SEARCH_RELOAD_NORMAL);
+	return 0;
+}
+
+// add the next match of the search cursor to the first page, one each call as the titles read from the fnd file
+// return 1 when the first page is complete
+static int fill_result_list_from_cursor(SEARCH_RANGE *pRange)
+{
+	PSEARCH_CURSOR_ENTRY pEntry;
+
+	if (result_list->count < NUMBER_OF_FIRST_PAGE_RESULTS && search_cursor_next(&search_cursor, 1))
+	{
+		pEntry = search_cursor_entry(&search_cursor);
+		result_list->idx_article[result_list->count] = pEntry->idxArticle;
+		result_list->offset_list[result_list->count] = pEntry->offset_fnd;
+		ustrcpy(result_list->title[result_list->count], pEntry->sTitleActual);
+		if (!is_title_in_result_list(result_list->idx_article[result_list->count],
+					     result_list->title[result_list->count]))
+		{ // if the title is not in the list, add it
+			result_list->count++;
+		}
+		result_list->offset_next = search_cursor_offset_next(&search_cursor);
+		if (result_list->count < NUMBER_OF_FIRST_PAGE_RESULTS)
+			return 0;
+	}
+	result_list->offset_next = search_cursor_offset_next(&search_cursor);
+	search_cursor_page_end = search_cursor.nPos;
+	// the block decoded by the cursor may already have passed the last match
+	if (pRange && search_cursor.offset_end >= 0)
+		pRange->offset_end = search_cursor.offset_end;
+	return 1;
+}
+
 int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end, int bInit)
 {
 	unsigned int len;
@@ -490,19 +755,48 @@ int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end,
 	static unsigned int offsetNextTitleSearch = 0;
 	static long offset_fnd_start = -1;
 	static long offset_fnd_end = -1;
+	static int session_len = 0;
+	static int bCursorFilling = 0;	// the first page comes from search_cursor
+	SEARCH_RANGE *pRange;
+
+	if (search_words_mode)
+		return fetch_search_words(bInit);
+	if (search_fuzzy_mode)
+		return fetch_search_fuzzy(bInit);
 
 	if (bInit)
 	{
+		session_len = search_str_len;
 		result_list->result_populated = 0;
 		offset_fnd_start = input_offset_fnd_start;
 		offset_fnd_end = input_offset_fnd_end;
+		if (fnd_has_directory())
+		{
+			// binary search in the restart point directory, then only the block of the first match is scanned
+			offset_fnd_start = locate_fnd_restart_point(search_string, search_str_len, offset_fnd_start, offset_fnd_end);
+			offset_fnd_end = -1;
+		}
 		result_list->count = 0;
 		offsetNextTitleSearch = 0;
+		search_cursor_page_end = -1;
+		bCursorFilling = 0;
 		is_title_in_result_list(0, NULL);
 	}
 	if (result_list->result_populated || offset_fnd_start < 0)
 		return 0;
 
+	if (bCursorFilling)
+	{
+		if (search_interrupted)
+		{
+			search_interrupted = 12;
+			goto interrupted;
+		}
+		if (fill_result_list_from_cursor(search_session_current(session_len)))
+			result_list->result_populated = 1;
+		goto out;
+	}
+
 	if (search_info[nCurrentWiki].offset_current != (uint32_t)offset_fnd_start)
 	{
 		search_info[nCurrentWiki].buf_len = copy_fnd_to_buf(offset_fnd_start, search_info[nCurrentWiki].buf, NUMBER_OF_FIRST_PAGE_RESULTS * sizeof(TITLE_SEARCH));
@@ -534,6 +828,18 @@ int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end,
 				if (!result_list->count)
 				{
 					offset_fnd_start =  offset_fnd_start + offsetNextTitleSearch;
+					if (search_cursor_init(&search_cursor, search_string, search_str_len, offset_fnd_start))
+					{
+						if ((pRange = search_session_current(session_len)))
+						{
+							pRange->state = SEARCH_RANGE_FOUND;
+							pRange->offset_start = offset_fnd_start;
+						}
+						bCursorFilling = 1;
+						if (fill_result_list_from_cursor(pRange))
+							result_list->result_populated = 1;
+						goto out;
+					}
 					search_info[nCurrentWiki].buf_len = copy_fnd_to_buf(offset_fnd_start, search_info[nCurrentWiki].buf, NUMBER_OF_FIRST_PAGE_RESULTS * sizeof(TITLE_SEARCH));
 					search_info[nCurrentWiki].offset_current = offset_fnd_start;
 					if (search_interrupted)
@@ -548,6 +854,11 @@ int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end,
 					}
 					offsetNextTitleSearch = 0;
 					pTitleSearch = (TITLE_SEARCH *)&search_info[nCurrentWiki].buf[offsetNextTitleSearch];
+					if ((pRange = search_session_current(session_len)))
+					{
+						pRange->state = SEARCH_RANGE_FOUND;
+						pRange->offset_start = offset_fnd_start;
+					}
 				}
 				// use memcpy to avoid "Unaligned data access"
 				memcpy((void *)&result_list->idx_article[result_list->count],
@@ -634,6 +945,9 @@ int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end,
 			}
 			else
 			{
+				// passed the last match, the title here bounds the range of the search string
+				if ((pRange = search_session_current(session_len)) && pRange->state == SEARCH_RANGE_FOUND)
+					pRange->offset_end = offset_fnd_start + offsetNextTitleSearch;
 				result_list->result_populated = 1;
 				goto out;
 			}
@@ -659,6 +973,10 @@ int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end,
 out:
 	if (result_list->result_populated)
 	{
+		if (!result_list->count && (pRange = search_session_current(session_len)))
+			pRange->state = SEARCH_RANGE_EMPTY;
+		if (!result_list->count && search_fuzzy_begin())
+			return 1;
 		if (!bInit) // just completed search result
 			search_to_be_reloaded(SEARCH_TO_BE_RELOADED_SET, SEARCH_RELOAD_NORMAL);
 		return 0;
@@ -674,22 +992,8 @@ interrupted:
 
 long get_prefix_index_table(int idx_prefix_index_table)
 {
-	int idxBlock = idx_prefix_index_table / (SEARCH_CHR_COUNT * SEARCH_CHR_COUNT);
-	event_t ev;
-
 	load_prefix_index(nCurrentWiki);
-	if (!search_info[nCurrentWiki].b_prefix_index_block_loaded[idxBlock])
-	{
-		if (event_peek(&ev) != EVENT_NONE)
-			search_interrupted = 1;
-		file_lseek(search_info[nCurrentWiki].fd_pfx,
-			   idxBlock * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * sizeof(uint32_t));
-		file_read(search_info[nCurrentWiki].fd_pfx,
-			  &(search_info[nCurrentWiki].prefix_index_table[idxBlock * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT]),
-			  SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * sizeof(uint32_t));
-		search_info[nCurrentWiki].b_prefix_index_block_loaded[idxBlock]++;
-	}
-	return search_info[nCurrentWiki].prefix_index_table[idx_prefix_index_table];
+	return search_pfx_offset(nCurrentWiki, idx_prefix_index_table);
 }
 
 long get_search_result_start()
@@ -864,6 +1168,10 @@ uint32_t get_article_idx_by_title(unsigned char *titleSearch, unsigned char *tit
 	long offset_search_result_end = -1;
 	int i = 0;
 
+	// constant time for the wikis built with a title hash
+	if (search_ttl_lookup(nCurrentWiki, titleActual, &article_idx) >= 0)
+		return article_idx;
+
 	backup_search_criteria();
 	search_str_len = 0;
 	search_str_per_language_len = 0;
@@ -895,33 +1203,164 @@ uint32_t get_article_idx_by_title(unsigned char *titleSearch, unsigned char *tit
 	return article_idx;
 }
 
+static void search_prefetch_add(long offset)
+{
+	if (offset >= SIZE_BIGRAM_BUF && search_prefetch_list.count < SEARCH_PREFETCH_MAX_BLOCKS)
+		search_prefetch_list.offset[search_prefetch_list.count++] = offset;
+}
+
+// list the FND blocks most likely needed by the next keystroke
+static void search_prefetch_plan(void)
+{
+	char *pSupportedChars = SUPPORTED_SEARCH_CHARS;
+	SEARCH_RANGE *pRange;
+	int idx_prefix_index_table;
+	long offset;
+	int i;
+
+	search_prefetch_list.count = 0;
+	search_prefetch_list.next = 0;
+	search_prefetch_list.planned = 1;
+	pRange = search_session_current(search_str_len);
+	if (!pRange || pRange->state != SEARCH_RANGE_FOUND)
+		return;
+
+	// the titles after the first page for scrolling down the result list
+	if (result_list->count >= NUMBER_OF_FIRST_PAGE_RESULTS)
+	{
+		search_prefetch_add(result_list->offset_next);
+		search_prefetch_add(result_list->offset_next + FND_BUF_BLOCK_SIZE);
+	}
+
+	if (search_str_len < 3)
+	{
+		// the start of each possible next char from the prefix table
+		idx_prefix_index_table = bigram_char_idx(search_string[0]) * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT;
+		if (search_str_len == 2)
+			idx_prefix_index_table += bigram_char_idx(search_string[1]) * SEARCH_CHR_COUNT;
+		for (i = 0; pSupportedChars[i]; i++)
+		{
+			if (search_str_len == 2)
+				offset = search_pfx_offset(nCurrentWiki, idx_prefix_index_table + bigram_char_idx(pSupportedChars[i]));
+			else
+				offset = search_pfx_offset(nCurrentWiki, idx_prefix_index_table + bigram_char_idx(pSupportedChars[i]) * SEARCH_CHR_COUNT);
+			search_prefetch_add(offset);
+		}
+	}
+	else
+	{
+		// the next keystroke only searches inside the range of the current search string
+		offset = pRange->offset_start;
+		while (search_prefetch_list.count < SEARCH_PREFETCH_MAX_BLOCKS &&
+		       (pRange->offset_end < 0 || offset < pRange->offset_end))
+		{
+			search_prefetch_add(offset);
+			offset += FND_BUF_BLOCK_SIZE;
+		}
+	}
+}
+
+// read ahead one FND block in the idle time of the main loop
+// return 1 if there may be more to read
+int search_prefetch(void)
+{
+	event_t ev;
+
+	if (!result_list || !result_list->result_populated || search_string_changed || !search_str_len ||
+	    search_words_mode || search_fuzzy_mode)
+		return 0;
+	if (!search_prefetch_list.planned)
+	{
+		// the prefix table entries of the current first char are loaded by the search already
+		if (!search_pfx_resident(nCurrentWiki, bigram_char_idx(search_string[0])))
+			return 0;
+		search_prefetch_plan();
+	}
+	while (search_prefetch_list.next < search_prefetch_list.count)
+	{
+		if (event_peek(&ev) != EVENT_NONE)
+			return 0;
+		if (prefetch_fnd_block(search_prefetch_list.offset[search_prefetch_list.next++]))
+			return 1;
+	}
+	return 0;
+}
+
 int search_populate_result()
 {
 	int found = 0;
 	long offset_search_result_start = -1;
 	long offset_search_result_end = -1;
+	int len_cached;
+	SEARCH_RANGE *pRange = NULL;
 
 	search_string_changed = false;
+	search_prefetch_list.planned = 0;
 	result_list->count = 0;
 	result_list->result_populated = 0;
 	result_list->cur_selected = -1;
+	search_words_mode = 0;
+	search_fuzzy_mode = 0;
+	search_cursor_page_end = -1;
+	if (search_str_len > 1 && search_string[0] == WRD_QUERY_PREFIX &&
+	    search_wrd_start(&search_string[1], search_str_len - 1))
+	{
+		search_words_mode = 1;
+		fetch_search_result(0, 0, 1);
+		// the first article of the intersection is read by now, none if a word is in no article
+		return result_list->count > 0;
+	}
 	if (search_str_len > 0)
 	{
-		offset_search_result_start = get_search_result_start();
-		if (search_interrupted)
+		// find the longest cached prefix with a known range
+		len_cached = search_session_match();
+		while (len_cached > 0 && search_session.range[len_cached - 1].offset_start < 0 &&
+		       search_session.range[len_cached - 1].state != SEARCH_RANGE_EMPTY)
+			len_cached--;
+		if (len_cached > 0)
+			pRange = &search_session.range[len_cached - 1];
+
+		if (pRange && pRange->state == SEARCH_RANGE_EMPTY)
 		{
-			search_interrupted = 16;
-			goto interrupted;
+			search_session_push(SEARCH_RANGE_EMPTY, -1, -1, true);
+			result_list->result_populated = 1;
+			search_fuzzy_begin();
+			return found;
 		}
-		if (offset_search_result_start > 0)
+		else if (pRange && (len_cached == search_str_len || search_str_len > 3))
 		{
-			found = 1;
-			offset_search_result_end = get_search_result_end();
+			// search inside the range of the cached prefix only
+			offset_search_result_start = pRange->offset_start;
+			offset_search_result_end = pRange->offset_end;
+			if (len_cached < search_str_len)
+				search_session_push(SEARCH_RANGE_BOUNDED, offset_search_result_start, offset_search_result_end, true);
+		}
+		else
+		{
+			// the prefix table gives the exact range for up to three chars
+			offset_search_result_start = get_search_result_start();
 			if (search_interrupted)
 			{
-				search_interrupted = 17;
+				search_interrupted = 16;
 				goto interrupted;
 			}
+			if (offset_search_result_start > 0)
+			{
+				offset_search_result_end = get_search_result_end();
+				if (search_interrupted)
+				{
+					search_interrupted = 17;
+					goto interrupted;
+				}
+				search_session_push(SEARCH_RANGE_BOUNDED, offset_search_result_start, offset_search_result_end, false);
+			}
+			else
+				search_session_push(SEARCH_RANGE_EMPTY, -1, -1, false);
+		}
+
+		if (offset_search_result_start > 0)
+		{
+			found = 1;
 			fetch_search_result(offset_search_result_start, offset_search_result_end, 1);
 			if (search_interrupted)
 			{
@@ -932,6 +1371,7 @@ int search_populate_result()
 		else
 		{
 			result_list->result_populated = 1;
+			search_fuzzy_begin();
 		}
 	}
 	return found;
@@ -1450,6 +1890,9 @@ int clear_search_string()
 	search_string[0] = '\0';
 	search_str_len = 0;
 	search_str_per_language_len = 0;
+	search_words_mode = 0;
+	search_fuzzy_mode = 0;
+	search_cursor_page_end = -1;
 	return 0;
 }
 
@@ -1468,6 +1911,338 @@ extern int restricted_article;
 extern int current_article_wiki_id;
 
 char *compressed_buf = NULL;
+unsigned char *article_buffer = NULL;
+uint32_t article_buffer_len = 0;
+
+// The LZMA decoder of all the articles: its probabilities are allocated for the first article
+// and only again for a block with other lc + lp, LzmaDec_Init() resets it for each article.
+static CLzmaDec article_decoder;
+
+// The LZMA stream of the article being drawn. file_buffer is the dictionary of the decoder,
+// so the articles before it in the block are decoded in place and the article is drawn where
+// it is decoded. A '\0' is kept after the last byte decoded to stop the drawing there.
+typedef struct _ARTICLE_STREAM {
+	int bActive;
+	const Byte *pSrc;
+	SizeT nSrcLeft;
+	SizeT required_len;	// end of the article in the block
+	uint32_t wiki_id;
+	int dat_file_id;
+	uint32_t offset_dat;
+	uint32_t segment;
+	uint8_t nArticles;
+	CONCAT_ARTICLE_INFO concat_article_infos[MAX_ARTICLES_PER_COMPRESSION];
+} ARTICLE_STREAM;
+static ARTICLE_STREAM article_stream;
+
+// the header of a wiki?.dat block as read by read_dat_block()
+typedef struct _DAT_BLOCK {
+	uint8_t nArticles;
+	CONCAT_ARTICLE_INFO concat_article_infos[MAX_ARTICLES_PER_COMPRESSION];
+	uint32_t compressed_len;
+	int codec;
+	int segment;
+	SizeT required_len;	// end of the article in the block
+	SizeT block_len;	// end of the last article in the block
+} DAT_BLOCK;
+
+// The article read ahead in the idle time of the main loop (see article_prefetch() in lcd_buf_draw.c).
+// It is read to compressed_buf and decoded to prefetch_buffer a few KB at a time, then it goes to
+// the article cache. The article drawn and retrieve_article() take compressed_buf and the decoder
+// back, the read ahead waits for the first and is dropped by the second.
+#define ARTICLE_PREFETCH_READ_SIZE (16 * 1024)	// bytes read in one step
+#define ARTICLE_PREFETCH_DECODE_SIZE (16 * 1024)	// bytes decoded in one step
+
+enum {
+	ARTICLE_PREFETCH_NEXT,		// take the next candidate
+	ARTICLE_PREFETCH_READ,
+	ARTICLE_PREFETCH_DECODE,
+};
+
+typedef struct _ARTICLE_PREFETCH {
+	int count;
+	int next;
+	long idx_article[ARTICLE_PREFETCH_MAX];	// candidates with the wiki id, the most likely first
+	ARTICLE_PTR article_ptrs[ARTICLE_PREFETCH_MAX];	// of the candidates, read with the first of them
+	long decoded[ARTICLE_PREFETCH_MAX];	// read ahead and not opened yet, 0 if unused
+	int next_decoded;
+	int state;
+	long idx_read;				// the candidate read now
+	int fd_dat;
+	uint32_t wiki_id;
+	int dat_file_id;
+	uint32_t offset_dat;
+	DAT_BLOCK block;
+	SizeT required_len;
+	uint32_t nRead;
+	const Byte *pSrc;
+	SizeT nSrcLeft;
+} ARTICLE_PREFETCH;
+static ARTICLE_PREFETCH article_prefetch_job;
+static unsigned char *prefetch_buffer = NULL;
+ARTICLE_PREFETCH_STATS article_prefetch_stats;
+
+static void article_stream_stop(void)
+{
+	article_stream.bActive = 0;
+}
+
+static void article_prefetch_drop(void)
+{
+	if (article_prefetch_job.state != ARTICLE_PREFETCH_NEXT)
+		article_prefetch_stats.dropped++;
+	article_prefetch_job.state = ARTICLE_PREFETCH_NEXT;
+}
+
+// the decoded data goes to dic, file_buffer but for the articles read ahead
+static int article_decoder_init(const Byte *props, Byte *dic, SizeT dicBufSize)
+{
+	if (LzmaDec_AllocateProbs(&article_decoder, props, LZMA_PROPS_SIZE, &g_Alloc) != SZ_OK)
+		return -1;
+	article_decoder.dic = dic;
+	article_decoder.dicBufSize = dicBufSize;
+	LzmaDec_Init(&article_decoder);
+	return 0;
+}
+
+// free the decoder, e.g. before the blocks of another wiki (with other properties) are read
+void retrieve_article_release(void)
+{
+	article_stream_stop();
+	article_prefetch_drop();
+	article_prefetch_clear();
+	LzmaDec_FreeProbs(&article_decoder, &g_Alloc);
+	// inform test program how often the decoder was allocated (once per wiki unless the properties change)
+	if (article_decoder_stats.opens)
+		debug_printf("LZMA decoder: %lu allocations in %lu article opens\n",
+			     (unsigned long)article_decoder_stats.allocations, (unsigned long)article_decoder_stats.opens);
+}
+
+// decode up to dicLimit bytes of the block, return 0 when the article is complete
+static int article_stream_decode(SizeT dicLimit)
+{
+	ARTICLE_STREAM *pStream = &article_stream;
+	ELzmaStatus status;
+	SizeT srcLen = pStream->nSrcLeft;
+	SRes res;
+
+	if (dicLimit > pStream->required_len)
+		dicLimit = pStream->required_len;
+	res = LzmaDec_DecodeToDic(&article_decoder, dicLimit, pStream->pSrc, &srcLen, LZMA_FINISH_ANY, &status);
+	pStream->pSrc += srcLen;
+	pStream->nSrcLeft -= srcLen;
+	file_buffer[article_decoder.dicPos] = '\0';
+
+	if (res == SZ_OK && status != LZMA_STATUS_NEEDS_MORE_INPUT && article_decoder.dicPos < pStream->required_len &&
+	    status != LZMA_STATUS_FINISHED_WITH_MARK && (srcLen || article_decoder.dicPos == dicLimit))
+		return 1;
+
+	if (article_decoder.dicPos == pStream->required_len)
+		article_cache_add(pStream->wiki_id, pStream->dat_file_id, pStream->offset_dat, pStream->segment,
+				  pStream->nArticles, pStream->concat_article_infos, file_buffer, pStream->required_len);
+	article_stream_stop();
+	return 0;
+}
+
+// make sure len bytes from p in article_buffer are decoded, return 0 if the article is complete
+int retrieve_article_fill(const unsigned char *p, long len)
+{
+	SizeT dicLimit;
+
+	if (!article_stream.bActive)
+		return 0;
+	dicLimit = (p - file_buffer) + len;
+	while (article_stream.bActive && article_decoder.dicPos < dicLimit)
+		article_stream_decode(dicLimit);
+	return article_stream.bActive;
+}
+
+// start decoding the block read into compressed_buf, up to the first lines of the article
+static int article_stream_start(uint32_t offset, uint32_t article_len, SizeT compressed_len)
+{
+	ARTICLE_STREAM *pStream = &article_stream;
+	ARTICLE_HEADER article_header;
+
+	if (compressed_len < LZMA_PROPS_SIZE || offset + article_len >= FILE_BUFFER_SIZE ||
+	    article_len < sizeof(ARTICLE_HEADER))
+		return -1;
+	if (article_decoder_init((const Byte *)compressed_buf, file_buffer, offset + article_len))
+		return -1;
+	pStream->pSrc = (const Byte *)compressed_buf + LZMA_PROPS_SIZE;
+	pStream->nSrcLeft = compressed_len - LZMA_PROPS_SIZE;
+	pStream->required_len = offset + article_len;
+	pStream->bActive = 1;
+	article_buffer = file_buffer + offset;
+	article_buffer_len = article_len;
+
+	retrieve_article_fill(article_buffer, sizeof(ARTICLE_HEADER));
+	if (article_decoder.dicPos < offset + sizeof(ARTICLE_HEADER))
+		return -1;
+	memcpy(&article_header, article_buffer, sizeof(ARTICLE_HEADER));
+	if (article_header.offset_article > article_len)
+	{
+		article_stream_stop();
+		return -1;
+	}
+	// the links before the text are used at once
+	retrieve_article_fill(article_buffer, article_header.offset_article + ARTICLE_STREAM_LOOKAHEAD);
+	return 0;
+}
+
+// decode the first *pLen bytes of the block in compressed_buf to file_buffer
+static int decode_block(int codec, SizeT *pLen, SizeT compressed_len)
+{
+	ELzmaStatus status;
+	uint32_t len = *pLen;
+	int rc;
+
+	switch (codec)
+	{
+	case DAT_CODEC_LZMA:
+		if (compressed_len < LZMA_PROPS_SIZE || article_decoder_init((const Byte *)compressed_buf, file_buffer, *pLen))
+			return -1;
+		compressed_len -= LZMA_PROPS_SIZE;
+		// the end of the input before *pLen bytes is not an error, as with LzmaDecode()
+		rc = (int)LzmaDec_DecodeToDic(&article_decoder, *pLen, (const Byte *)compressed_buf + LZMA_PROPS_SIZE,
+					      &compressed_len, LZMA_FINISH_ANY, &status);
+		*pLen = article_decoder.dicPos;
+		return rc == SZ_OK ? 0 : -1;
+	case DAT_CODEC_LZ4:
+		rc = lz4_decode(file_buffer, &len, (const unsigned char *)compressed_buf, compressed_len);
+		*pLen = len;
+		return rc;
+	default:
+		return -1;
+	}
+}
+
+// Read the segment table of a block with seek points, keep the articles of the segment holding
+// idx_article (their offsets from the start of the segment) and seek to the data of the segment.
+// Return the segment, or -1 if the table is corrupt.
+static int read_segment(int fd_dat, uint32_t offset_compressed, uint32_t *pLen,
+			CONCAT_ARTICLE_INFO *concat_article_infos, uint8_t *pnArticles, uint32_t idx_article)
+{
+	DAT_SEGMENT segments[MAX_ARTICLES_PER_COMPRESSION];
+	uint8_t nSegments;
+	uint32_t offset_article = 0xFFFFFFFF;
+	uint32_t start, end, len;
+	int segment = -1;
+	int i, n;
+
+	for (i = 0; i < *pnArticles; i++)
+	{
+		if (concat_article_infos[i].article_id == idx_article)
+			offset_article = concat_article_infos[i].offset_article & ~0x80000000;
+	}
+	if (file_read(fd_dat, &nSegments, sizeof(nSegments)) != sizeof(nSegments) || !nSegments ||
+	    file_read(fd_dat, segments, nSegments * sizeof(DAT_SEGMENT)) != nSegments * sizeof(DAT_SEGMENT))
+		return -1;
+	for (i = 0; i < nSegments && segments[i].offset_article <= offset_article; i++)
+		segment = i;
+	if (segment < 0 || offset_article == 0xFFFFFFFF)
+		return -1;
+
+	start = segments[segment].offset_article;
+	end = segment + 1 < nSegments ? segments[segment + 1].offset_article : 0xFFFFFFFF;
+	len = (segment + 1 < nSegments ? segments[segment + 1].offset_compressed : *pLen) - segments[segment].offset_compressed;
+	if (segments[segment].offset_compressed > *pLen || len > *pLen)
+		return -1;
+
+	for (i = n = 0; i < *pnArticles; i++)
+	{
+		uint32_t offset = concat_article_infos[i].offset_article & ~0x80000000;
+
+		if (start <= offset && offset < end)
+		{
+			concat_article_infos[n] = concat_article_infos[i];
+			concat_article_infos[n].offset_article -= start;
+			n++;
+		}
+	}
+	*pnArticles = n;
+	*pLen = len;
+	file_lseek(fd_dat, offset_compressed + segments[segment].offset_compressed);
+	return segment;
+}
+
+// Read the header of the block at offset_dat and, for a block with seek points, the segment holding
+// idx_article, then leave fd_dat at the compressed data of it.
+// Return the index of the article in the block (segment), or -1 if it cannot be read.
+static int read_dat_block(int fd_dat, uint32_t offset_dat, uint32_t idx_article, DAT_BLOCK *pBlock)
+{
+	uint32_t dat_article_len;
+	int idx_concat_article = -1;
+	int i;
+
+	file_lseek(fd_dat, offset_dat);
+
+	file_read(fd_dat, &pBlock->nArticles, sizeof(pBlock->nArticles));
+
+	file_read(fd_dat, pBlock->concat_article_infos, pBlock->nArticles * sizeof(CONCAT_ARTICLE_INFO));
+
+	file_read(fd_dat, &dat_article_len, sizeof(dat_article_len));
+	pBlock->codec = dat_article_len >> DAT_CODEC_SHIFT;
+	pBlock->compressed_len = dat_article_len & DAT_LENGTH_MASK;
+	pBlock->segment = 0;
+	// only the segment of the article is read and decoded
+	if (pBlock->codec & DAT_CODEC_SEGMENTED)
+	{
+		pBlock->segment = read_segment(fd_dat, offset_dat + sizeof(pBlock->nArticles) +
+					       pBlock->nArticles * sizeof(CONCAT_ARTICLE_INFO) + sizeof(dat_article_len),
+					       &pBlock->compressed_len, pBlock->concat_article_infos, &pBlock->nArticles, idx_article);
+		pBlock->codec &= DAT_CODEC_MASK;
+	}
+
+	pBlock->required_len = 0;
+	pBlock->block_len = 0;
+	for (i = 0; i < pBlock->nArticles; i++)
+	{
+		SizeT end = (pBlock->concat_article_infos[i].offset_article & ~0x80000000) + pBlock->concat_article_infos[i].article_len;
+
+		if (pBlock->concat_article_infos[i].article_id == idx_article)
+		{
+			idx_concat_article = i;
+			pBlock->required_len = end;
+		}
+		if (pBlock->block_len < end)
+			pBlock->block_len = end;
+	}
+
+	if (pBlock->compressed_len > MAX_COMPRESSED_ARTICLE || pBlock->segment < 0)
+		return -1;
+	return idx_concat_article;
+}
+
+// move one article of the decoded block to the start of file_buffer
+static int extract_concat_article(uint32_t idx_article, const CONCAT_ARTICLE_INFO *concat_article_infos, int nArticles,
+				  const unsigned char *pData, uint32_t len)
+{
+	uint32_t offset;
+	int i;
+
+	for (i = 0; i < nArticles; i++)
+	{
+		if (concat_article_infos[i].article_id == idx_article)
+		{
+			offset = concat_article_infos[i].offset_article & ~0x80000000;
+			if (offset + concat_article_infos[i].article_len > len)
+				return -1;
+			if (concat_article_infos[i].offset_article & 0x80000000) {
+				restricted_article = 1;
+			} else {
+				restricted_article = 0;
+			}
+			// memory overlaps so cannot use memcpy
+			memmove(file_buffer, &pData[offset], concat_article_infos[i].article_len);
+			file_buffer[concat_article_infos[i].article_len] = '\0';
+			article_buffer = file_buffer;
+			article_buffer_len = concat_article_infos[i].article_len;
+			return 0;
+		}
+	}
+	return -1;
+}
+
 int retrieve_article(long idx_article_with_wiki_id)
 {
 	ARTICLE_PTR article_ptr;
@@ -1476,6 +2251,10 @@ int retrieve_article(long idx_article_with_wiki_id)
 
 	if (!compressed_buf)
 		compressed_buf = (char *)memory_allocate(MAX_COMPRESSED_ARTICLE, "search5");
+	// file_buffer is about to be overwritten
+	article_stream_stop();
+	article_prefetch_drop();
+	article_decoder_stats.opens++;
 
 	current_article_wiki_id = (unsigned long)idx_article_with_wiki_id >> 24;
 	if (current_article_wiki_id == 0)
@@ -1495,76 +2274,86 @@ int retrieve_article(long idx_article_with_wiki_id)
 	idx_article = idx_article_with_wiki_id & 0x00FFFFFF;
 
 	if (nWikiIdx >= 0 && compressed_buf && 0 < idx_article && idx_article <= search_info[nWikiIdx].max_article_idx) {
-		file_lseek(search_info[nWikiIdx].fd_idx, sizeof(uint32_t) + (idx_article - 1) * sizeof(article_ptr));
-		file_read(search_info[nWikiIdx].fd_idx, &article_ptr, sizeof(article_ptr));
+		get_article_ptr(nWikiIdx, idx_article, &article_ptr);
 
 		int dat_file_id = article_ptr.file_id;
+		uint32_t wiki_id = get_wiki_id_from_idx(nWikiIdx);
+		uint32_t offset_dat = article_ptr.offset_dat & 0x7FFFFFFF;
+		PARTICLE_BLOCK pBlock;
+		int bHot;
 		int fd_dat;
-		char file_name[13];
-
-		sprintf(file_name, "wiki%d.dat", dat_file_id);
-		fd_dat = file_open(get_wiki_file_path(nWikiIdx, file_name), FILE_OPEN_READ);
+		int i;
 
-		if (fd_dat >= 0)
+		for (i = 0; i < ARTICLE_PREFETCH_MAX; i++)
 		{
-			CONCAT_ARTICLE_INFO concat_article_infos[MAX_ARTICLES_PER_COMPRESSION];
-			uint8_t nArticlesConcatnated;
-			uint32_t dat_article_len;
-			SizeT required_len = 0;
-			uint32_t offset = 0;
-			int i;
-			int idx_concat_article = -1;
-
-			file_lseek(fd_dat, article_ptr.offset_dat & 0x7FFFFFFF);
-
-			file_read(fd_dat, &nArticlesConcatnated,
-				  sizeof(nArticlesConcatnated));
-
-			file_read(fd_dat, &concat_article_infos,
-				  nArticlesConcatnated * sizeof(CONCAT_ARTICLE_INFO));
-			for (i = 0; i < nArticlesConcatnated; i++)
+			if (article_prefetch_job.decoded[i] == (long)(wiki_id << 24 | idx_article))
 			{
-				if (concat_article_infos[i].article_id == idx_article)
-				{
-					idx_concat_article = i;
-					offset = concat_article_infos[i].offset_article & ~0x80000000;
-					required_len = offset + concat_article_infos[i].article_len;
-					break;
-				}
+				article_prefetch_stats.hits++;
+				article_prefetch_job.decoded[i] = 0;
 			}
+		}
 
-			file_read(fd_dat, &dat_article_len, sizeof(dat_article_len));
+		// the articles sharing a block are often read one after the other
+		pBlock = article_cache_get(wiki_id, dat_file_id, offset_dat, idx_article, &bHot);
+		if (pBlock)
+		{
+			if (!extract_concat_article(idx_article, pBlock->pInfos, pBlock->nArticles, pBlock->pData, pBlock->len))
+				return 0;
+			print_article_error();
+			return -1;
+		}
+
+		fd_dat = file_pool_open(nWikiIdx, dat_file_id);
 
-			file_read(fd_dat, compressed_buf, dat_article_len);
-			file_close(fd_dat);
+		if (fd_dat >= 0)
+		{
+			DAT_BLOCK block;
+			CONCAT_ARTICLE_INFO *concat_article_infos = block.concat_article_infos;
+			int idx_concat_article;
+			SizeT required_len;
+			int bWholeBlock = 0;
+
+			idx_concat_article = read_dat_block(fd_dat, offset_dat, idx_article, &block);
+			if (idx_concat_article < 0)
+			{
+				print_article_error();
+				return -1;
+			}
+			required_len = block.required_len;
+			// decode the whole block (segment) if another of its articles was read before
+			if (bHot && block.block_len < FILE_BUFFER_SIZE && article_cache_fits(block.nArticles, block.block_len))
+			{
+				required_len = block.block_len;
+				bWholeBlock = 1;
+			}
 
-			dat_article_len -= LZMA_PROPS_SIZE;
+			file_read(fd_dat, compressed_buf, block.compressed_len);
 
-			ELzmaStatus status;
-			//SizeT file_buffer_len = FILE_BUFFER_SIZE;
-			SizeT compressed_buffer_len = dat_article_len;
-			int rc = (int)LzmaDecode(file_buffer,
-						 &required_len,
-						 (const Byte *)compressed_buf + LZMA_PROPS_SIZE,
-						 &compressed_buffer_len,
-						 (const Byte *)compressed_buf, LZMA_PROPS_SIZE,
-						 LZMA_FINISH_ANY,
-						 &status, &g_Alloc);
+			// otherwise draw the article while it is decoded, the other codecs are fast enough
+			if (!bWholeBlock && block.codec == DAT_CODEC_LZMA)
+			{
+				restricted_article = (concat_article_infos[idx_concat_article].offset_article & 0x80000000) != 0;
+				article_stream.wiki_id = wiki_id;
+				article_stream.dat_file_id = dat_file_id;
+				article_stream.offset_dat = offset_dat;
+				article_stream.segment = block.segment;
+				article_stream.nArticles = block.nArticles;
+				memcpy(article_stream.concat_article_infos, concat_article_infos,
+				       block.nArticles * sizeof(CONCAT_ARTICLE_INFO));
+				if (!article_stream_start(concat_article_infos[idx_concat_article].offset_article & ~0x80000000,
+							  concat_article_infos[idx_concat_article].article_len, block.compressed_len))
+					return 0;
+				print_article_error();
+				return -1;
+			}
 
-			if (rc == SZ_OK || rc == SZ_ERROR_INPUT_EOF) // can generate SZ_ERROR_INPUT_EOF but result is OK
+			if (required_len < FILE_BUFFER_SIZE && !decode_block(block.codec, &required_len, block.compressed_len))
 			{
-				if (idx_concat_article >= 0)
-				{
-					if (concat_article_infos[idx_concat_article].offset_article & 0x80000000) {
-						restricted_article = 1;
-					} else {
-						restricted_article = 0;
-					}
-					// memory overlaps so cannot use memcpy
-					memmove(file_buffer, &file_buffer[offset], concat_article_infos[idx_concat_article].article_len);
-					file_buffer[concat_article_infos[idx_concat_article].article_len] = '\0';
+				article_cache_add(wiki_id, dat_file_id, offset_dat, block.segment, block.nArticles,
+						  concat_article_infos, file_buffer, required_len);
+				if (!extract_concat_article(idx_article, &concat_article_infos[idx_concat_article], 1,
+							    file_buffer, required_len))
 					return 0;
-				}
 			}
 		}
 
@@ -1573,6 +2362,172 @@ int retrieve_article(long idx_article_with_wiki_id)
 	return -1;
 }
 
+// new list of the articles to read ahead, the one being read is finished
+void article_prefetch_clear(void)
+{
+	article_prefetch_job.count = 0;
+	article_prefetch_job.next = 0;
+}
+
+// only the articles of the current wiki are read ahead, another wiki would need its files opened
+void article_prefetch_add(long idx_article_with_wiki_id)
+{
+	ARTICLE_PREFETCH *pJob = &article_prefetch_job;
+	uint32_t wiki_id = get_wiki_id_from_idx(nCurrentWiki);
+	int i;
+
+	if (!((unsigned long)idx_article_with_wiki_id >> 24))
+		idx_article_with_wiki_id |= wiki_id << 24;
+	if ((unsigned long)idx_article_with_wiki_id >> 24 != wiki_id || pJob->count >= ARTICLE_PREFETCH_MAX)
+		return;
+	for (i = 0; i < pJob->count; i++)
+	{
+		if (pJob->idx_article[i] == idx_article_with_wiki_id)
+			return;
+	}
+	pJob->idx_article[pJob->count++] = idx_article_with_wiki_id;
+}
+
+// read the header of the block of the next candidate unless the article is cached already
+static void article_prefetch_begin(long idx_article_with_wiki_id, const ARTICLE_PTR *pArticlePtr)
+{
+	ARTICLE_PREFETCH *pJob = &article_prefetch_job;
+	uint32_t idx_article = idx_article_with_wiki_id & 0x00FFFFFF;
+	int bHot;
+
+	if (!idx_article || idx_article > search_info[nCurrentWiki].max_article_idx)
+		return;
+
+	pJob->wiki_id = get_wiki_id_from_idx(nCurrentWiki);
+	pJob->dat_file_id = pArticlePtr->file_id;
+	pJob->offset_dat = pArticlePtr->offset_dat & 0x7FFFFFFF;
+	if (article_cache_peek(pJob->wiki_id, pJob->dat_file_id, pJob->offset_dat, idx_article, &bHot))
+		return;
+	pJob->fd_dat = file_pool_open(nCurrentWiki, pJob->dat_file_id);
+	if (pJob->fd_dat < 0 || read_dat_block(pJob->fd_dat, pJob->offset_dat, idx_article, &pJob->block) < 0)
+		return;
+
+	pJob->required_len = pJob->block.required_len;
+	if (bHot)
+		pJob->required_len = pJob->block.block_len;
+	if (pJob->required_len >= FILE_BUFFER_SIZE || !article_cache_fits(pJob->block.nArticles, pJob->required_len))
+		return;
+	if (!prefetch_buffer)
+	{
+		prefetch_buffer = (unsigned char *)memory_allocate(FILE_BUFFER_SIZE, "search6");
+		if (!prefetch_buffer)
+			return;
+	}
+	pJob->idx_read = idx_article_with_wiki_id;
+	pJob->nRead = 0;
+	pJob->state = ARTICLE_PREFETCH_READ;
+}
+
+// decode the next bytes of the block read, return 0 when it is done
+static int article_prefetch_decode(void)
+{
+	ARTICLE_PREFETCH *pJob = &article_prefetch_job;
+	ELzmaStatus status;
+	SizeT srcLen = pJob->nSrcLeft;
+	SizeT dicLimit;
+	uint32_t len;
+	SRes res;
+
+	if (pJob->block.codec != DAT_CODEC_LZMA)
+	{
+		// LZ4 is fast enough to be decoded at once
+		len = pJob->required_len;
+		if (lz4_decode(prefetch_buffer, &len, (const unsigned char *)compressed_buf, pJob->block.compressed_len) ||
+		    len != pJob->required_len)
+			return 0;
+	}
+	else
+	{
+		dicLimit = article_decoder.dicPos + ARTICLE_PREFETCH_DECODE_SIZE;
+		if (dicLimit > pJob->required_len)
+			dicLimit = pJob->required_len;
+		res = LzmaDec_DecodeToDic(&article_decoder, dicLimit, pJob->pSrc, &srcLen, LZMA_FINISH_ANY, &status);
+		pJob->pSrc += srcLen;
+		pJob->nSrcLeft -= srcLen;
+		if (res != SZ_OK)
+			return 0;
+		if (article_decoder.dicPos < pJob->required_len)
+			return status != LZMA_STATUS_NEEDS_MORE_INPUT && status != LZMA_STATUS_FINISHED_WITH_MARK &&
+				(srcLen || article_decoder.dicPos == dicLimit);
+	}
+
+	article_cache_add(pJob->wiki_id, pJob->dat_file_id, pJob->offset_dat, pJob->block.segment, pJob->block.nArticles,
+			  pJob->block.concat_article_infos, prefetch_buffer, pJob->required_len);
+	pJob->decoded[pJob->next_decoded] = pJob->idx_read;
+	pJob->next_decoded = (pJob->next_decoded + 1) % ARTICLE_PREFETCH_MAX;
+	article_prefetch_stats.decoded++;
+	return 0;
+}
+
+// read ahead a step of the next candidate in the idle time of the main loop
+// return 1 if there may be more to do
+int article_prefetch_step(void)
+{
+	ARTICLE_PREFETCH *pJob = &article_prefetch_job;
+	uint32_t idx_articles[ARTICLE_PREFETCH_MAX];
+	uint32_t len;
+	int i;
+
+	// compressed_buf and the decoder are taken by the article being drawn
+	if (article_stream.bActive)
+		return 0;
+	switch (pJob->state)
+	{
+	case ARTICLE_PREFETCH_NEXT:
+		if (pJob->next >= pJob->count || !compressed_buf)
+			return 0;
+		// the candidates are often close in wiki.idx, one look up sorts them by page
+		if (!pJob->next)
+		{
+			for (i = 0; i < pJob->count; i++)
+			{
+				idx_articles[i] = pJob->idx_article[i] & 0x00FFFFFF;
+				if (idx_articles[i] > search_info[nCurrentWiki].max_article_idx)
+					idx_articles[i] = 0;
+			}
+			get_article_ptrs(nCurrentWiki, idx_articles, pJob->article_ptrs, pJob->count);
+		}
+		article_prefetch_begin(pJob->idx_article[pJob->next], &pJob->article_ptrs[pJob->next]);
+		pJob->next++;
+		break;
+	case ARTICLE_PREFETCH_READ:
+		len = pJob->block.compressed_len - pJob->nRead;
+		if (len > ARTICLE_PREFETCH_READ_SIZE)
+			len = ARTICLE_PREFETCH_READ_SIZE;
+		if (file_read(pJob->fd_dat, compressed_buf + pJob->nRead, len) != (int)len)
+		{
+			article_prefetch_drop();
+			break;
+		}
+		pJob->nRead += len;
+		if (pJob->nRead < pJob->block.compressed_len)
+			break;
+		pJob->state = ARTICLE_PREFETCH_DECODE;
+		if (pJob->block.codec == DAT_CODEC_LZMA)
+		{
+			if (pJob->block.compressed_len < LZMA_PROPS_SIZE ||
+			    article_decoder_init((const Byte *)compressed_buf, prefetch_buffer, pJob->required_len))
+			{
+				article_prefetch_drop();
+				break;
+			}
+			pJob->pSrc = (const Byte *)compressed_buf + LZMA_PROPS_SIZE;
+			pJob->nSrcLeft = pJob->block.compressed_len - LZMA_PROPS_SIZE;
+		}
+		break;
+	case ARTICLE_PREFETCH_DECODE:
+		if (!article_prefetch_decode())
+			pJob->state = ARTICLE_PREFETCH_NEXT;
+		break;
+	}
+	return 1;
+}
+
 void search_set_selection(int new_selection)
 {
 	result_list->cur_selected = new_selection;
@@ -1599,8 +2554,7 @@ long find_closest_idx(long idx, unsigned char *title)
 
 	if ((uint32_t)idx > search_info[nCurrentWiki].max_article_idx)
 		idx -= search_info[nCurrentWiki].max_article_idx;
-	file_lseek(search_info[nCurrentWiki].fd_idx, (idx - 1) * sizeof(ARTICLE_PTR) + sizeof(uint32_t));
-	file_read(search_info[nCurrentWiki].fd_idx, &article_ptr, sizeof(article_ptr));
+	get_article_ptr(nCurrentWiki, idx, &article_ptr);
 
 	if (!article_ptr.offset_fnd)
 	{
@@ -1641,12 +2595,19 @@ extern int last_display_mode;
 void random_article(void)
 {
 	long idx_article;
+	uint32_t idx_random;
 	unsigned char title[MAX_TITLE_ACTUAL];
 	unsigned long clock_ticks;
 
 	clock_ticks = timer_get();
-	idx_article = clock_ticks % search_info[nCurrentWiki].max_article_idx + 1;
-	idx_article = find_closest_idx(idx_article, title);
+	// pick among the articles with a title, older wikis have to probe wiki.idx
+	if (search_rnd_select(nCurrentWiki, clock_ticks, &idx_random) >= 0)
+		idx_article = idx_random;
+	else
+	{
+		idx_article = clock_ticks % search_info[nCurrentWiki].max_article_idx + 1;
+		idx_article = find_closest_idx(idx_article, title);
+	}
 
 	if (idx_article)
 	{
@@ -38,6 +38,22 @@
 // Presently set the same. Is it possible to assume 2:1 compression ratio?
 #define MAX_COMPRESSED_ARTICLE (512 * 1024)
 
+// the length of the compressed data of a wiki?.dat block has the codec in the top byte,
+// 0 (LZMA: 5 bytes of properties then the stream) for the files built before the codec was added
+#define DAT_CODEC_SHIFT 24
+#define DAT_LENGTH_MASK 0x00FFFFFF
+#define DAT_CODEC_LZMA 0
+#define DAT_CODEC_LZ4 1	// LZ4 block, see lz4_dec.h
+// with seek points the articles are compressed in runs (segments) that decode on their own:
+//   uint8_t nSegments, nSegments * [DAT_SEGMENT], then the data of each segment as for the codec
+#define DAT_CODEC_SEGMENTED 0x80
+#define DAT_CODEC_MASK 0x7F
+
+typedef struct __attribute__((packed)) _DAT_SEGMENT {
+	uint32_t offset_article;	// decoded offset of the first article in the segment
+	uint32_t offset_compressed;	// of its data, from the start of the compressed data (nSegments)
+} DAT_SEGMENT;
+
 enum {
 	SEARCH_RELOAD_NORMAL,
 	SEARCH_RELOAD_KEEP_RESULT,
@@ -70,6 +86,28 @@ typedef struct __attribute__((packed)) _TITLE_SEARCH {
 	unsigned char sTitleActual[MAX_TITLE_ACTUAL]; // null terminated utf-8 encoded actual title
 } TITLE_SEARCH;
 
+// FND version 1 appends the following after the last record (all segments are one stream):
+//   nEntries * [FND_DIRECTORY_ENTRY] - one entry for every nRestartInterval records
+//   FND_TRAILER                      - the last bytes of the last segment
+// The record at each restart point is stored uncompressed, so a title can be rebuilt by reading
+// forward from the restart point before it. Files without the trailer are the original layout.
+#define FND_MAGIC 0x31444e46	// "FND1"
+#define FND_VERSION 1
+#define FND_DIRECTORY_KEY_LEN 12
+
+typedef struct __attribute__((packed)) _FND_DIRECTORY_ENTRY {
+	uint32_t offset;	// offset (wiki.fnd) of the restart record
+	unsigned char key[FND_DIRECTORY_KEY_LEN]; // bigram encoded search title, no null terminator if truncated
+} FND_DIRECTORY_ENTRY;
+
+typedef struct __attribute__((packed)) _FND_TRAILER {
+	uint32_t offset_directory;	// offset (wiki.fnd) of the first FND_DIRECTORY_ENTRY, i.e. the end of the records
+	uint32_t nEntries;
+	uint32_t nRestartInterval;
+	uint32_t version;
+	uint32_t magic;
+} FND_TRAILER;
+
 /*
  * Highlevel search interface...
  */
@@ -77,9 +115,42 @@ void search_select_down(void);
 void search_select_up(void);
 // const char *search_fetch_result();
 int retrieve_article(long idx_article);
+// The article retrieved (ARTICLE_HEADER, links and text), in file_buffer. Unless it was cached
+// it is still being decoded: the first ARTICLE_STREAM_LOOKAHEAD bytes of the text are there
+// and retrieve_article_fill() decodes the rest as it is drawn.
+#define ARTICLE_STREAM_LOOKAHEAD 4096
+extern unsigned char *article_buffer;
+extern uint32_t article_buffer_len;	// bytes of the article from article_buffer, the text is followed by a '\0'
+int retrieve_article_fill(const unsigned char *p, long len);
+void retrieve_article_release(void);
+
+typedef struct _ARTICLE_DECODER_STATS {
+	uint32_t opens;		// retrieve_article() calls
+	uint32_t allocations;	// by the LZMA decoder
+} ARTICLE_DECODER_STATS;
+
+extern ARTICLE_DECODER_STATS article_decoder_stats;
+
+// The articles likely opened next are read ahead to the article cache in the idle time,
+// article_prefetch_step() does a few KB of it at a time.
+#define ARTICLE_PREFETCH_MAX 4	// candidates, at most half of the article cache
+
+void article_prefetch_clear(void);
+void article_prefetch_add(long idx_article_with_wiki_id);
+int article_prefetch_step(void);
+
+typedef struct _ARTICLE_PREFETCH_STATS {
+	uint32_t decoded;	// articles read ahead
+	uint32_t hits;		// of them opened afterwards
+	uint32_t dropped;	// given up for an article opened before they were done
+} ARTICLE_PREFETCH_STATS;
+
+extern ARTICLE_PREFETCH_STATS article_prefetch_stats;
 void memrcpy(char *dest, char *src, int len); // memory copy starting from the last byte
 void random_article(void);
 void get_article_title_from_idx(long idx, unsigned char *title);
+int get_article_ptr(int nWikiIdx, uint32_t idx_article, ARTICLE_PTR *pArticlePtr);
+int get_article_ptrs(int nWikiIdx, const uint32_t *idx_articles, ARTICLE_PTR *article_ptrs, int n);
 long result_list_offset_next(void);
 long result_list_next_result(long offset_next, long *idxArticle, unsigned char *sTitleSearch);
 
@@ -131,6 +202,7 @@ void search_open_article(int new_selection);
 int fetch_search_result(long input_offset_fnd_start, long input_offset_fnd_end, int bInit);
 
 void search_fetch();
+int search_prefetch(void);
 void search_result_display();
 int clear_search_string();
 int  get_search_string_len();
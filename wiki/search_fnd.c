@@ -19,34 +19,24 @@
 #include <ctype.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include <grifo.h>
 
 #include "ustring.h"
 #include "search.h"
+#include "wikilib.h"
 #include "wiki_info.h"
 #include "search_fnd.h"
 #include "lcd_buf_draw.h"
-#include "btree.h"
+#include "block_cache.h"
 
 extern int search_interrupted;
 #define FND_BUF_COUNT 1024
 #define MAX_FND_FILES 16
 
-// FND_BUF_BLOCK_SIZE needs to be larger than NUMBER_OF_FIRST_PAGE_RESULTS * sizeof(TITLE_SEARCH)
-#define FND_BUF_BLOCK_SIZE 4096
-typedef struct __attribute__ ((packed)) _fnd_buf {
-	uint32_t offset;
-	uint16_t len;
-	int16_t prev_used_seq; // entry idx with the used sequence before this
-	int16_t next_used_seq; // entry idx with the used sequence after this
-	uint8_t wiki_id;
-	char buf[FND_BUF_BLOCK_SIZE];
-} FND_BUF, *PFND_BUF;
-PFND_BUF pFndBuf;
-int nIdxFndBufFirstUsed;
-int nIdxFndBufLastUsed;
+BLOCK_CACHE fnd_cache;
 
 typedef struct __attribute__ ((packed)) _PER_WIKI_INFO {
 	int bSearchFndInited;
@@ -54,11 +44,22 @@ typedef struct __attribute__ ((packed)) _PER_WIKI_INFO {
 	int fdFnd[MAX_FND_FILES];
 	unsigned long offsetFndStart[MAX_FND_FILES];
 	unsigned long lenFnd[MAX_FND_FILES];
+	unsigned long offsetFndEnd;	// end of the records, the directory and trailer are not part of the search data
+	FND_DIRECTORY_ENTRY *pDirectory;	// NULL for the original layout
+	unsigned int nDirectoryEntries;
+	unsigned int nRestartInterval;
 } PER_WIKI_INFO, *PPER_WIKI_INFO;
 PPER_WIKI_INFO pPerWikiInfo;
 
-long nUsedSeq = 1;
-BTREE btree;
+// the last title rebuilt from a restart point, for reading the records of a block in sequence
+static struct {
+	int nWikiIdx;
+	long offset;		// offset (wiki.fnd) of the record after the one below
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
+	unsigned char sTitleActual[MAX_TITLE_ACTUAL];
+} last_fnd_title = {-1, -1, "", ""};
+
+static void init_fnd_directory(void);
 
 void init_search_fnd(void)
 {
@@ -67,19 +68,8 @@ void init_search_fnd(void)
 
 	if (bFirstCall)
 	{
-		btree_init(&btree, FND_BUF_COUNT, 0);
-		pFndBuf = (PFND_BUF)memory_allocate(sizeof(FND_BUF) * FND_BUF_COUNT, "searchfnd1");
-		nIdxFndBufFirstUsed = 0;
-		nIdxFndBufLastUsed = FND_BUF_COUNT - 1;
-		for (i = 0; i < FND_BUF_COUNT; i++)
-		{
-			pFndBuf[i].offset = 0;
-			pFndBuf[i].prev_used_seq = i - 1;
-			if (i == FND_BUF_COUNT - 1)
-				pFndBuf[i].next_used_seq = -1;
-			else
-				pFndBuf[i].next_used_seq = i + 1;
-		}
+		if (block_cache_init(&fnd_cache, FND_BUF_COUNT, FND_BUF_BLOCK_SIZE, "searchfnd1"))
+			fatal_error("init_search_fnd malloc error");
 		pPerWikiInfo = (PPER_WIKI_INFO)memory_allocate(sizeof(PER_WIKI_INFO) * get_wiki_count(), "searchfnd2");
 		for (i = 0; i < get_wiki_count(); i++)
 		{
@@ -107,115 +97,205 @@ void init_search_fnd(void)
 			file_size(get_wiki_file_path(nCurrentWiki, file_name), &pPerWikiInfo[nCurrentWiki].lenFnd[i]);
 		}
 		pPerWikiInfo[nCurrentWiki].nFndCount = i;
+		init_fnd_directory();
 	}
 }
 
-int copy_fnd_to_buf(long offset, unsigned char *buf, int len)
+// read from the FND segments directly, without the cache
+static int read_fnd(unsigned long offset, unsigned char *buf, int len)
 {
-	int idxFndBuf;
-	int nCopyLen;
-	unsigned long blocked_offset;
-	PBTREE_ELEMENT pElement;
-	long nKey;
+	unsigned int nFndIdx;
+	unsigned long offset_in_file;
+	int nRead;
+	int nTotal = 0;
 
-	blocked_offset = ((offset - SIZE_BIGRAM_BUF) / FND_BUF_BLOCK_SIZE) * FND_BUF_BLOCK_SIZE + SIZE_BIGRAM_BUF;
-	nKey = (nCurrentWiki << 24) | blocked_offset;
-	pElement = btree_search(&btree, nKey);
-	if (pElement)
+	for (nFndIdx = 0; nFndIdx < pPerWikiInfo[nCurrentWiki].nFndCount && len > 0; nFndIdx++)
 	{
-		idxFndBuf = pElement->data_entry_idx;
+		if (offset < pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx] ||
+		    offset >= pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx] + pPerWikiInfo[nCurrentWiki].lenFnd[nFndIdx])
+			continue;
+		offset_in_file = offset - pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx];
+		file_lseek(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx], offset_in_file);
+		nRead = file_read(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx], &buf[nTotal], len);
+		if (nRead <= 0)
+			break;
+		nTotal += nRead;
+		offset += nRead;
+		len -= nRead;
 	}
-	else
+	return nTotal;
+}
+
+// read the FND block starting at blocked_offset into buf
+static int read_fnd_block(unsigned long blocked_offset, unsigned char *buf)
+{
+	int len = FND_BUF_BLOCK_SIZE;
+
+	if (blocked_offset >= pPerWikiInfo[nCurrentWiki].offsetFndEnd)
+		return 0;
+	if (blocked_offset + len > pPerWikiInfo[nCurrentWiki].offsetFndEnd)
+		len = pPerWikiInfo[nCurrentWiki].offsetFndEnd - blocked_offset;
+	return read_fnd(blocked_offset, buf, len);
+}
+
+// load the restart point directory if the FND files have the versioned layout
+static void init_fnd_directory(void)
+{
+	PPER_WIKI_INFO pInfo = &pPerWikiInfo[nCurrentWiki];
+	FND_TRAILER trailer;
+	unsigned long len;
+
+	pInfo->pDirectory = NULL;
+	pInfo->nDirectoryEntries = 0;
+	pInfo->nRestartInterval = 0;
+	len = pInfo->offsetFndStart[pInfo->nFndCount - 1] + pInfo->lenFnd[pInfo->nFndCount - 1];
+	pInfo->offsetFndEnd = len;
+	if (len < SIZE_BIGRAM_BUF + sizeof(trailer) ||
+	    read_fnd(len - sizeof(trailer), (unsigned char *)&trailer, sizeof(trailer)) != sizeof(trailer) ||
+	    trailer.magic != FND_MAGIC || trailer.version != FND_VERSION ||
+	    trailer.offset_directory + trailer.nEntries * sizeof(FND_DIRECTORY_ENTRY) + sizeof(trailer) != len)
+		return;
+
+	pInfo->offsetFndEnd = trailer.offset_directory;
+	if (!trailer.nEntries || !trailer.nRestartInterval)
+		return;
+	// without the directory in memory the search falls back to resynchronising on the record pattern
+	pInfo->pDirectory = (FND_DIRECTORY_ENTRY *)memory_allocate(trailer.nEntries * sizeof(FND_DIRECTORY_ENTRY), "searchfnd3");
+	if (!pInfo->pDirectory)
+		return;
+	if (read_fnd(trailer.offset_directory, (unsigned char *)pInfo->pDirectory, trailer.nEntries * sizeof(FND_DIRECTORY_ENTRY)) !=
+	    (int)(trailer.nEntries * sizeof(FND_DIRECTORY_ENTRY)))
 	{
-		BTREE_ELEMENT element;
-		unsigned int nFndIdx;
-		idxFndBuf = nIdxFndBufFirstUsed;
-		if (pFndBuf[idxFndBuf].offset)
-		{
-			long nKeyOld = (pFndBuf[idxFndBuf].wiki_id << 24) | pFndBuf[idxFndBuf].offset;
-			btree_delete(&btree, nKeyOld);
-		}
-		for (nFndIdx = 0; nFndIdx < pPerWikiInfo[nCurrentWiki].nFndCount; nFndIdx++)
-		{
-			if (pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx] <= blocked_offset &&
-			    blocked_offset < pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx] +
-			    pPerWikiInfo[nCurrentWiki].lenFnd[nFndIdx])
-			{
-				break;
-			}
-		}
-		pFndBuf[idxFndBuf].len = 0;
-		if (nFndIdx < pPerWikiInfo[nCurrentWiki].nFndCount)
-		{
-			file_lseek(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx],
-				   blocked_offset - pPerWikiInfo[nCurrentWiki].offsetFndStart[nFndIdx]);
-			pFndBuf[idxFndBuf].len = file_read(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx],
-							   &pFndBuf[idxFndBuf].buf[0], FND_BUF_BLOCK_SIZE);
-		}
-		if (nFndIdx >= pPerWikiInfo[nCurrentWiki].nFndCount || pFndBuf[idxFndBuf].len <= 0)
-		{
-			pFndBuf[idxFndBuf].offset = 0;
-			if (idxFndBuf != nIdxFndBufFirstUsed)
-			{
-				pFndBuf[pFndBuf[idxFndBuf].prev_used_seq].next_used_seq = pFndBuf[idxFndBuf].next_used_seq;
-				if (idxFndBuf != nIdxFndBufLastUsed)
-					pFndBuf[pFndBuf[idxFndBuf].next_used_seq].prev_used_seq = pFndBuf[idxFndBuf].prev_used_seq;
-				else
-					nIdxFndBufFirstUsed = pFndBuf[idxFndBuf].prev_used_seq;
-				pFndBuf[nIdxFndBufFirstUsed].prev_used_seq = idxFndBuf;
-				pFndBuf[idxFndBuf].next_used_seq = nIdxFndBufFirstUsed;
-				nIdxFndBufFirstUsed = idxFndBuf;
-				pFndBuf[idxFndBuf].prev_used_seq = -1;
-			}
-			return 0;
-		}
-		if (pFndBuf[idxFndBuf].len < FND_BUF_BLOCK_SIZE && nFndIdx < pPerWikiInfo[nCurrentWiki].nFndCount - 1)
-		{
-			file_lseek(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx + 1], 0);
-			pFndBuf[idxFndBuf].len += file_read(pPerWikiInfo[nCurrentWiki].fdFnd[nFndIdx + 1],
-							    &pFndBuf[idxFndBuf].buf[pFndBuf[idxFndBuf].len], FND_BUF_BLOCK_SIZE - pFndBuf[idxFndBuf].len);
-		}
-		pFndBuf[idxFndBuf].offset = blocked_offset;
-		element.key = nKey;
-		element.data_entry_idx = idxFndBuf;
-		element.subtree_node_idx = BTREE_INVALID_NODE_IDX;
-		btree_insert(&btree, &element);
+		memory_free(pInfo->pDirectory, "searchfnd3");
+		pInfo->pDirectory = NULL;
+		return;
 	}
+	pInfo->nDirectoryEntries = trailer.nEntries;
+	pInfo->nRestartInterval = trailer.nRestartInterval;
+}
 
-	if (pFndBuf[idxFndBuf].prev_used_seq < 0)
+int fnd_has_directory(void)
+{
+	return pPerWikiInfo[nCurrentWiki].pDirectory != NULL;
+}
+
+// index of the last directory entry at or before offset_fnd, -1 if none
+static int find_fnd_restart_by_offset(long offset_fnd)
+{
+	FND_DIRECTORY_ENTRY *pDirectory = pPerWikiInfo[nCurrentWiki].pDirectory;
+	int lo = 0;
+	int hi = pPerWikiInfo[nCurrentWiki].nDirectoryEntries;
+	int mid;
+
+	while (lo < hi)
 	{
-		nIdxFndBufFirstUsed = pFndBuf[idxFndBuf].next_used_seq;
-		pFndBuf[nIdxFndBufFirstUsed].prev_used_seq = -1;
+		mid = lo + (hi - lo) / 2;
+		if ((long)pDirectory[mid].offset <= offset_fnd)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	else if (idxFndBuf != nIdxFndBufLastUsed)
+	return lo - 1;
+}
+
+// check if the title of the directory entry is certainly before the search string
+// a truncated key equal to the start of the search string cannot tell
+static int is_fnd_key_before(const FND_DIRECTORY_ENTRY *pEntry, const unsigned char *sSearchString, int len)
+{
+	unsigned char key[FND_DIRECTORY_KEY_LEN + 1];
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
+	int nKeyChars;
+
+	memcpy(key, pEntry->key, FND_DIRECTORY_KEY_LEN);
+	key[FND_DIRECTORY_KEY_LEN] = '\0';
+	bigram_decode(sTitleSearch, key, MAX_TITLE_SEARCH);
+	if (search_string_cmp(sTitleSearch, sSearchString, len) >= 0)
+		return 0;
+	if (ustrlen(key) < FND_DIRECTORY_KEY_LEN)
+		return 1;
+	nKeyChars = 0;
+	while (sTitleSearch[nKeyChars])
+		nKeyChars++;
+	return nKeyChars >= len || search_string_cmp(sTitleSearch, sSearchString, nKeyChars) < 0;
+}
+
+// return the offset to start the sequential search for the first title matching sSearchString
+// between offset_start (a record before the first match) and offset_end (-1 if unknown)
+long locate_fnd_restart_point(const unsigned char *sSearchString, int len, long offset_start, long offset_end)
+{
+	FND_DIRECTORY_ENTRY *pDirectory = pPerWikiInfo[nCurrentWiki].pDirectory;
+	int lo, hi, mid;
+
+	if (!pDirectory || offset_start < 0)
+		return offset_start;
+
+	lo = find_fnd_restart_by_offset(offset_start) + 1;
+	if (offset_end > 0)
+		hi = find_fnd_restart_by_offset(offset_end - 1) + 1;
+	else
+		hi = pPerWikiInfo[nCurrentWiki].nDirectoryEntries;
+	// the keys before the search string are a prefix of the entries, find the last of them
+	while (lo < hi)
 	{
-		pFndBuf[pFndBuf[idxFndBuf].prev_used_seq].next_used_seq = pFndBuf[idxFndBuf].next_used_seq;
-		pFndBuf[pFndBuf[idxFndBuf].next_used_seq].prev_used_seq = pFndBuf[idxFndBuf].prev_used_seq;
+		mid = lo + (hi - lo) / 2;
+		if (is_fnd_key_before(&pDirectory[mid], sSearchString, len))
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	if (lo > 0 && (long)pDirectory[lo - 1].offset > offset_start)
+		return pDirectory[lo - 1].offset;
+	return offset_start;
+}
+
+int copy_fnd_to_buf(long offset, unsigned char *buf, int len)
+{
+	int nCopyLen;
+	unsigned long blocked_offset;
+	unsigned char *pBlock;
+	uint32_t nBlockLen;
 
-	if (idxFndBuf != nIdxFndBufLastUsed)
+	blocked_offset = ((offset - SIZE_BIGRAM_BUF) / FND_BUF_BLOCK_SIZE) * FND_BUF_BLOCK_SIZE + SIZE_BIGRAM_BUF;
+	pBlock = block_cache_get(&fnd_cache, nCurrentWiki, blocked_offset, &nBlockLen);
+	if (!pBlock)
 	{
-		pFndBuf[idxFndBuf].prev_used_seq = nIdxFndBufLastUsed;
-		pFndBuf[idxFndBuf].next_used_seq = -1;
-		pFndBuf[nIdxFndBufLastUsed].next_used_seq = idxFndBuf;
-		nIdxFndBufLastUsed = idxFndBuf;
+		pBlock = block_cache_add(&fnd_cache, nCurrentWiki, blocked_offset);
+		nBlockLen = read_fnd_block(blocked_offset, pBlock);
+		block_cache_commit(&fnd_cache, nBlockLen);
+		if (!nBlockLen)
+			return 0;
 	}
 
-	if (len > (int)(pFndBuf[idxFndBuf].len - (offset - pFndBuf[idxFndBuf].offset))) // the buf to be copied is separated into two blocks or end of file
-		nCopyLen = pFndBuf[idxFndBuf].len - (offset - pFndBuf[idxFndBuf].offset);
+	if (len > (int)(nBlockLen - (offset - blocked_offset))) // the buf to be copied is separated into two blocks or end of file
+		nCopyLen = nBlockLen - (offset - blocked_offset);
 	else
 		nCopyLen = len;
 
 	if (nCopyLen < 0)
 		nCopyLen = 0;
 	else
-		memcpy(buf, &pFndBuf[idxFndBuf].buf[offset - pFndBuf[idxFndBuf].offset], nCopyLen);
+		memcpy(buf, &pBlock[offset - blocked_offset], nCopyLen);
 
 	if (nCopyLen > 0 && nCopyLen < len)
-		nCopyLen += copy_fnd_to_buf(pFndBuf[idxFndBuf].offset + pFndBuf[idxFndBuf].len, &buf[nCopyLen], len - nCopyLen);
+		nCopyLen += copy_fnd_to_buf(blocked_offset + nBlockLen, &buf[nCopyLen], len - nCopyLen);
 	return nCopyLen;
 }
 
+// read the FND block containing offset into the cache if it is not there yet
+// return 1 if the block has been read
+int prefetch_fnd_block(long offset)
+{
+	unsigned long blocked_offset;
+	unsigned char *pBlock;
+
+	blocked_offset = ((offset - SIZE_BIGRAM_BUF) / FND_BUF_BLOCK_SIZE) * FND_BUF_BLOCK_SIZE + SIZE_BIGRAM_BUF;
+	if (offset < SIZE_BIGRAM_BUF || block_cache_contains(&fnd_cache, nCurrentWiki, blocked_offset))
+		return 0;
+	pBlock = block_cache_add(&fnd_cache, nCurrentWiki, blocked_offset);
+	block_cache_commit(&fnd_cache, read_fnd_block(blocked_offset, pBlock));
+	return 1;
+}
+
 long locate_previous_title_search(long offset_fnd)
 {
 	long len_buf;
@@ -241,6 +321,77 @@ long locate_previous_title_search(long offset_fnd)
 	return offset_fnd + i;
 }
 
+// copy a title of a record, expanding the prefix shared with the previous title
+static void expand_fnd_title(unsigned char *sTitle, const unsigned char *sStored, int lenMax)
+{
+	int lenDuplicated;
+
+	if (sStored[0] && sStored[0] < ' ')
+	{
+		lenDuplicated = sStored[0] + 1;
+		if (lenDuplicated > (int)ustrlen(sTitle))
+			lenDuplicated = ustrlen(sTitle);
+		ustrncpy(&sTitle[lenDuplicated], &sStored[1], lenMax - lenDuplicated);
+	}
+	else
+		ustrncpy(sTitle, sStored, lenMax);
+	sTitle[lenMax - 1] = '\0';
+}
+
+// rebuild the titles of the record at offset_fnd by reading forward from its restart point
+// return 0 if offset_fnd is not the start of a record
+static int retrieve_titles_from_restart_point(long offset_fnd, unsigned char *sTitleSearchOut, unsigned char *sTitleActual)
+{
+	TITLE_SEARCH titleSearch;
+	long offset;
+	int idxRestart;
+	int len;
+	unsigned int nRecords;
+
+	if (last_fnd_title.nWikiIdx == nCurrentWiki && last_fnd_title.offset >= 0 && last_fnd_title.offset <= offset_fnd &&
+	    find_fnd_restart_by_offset(last_fnd_title.offset - 1) == find_fnd_restart_by_offset(offset_fnd))
+	{
+		offset = last_fnd_title.offset;	// continue from the last title of the same block
+	}
+	else
+	{
+		idxRestart = find_fnd_restart_by_offset(offset_fnd);
+		if (idxRestart < 0)
+			return 0;
+		offset = pPerWikiInfo[nCurrentWiki].pDirectory[idxRestart].offset;
+		last_fnd_title.nWikiIdx = nCurrentWiki;
+		last_fnd_title.sTitleSearch[0] = '\0';
+		last_fnd_title.sTitleActual[0] = '\0';
+	}
+
+	nRecords = 0;
+	for (;;)
+	{
+		len = copy_fnd_to_buf(offset, (unsigned char *)&titleSearch, sizeof(titleSearch));
+		if (len < (int)(sizeof(titleSearch.idxArticle) + sizeof(titleSearch.cZero) + 2))
+			break;
+		if (len < (int)sizeof(titleSearch))
+			memset((unsigned char *)&titleSearch + len, 0, sizeof(titleSearch) - len);
+		titleSearch.sTitleActual[MAX_TITLE_ACTUAL - 1] = '\0';
+		expand_fnd_title(last_fnd_title.sTitleSearch, titleSearch.sTitleSearch, MAX_TITLE_SEARCH);
+		expand_fnd_title(last_fnd_title.sTitleActual, &titleSearch.sTitleSearch[ustrlen(titleSearch.sTitleSearch) + 1], MAX_TITLE_ACTUAL);
+		len = sizeof(titleSearch.idxArticle) + sizeof(titleSearch.cZero) + ustrlen(titleSearch.sTitleSearch) +
+			ustrlen(&titleSearch.sTitleSearch[ustrlen(titleSearch.sTitleSearch) + 1]) + 2;
+		if (offset == offset_fnd)
+		{
+			last_fnd_title.offset = offset + len;
+			bigram_decode(sTitleSearchOut, last_fnd_title.sTitleSearch, MAX_TITLE_SEARCH);
+			ustrcpy(sTitleActual, last_fnd_title.sTitleActual);
+			return 1;
+		}
+		offset += len;
+		if (offset > offset_fnd || ++nRecords > pPerWikiInfo[nCurrentWiki].nRestartInterval)
+			break;
+	}
+	last_fnd_title.offset = -1;
+	return 0;
+}
+
 void retrieve_titles_from_fnd(long offset_fnd, unsigned char *sTitleSearchOut, unsigned char *sTitleActual)
 {
 	TITLE_SEARCH aTitleSearch[SEARCH_FND_SEQUENTIAL_SEARCH_THRESHOLD];
@@ -251,6 +402,10 @@ void retrieve_titles_from_fnd(long offset_fnd, unsigned char *sTitleSearchOut, u
 	int i;
 	int lenDuplicated;
 
+	if (pPerWikiInfo[nCurrentWiki].pDirectory &&
+	    retrieve_titles_from_restart_point(offset_fnd, sTitleSearchOut, sTitleActual))
+		return;
+
 	// Find the title that is fully spelled out.
 	// The repeated characters with the previous title at the beginning of the current title will be replace by
 	// a character whose binary value is the number of the repeated characters.
@@ -317,3 +472,206 @@ void retrieve_titles_from_fnd(long offset_fnd, unsigned char *sTitleSearchOut, u
 		}
 	}
 }
+
+// restart the decoding so that the next match appended to the ring is nMatch
+static void search_cursor_seek(PSEARCH_CURSOR pCursor, int32_t nMatch)
+{
+	PPER_WIKI_INFO pInfo = &pPerWikiInfo[nCurrentWiki];
+	int idxRestart = -1;
+
+	pCursor->nFirst = nMatch;
+	pCursor->nCount = 0;
+	pCursor->offset_decode = pCursor->offset_first;
+	pCursor->nRecordDecode = 0;
+	pCursor->sTitleSearch[0] = '\0';
+	pCursor->sTitleActual[0] = '\0';
+	if (pInfo->pDirectory)
+	{
+		if (pCursor->nRecordFirst >= 0)
+			idxRestart = (pCursor->nRecordFirst + nMatch) / pInfo->nRestartInterval;
+		else
+			idxRestart = find_fnd_restart_by_offset(pCursor->offset_first);
+	}
+	pCursor->bExpand = idxRestart >= 0;
+	if (pCursor->bExpand)
+	{
+		pCursor->offset_decode = pInfo->pDirectory[idxRestart].offset;
+		pCursor->nRecordDecode = idxRestart * pInfo->nRestartInterval;
+	}
+	else
+		pCursor->nRecordFirst = 0;
+}
+
+int search_cursor_init(PSEARCH_CURSOR pCursor, const unsigned char *sSearchString, int len, long offset_first)
+{
+	if (!pCursor->pRing)
+		pCursor->pRing = (PSEARCH_CURSOR_ENTRY)memory_allocate(sizeof(SEARCH_CURSOR_ENTRY) * SEARCH_CURSOR_RING, "searchfnd4");
+	if (!pCursor->pBuf)
+		pCursor->pBuf = (unsigned char *)memory_allocate(FND_BUF_BLOCK_SIZE, "searchfnd5");
+	if (!pCursor->pRing || !pCursor->pBuf)
+		return 0;
+
+	if (len >= MAX_TITLE_SEARCH)
+		len = MAX_TITLE_SEARCH - 1;
+	memcpy(pCursor->sSearchString, sSearchString, len);
+	pCursor->sSearchString[len] = '\0';
+	pCursor->len = len;
+	pCursor->offset_first = offset_first;
+	pCursor->offset_end = -1;
+	pCursor->nRecordFirst = -1;
+	pCursor->nPos = -1;
+	search_cursor_seek(pCursor, 0);
+	return 1;
+}
+
+// decode the records from offset_decode to the end of its FND block, appending the matches to the ring
+// a record crossing the end of the block is left to the next call, so only one block is read at a time
+// return 0 if no record could be decoded
+static int search_cursor_fill(PSEARCH_CURSOR pCursor)
+{
+	PSEARCH_CURSOR_ENTRY pEntry;
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
+	unsigned char *pRecord;
+	unsigned char *pSearch;
+	unsigned char *pActual;
+	unsigned char *pEnd;
+	int32_t nMatch;
+	int lenRequest;
+	int len;
+	int pos = 0;
+
+	if (pCursor->offset_end >= 0 && pCursor->offset_decode >= pCursor->offset_end)
+		return 0;
+	lenRequest = FND_BUF_BLOCK_SIZE - (pCursor->offset_decode - SIZE_BIGRAM_BUF) % FND_BUF_BLOCK_SIZE;
+	if (lenRequest < (int)sizeof(TITLE_SEARCH))
+		lenRequest = sizeof(TITLE_SEARCH);
+	len = copy_fnd_to_buf(pCursor->offset_decode, pCursor->pBuf, lenRequest);
+	if (len < 0)
+		len = 0;
+	pEnd = &pCursor->pBuf[len];
+	while (pos < len)
+	{
+		pRecord = &pCursor->pBuf[pos];
+		pSearch = pRecord + sizeof(uint32_t) + 1;
+		// both titles need to be terminated inside the data read
+		pActual = pSearch + 2 <= pEnd ? memchr(pSearch, '\0', pEnd - pSearch) : NULL;
+		if (pActual)
+			pActual++;
+		if (!pActual || !memchr(pActual, '\0', pEnd - pActual))
+		{
+			if (len < lenRequest || !pos)
+				pCursor->offset_end = pCursor->offset_decode;	// the end of the records
+			break;
+		}
+		if (pCursor->offset_decode > pCursor->offset_first && pCursor->nRecordFirst < 0)
+		{
+			pCursor->offset_end = pCursor->offset_decode;	// offset_first is not the start of a record
+			break;
+		}
+		if (pCursor->offset_decode == pCursor->offset_first)
+			pCursor->nRecordFirst = pCursor->nRecordDecode;
+		nMatch = pCursor->offset_decode < pCursor->offset_first ? -1 : pCursor->nRecordDecode - pCursor->nRecordFirst;
+		if (nMatch >= pCursor->nFirst && pCursor->nCount >= SEARCH_CURSOR_RING)
+		{
+			if (pCursor->nFirst >= pCursor->nPos - SEARCH_CURSOR_RING / 4)
+				break;	// the rest of the block is decoded when the ring has moved on
+			pCursor->nFirst++;
+			pCursor->nCount--;
+		}
+		if (pCursor->bExpand)
+		{
+			expand_fnd_title(pCursor->sTitleSearch, pSearch, MAX_TITLE_SEARCH);
+			expand_fnd_title(pCursor->sTitleActual, pActual, MAX_TITLE_ACTUAL);
+		}
+		if (nMatch >= pCursor->nFirst)
+		{
+			if (pCursor->bExpand)
+				bigram_decode(sTitleSearch, pCursor->sTitleSearch, MAX_TITLE_SEARCH);
+			else
+				retrieve_titles_from_fnd(pCursor->offset_decode, sTitleSearch, pCursor->sTitleActual);
+			if (search_string_cmp(sTitleSearch, pCursor->sSearchString, pCursor->len))
+			{
+				pCursor->offset_end = pCursor->offset_decode;	// passed the last match
+				break;
+			}
+			pEntry = &pCursor->pRing[nMatch % SEARCH_CURSOR_RING];
+			pEntry->offset_fnd = pCursor->offset_decode;
+			// use memcpy to avoid "Unaligned data access"
+			memcpy(&pEntry->idxArticle, pRecord, sizeof(pEntry->idxArticle));
+			ustrcpy(pEntry->sTitleActual, pCursor->sTitleActual);
+			pCursor->nCount++;
+		}
+		len = pActual + ustrlen(pActual) + 1 - pRecord;
+		pCursor->offset_decode += len;
+		pCursor->nRecordDecode++;
+		pos += len;
+	}
+	return pos > 0;
+}
+
+// move forward by up to n matches, return the number of matches moved
+int search_cursor_next(PSEARCH_CURSOR pCursor, int n)
+{
+	int nMoved = 0;
+	int32_t nAhead;
+
+	while (nMoved < n)
+	{
+		nAhead = pCursor->nFirst + pCursor->nCount - 1 - pCursor->nPos;
+		if (nAhead > n - nMoved)
+			nAhead = n - nMoved;
+		if (nAhead > 0)
+		{
+			pCursor->nPos += nAhead;
+			nMoved += nAhead;
+		}
+		else if (!search_cursor_fill(pCursor))
+			break;
+	}
+	return nMoved;
+}
+
+// move back by up to n matches, return the number of matches moved
+int search_cursor_prev(PSEARCH_CURSOR pCursor, int n)
+{
+	int32_t nTarget = pCursor->nPos - n;
+
+	if (nTarget < 0)
+		nTarget = 0;
+	if (pCursor->nPos <= nTarget)
+		return 0;
+	n = pCursor->nPos - nTarget;
+	if (nTarget < pCursor->nFirst)
+	{
+		// decode again from the restart point before the target, keeping a quarter of the ring behind it
+		search_cursor_seek(pCursor, nTarget > SEARCH_CURSOR_RING / 4 ? nTarget - SEARCH_CURSOR_RING / 4 : 0);
+		pCursor->nPos = nTarget;
+		while (pCursor->nFirst + pCursor->nCount <= nTarget && search_cursor_fill(pCursor))
+			;
+		if (pCursor->nFirst + pCursor->nCount <= nTarget)
+		{
+			n -= nTarget - (pCursor->nFirst + pCursor->nCount - 1);
+			nTarget = pCursor->nFirst + pCursor->nCount - 1;
+		}
+	}
+	pCursor->nPos = nTarget;
+	return n;
+}
+
+// the current match, NULL before the first
+PSEARCH_CURSOR_ENTRY search_cursor_entry(PSEARCH_CURSOR pCursor)
+{
+	if (pCursor->nPos < pCursor->nFirst || pCursor->nPos >= pCursor->nFirst + pCursor->nCount)
+		return NULL;
+	return &pCursor->pRing[pCursor->nPos % SEARCH_CURSOR_RING];
+}
+
+// offset (wiki.fnd) of the record after the current match
+long search_cursor_offset_next(PSEARCH_CURSOR pCursor)
+{
+	if (pCursor->nPos < pCursor->nFirst)
+		return pCursor->offset_first;
+	if (pCursor->nPos + 1 < pCursor->nFirst + pCursor->nCount)
+		return pCursor->pRing[(pCursor->nPos + 1) % SEARCH_CURSOR_RING].offset_fnd;
+	return pCursor->offset_decode;
+}
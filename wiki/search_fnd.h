@@ -20,15 +20,58 @@
 
 #include <inttypes.h>
 
+#include "search.h"
 #include "bigram.h"
+#include "block_cache.h"
 
 #define MAX_SEARCH_STRING_HASHED_LEN 15
 #define MAX_SEARCH_STRING_ALL_HASHED_LEN 5
 #define SEARCH_FND_SEQUENTIAL_SEARCH_THRESHOLD 64
+// FND_BUF_BLOCK_SIZE needs to be larger than NUMBER_OF_FIRST_PAGE_RESULTS * sizeof(TITLE_SEARCH)
+#define FND_BUF_BLOCK_SIZE 4096
+// decoded matches kept by a search cursor, a quarter of them behind the current one
+#define SEARCH_CURSOR_RING 64
+
+extern BLOCK_CACHE fnd_cache;
+
+typedef struct _SEARCH_CURSOR_ENTRY {
+	uint32_t offset_fnd;	// offset (wiki.fnd) of the record
+	uint32_t idxArticle;
+	unsigned char sTitleActual[MAX_TITLE_ACTUAL];
+} SEARCH_CURSOR_ENTRY, *PSEARCH_CURSOR_ENTRY;
+
+// Position in the titles matching a search string (a contiguous range of records).
+// The records are decoded a whole FND block at a time into a ring of matches numbered
+// from the first match, so paging either way around the current match does not touch the file.
+typedef struct _SEARCH_CURSOR {
+	unsigned char sSearchString[MAX_TITLE_SEARCH];
+	int len;
+	long offset_first;	// offset (wiki.fnd) of the first match
+	long offset_end;	// offset (wiki.fnd) of the record after the last match, -1 if not decoded yet
+	long offset_decode;	// offset (wiki.fnd) of the next record to be decoded
+	int32_t nRecordDecode;	// number of the record at offset_decode (from the restart point numbering)
+	int32_t nRecordFirst;	// number of the record at offset_first, -1 if not decoded yet
+	int32_t nFirst;		// match number of the oldest entry in the ring
+	int32_t nCount;		// entries in the ring
+	int32_t nPos;		// match number of the current entry, -1 before the first
+	int bExpand;		// decoding from a restart point, otherwise each match is rebuilt on its own
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];	// bigram encoded titles of the record before offset_decode
+	unsigned char sTitleActual[MAX_TITLE_ACTUAL];
+	PSEARCH_CURSOR_ENTRY pRing;
+	unsigned char *pBuf;
+} SEARCH_CURSOR, *PSEARCH_CURSOR;
 
 void init_search_fnd(void);
 int copy_fnd_to_buf(long offset, unsigned char *buf, int len);
+int prefetch_fnd_block(long offset);
 long get_search_offset_fnd(char *sSearchString, int len);
+int fnd_has_directory(void);
+long locate_fnd_restart_point(const unsigned char *sSearchString, int len, long offset_start, long offset_end);
 void retrieve_titles_from_fnd(long offset_fnd, unsigned char *sTitleSearch, unsigned char *sTitleActual);
+int search_cursor_init(PSEARCH_CURSOR pCursor, const unsigned char *sSearchString, int len, long offset_first);
+int search_cursor_next(PSEARCH_CURSOR pCursor, int n);
+int search_cursor_prev(PSEARCH_CURSOR pCursor, int n);
+PSEARCH_CURSOR_ENTRY search_cursor_entry(PSEARCH_CURSOR pCursor);
+long search_cursor_offset_next(PSEARCH_CURSOR pCursor);
 
 #endif
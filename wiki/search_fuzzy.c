@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Titles within one typo (substitution, insertion or deletion) of the search string.
+// A typo in the first FUZZY_KEY_LEN chars is found through the FZY index: the title prefixes
+// sharing a deletion variant with the start of the search string give the corrected strings.
+// A later typo is taken to be where the exact match stopped, the corrected strings are built
+// from the alphabet at that position. Each corrected string is then an exact prefix search.
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "ustring.h"
+#include "search.h"
+#include "bigram.h"
+#include "wikilib.h"
+#include "wiki_info.h"
+#include "search_fnd.h"
+#include "block_cache.h"
+#include "search_fuzzy.h"
+
+#define FUZZY_BUF_COUNT 16
+#define FUZZY_BUF_BLOCK_SIZE 4096
+#define FUZZY_MAX_PREFIXES 32
+#define FUZZY_MAX_JOBS (FUZZY_MAX_PREFIXES * 3 + SEARCH_CHR_COUNT * 2)
+#define FUZZY_MAX_SCAN 256	// titles read for one corrected string
+
+typedef struct _FUZZY_INFO {
+	int bInited;
+	int fd;			// -1 if the wiki has no usable FZY file
+	FUZZY_HEADER header;
+	uint32_t *pBlockIndex;
+} FUZZY_INFO, *PFUZZY_INFO;
+
+// a corrected search string, all the titles starting with it are results
+typedef struct _FUZZY_JOB {
+	unsigned char sPrefix[MAX_TITLE_SEARCH];
+	int len;
+	long offset_fnd;	// a record before the first match
+} FUZZY_JOB;
+
+static PFUZZY_INFO pFuzzyInfo;
+static BLOCK_CACHE fuzzy_cache;
+static unsigned char aIdxChar[SEARCH_CHR_COUNT];	// reverse of bigram_char_idx()
+
+static FUZZY_JOB *pFuzzyJobs;
+static int nFuzzyJobs;
+static int idxFuzzyJob;
+static long offset_fuzzy_next;	// next record of the current job, -1 to locate the first
+static int nFuzzyScanned;
+
+static int init_search_fuzzy(void)
+{
+	static int bFirstCall = 1;
+	PFUZZY_INFO pInfo;
+	uint32_t nBlocks;
+	int i;
+
+	if (bFirstCall)
+	{
+		if (block_cache_init(&fuzzy_cache, FUZZY_BUF_COUNT, FUZZY_BUF_BLOCK_SIZE, "searchfzy1"))
+			fatal_error("init_search_fuzzy malloc error");
+		pFuzzyInfo = (PFUZZY_INFO)memory_allocate(sizeof(FUZZY_INFO) * get_wiki_count(), "searchfzy2");
+		pFuzzyJobs = (FUZZY_JOB *)memory_allocate(sizeof(FUZZY_JOB) * FUZZY_MAX_JOBS, "searchfzy3");
+		if (!pFuzzyInfo || !pFuzzyJobs)
+			fatal_error("init_search_fuzzy malloc error");
+		for (i = 0; i < get_wiki_count(); i++)
+			pFuzzyInfo[i].bInited = 0;
+		init_char_idx();
+		for (i = 0; i < 128; i++)
+		{
+			if (is_supported_search_char(i) && !('A' <= i && i <= 'Z'))
+				aIdxChar[bigram_char_idx(i)] = i;
+		}
+		bFirstCall = 0;
+	}
+
+	pInfo = &pFuzzyInfo[nCurrentWiki];
+	if (!pInfo->bInited)
+	{
+		pInfo->bInited = 1;
+		pInfo->pBlockIndex = NULL;
+		pInfo->fd = file_open(get_wiki_file_path(nCurrentWiki, "wiki.fzy"), FILE_OPEN_READ);
+		if (pInfo->fd < 0)
+			return 0;
+		if (file_read(pInfo->fd, &pInfo->header, sizeof(pInfo->header)) != sizeof(pInfo->header) ||
+		    pInfo->header.magic != FUZZY_MAGIC || pInfo->header.version != FUZZY_VERSION ||
+		    pInfo->header.nKeyLen != FUZZY_KEY_LEN || pInfo->header.nCharCount != SEARCH_CHR_COUNT ||
+		    pInfo->header.nVariantsPerBlock * sizeof(FUZZY_ENTRY) != FUZZY_BUF_BLOCK_SIZE ||
+		    pInfo->header.offset_variants % FUZZY_BUF_BLOCK_SIZE || !pInfo->header.nVariants)
+		{
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+			return 0;
+		}
+		nBlocks = (pInfo->header.nVariants + pInfo->header.nVariantsPerBlock - 1) / pInfo->header.nVariantsPerBlock;
+		pInfo->pBlockIndex = (uint32_t *)memory_allocate(nBlocks * sizeof(uint32_t), "searchfzy4");
+		if (pInfo->pBlockIndex)
+		{
+			file_lseek(pInfo->fd, pInfo->header.offset_block_index);
+			if (file_read(pInfo->fd, pInfo->pBlockIndex, nBlocks * sizeof(uint32_t)) != (int)(nBlocks * sizeof(uint32_t)))
+			{
+				memory_free(pInfo->pBlockIndex, "searchfzy4");
+				pInfo->pBlockIndex = NULL;
+			}
+		}
+		if (!pInfo->pBlockIndex)
+		{
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+		}
+	}
+	return pInfo->fd >= 0;
+}
+
+static int read_fuzzy_entry(uint32_t offset, FUZZY_ENTRY *pEntry)
+{
+	uint32_t blocked_offset = offset - offset % FUZZY_BUF_BLOCK_SIZE;
+	unsigned char *pBlock;
+	uint32_t len;
+	int32_t nRead;
+
+	pBlock = block_cache_get(&fuzzy_cache, nCurrentWiki, blocked_offset, &len);
+	if (!pBlock)
+	{
+		pBlock = block_cache_add(&fuzzy_cache, nCurrentWiki, blocked_offset);
+		file_lseek(pFuzzyInfo[nCurrentWiki].fd, blocked_offset);
+		nRead = file_read(pFuzzyInfo[nCurrentWiki].fd, pBlock, FUZZY_BUF_BLOCK_SIZE);
+		len = nRead > 0 ? nRead : 0;
+		block_cache_commit(&fuzzy_cache, len);
+	}
+	if (offset - blocked_offset + sizeof(FUZZY_ENTRY) > len)
+		return 0;
+	memcpy(pEntry, &pBlock[offset - blocked_offset], sizeof(FUZZY_ENTRY));
+	return 1;
+}
+
+static uint32_t pack_fuzzy_key(const unsigned char *s, int len)
+{
+	uint32_t key = 0;
+	int i;
+
+	for (i = 0; i < FUZZY_KEY_LEN; i++)
+	{
+		key *= SEARCH_CHR_COUNT;
+		if (i < len)
+			key += bigram_char_idx(s[i]);
+	}
+	return key;
+}
+
+// return the length of the string
+static int unpack_fuzzy_key(uint32_t key, unsigned char *s)
+{
+	int len = 0;
+	int i;
+
+	for (i = FUZZY_KEY_LEN - 1; i >= 0; i--)
+	{
+		s[i] = aIdxChar[key % SEARCH_CHR_COUNT];
+		if (s[i] && !len)
+			len = i + 1;
+		key /= SEARCH_CHR_COUNT;
+	}
+	return len;
+}
+
+// add the prefixes having the variant in their deletion neighbourhood
+static void lookup_fuzzy_variant(uint32_t variant, uint32_t *pPrefixes, int *nPrefixes)
+{
+	FUZZY_HEADER *pHeader = &pFuzzyInfo[nCurrentWiki].header;
+	uint32_t *pBlockIndex = pFuzzyInfo[nCurrentWiki].pBlockIndex;
+	FUZZY_ENTRY entry;
+	uint32_t i;
+	int lo = 0;
+	int hi = (pHeader->nVariants + pHeader->nVariantsPerBlock - 1) / pHeader->nVariantsPerBlock;
+	int mid;
+	int j;
+
+	// the equal keys may start in the block before the first block starting with the variant
+	while (hi - lo > 1)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (pBlockIndex[mid] < variant)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	for (i = lo * pHeader->nVariantsPerBlock; i < pHeader->nVariants; i++)
+	{
+		if (!read_fuzzy_entry(pHeader->offset_variants + i * sizeof(FUZZY_ENTRY), &entry) || entry.key > variant)
+			break;
+		if (entry.key < variant)
+			continue;
+		for (j = 0; j < *nPrefixes && pPrefixes[j] != entry.value; j++)
+			;
+		if (j == *nPrefixes && *nPrefixes < FUZZY_MAX_PREFIXES)
+			pPrefixes[(*nPrefixes)++] = entry.value;
+	}
+}
+
+// check if a prefix of the title is within one edit of the search string
+static int is_within_one_edit(const unsigned char *sTitle, const unsigned char *sSearchString, int len)
+{
+	int i = 0;
+
+	while (i < len && sTitle[i] == sSearchString[i])
+		i++;
+	if (i >= len - 1)
+		return 1;
+	if (!search_string_cmp(&sTitle[i], &sSearchString[i + 1], len - i - 1)) // extra char typed
+		return 1;
+	if (!sTitle[i])
+		return 0;
+	return !search_string_cmp(&sTitle[i + 1], &sSearchString[i + 1], len - i - 1) || // wrong char typed
+		!search_string_cmp(&sTitle[i + 1], &sSearchString[i], len - i); // char missed
+}
+
+static void add_fuzzy_job(const unsigned char *sHead, int lenHead, const unsigned char *sTail, int lenTail,
+			  const unsigned char *sSearchString, int len, long offset_fnd)
+{
+	FUZZY_JOB *pJob;
+	int i;
+
+	if (nFuzzyJobs >= FUZZY_MAX_JOBS || lenHead + lenTail <= 0 || lenHead + lenTail >= MAX_TITLE_SEARCH)
+		return;
+	pJob = &pFuzzyJobs[nFuzzyJobs];
+	memcpy(pJob->sPrefix, sHead, lenHead);
+	memcpy(&pJob->sPrefix[lenHead], sTail, lenTail);
+	pJob->sPrefix[lenHead + lenTail] = '\0';
+	pJob->len = lenHead + lenTail;
+	// the search string itself had no match
+	if (!is_within_one_edit(pJob->sPrefix, sSearchString, len) || !search_string_cmp(pJob->sPrefix, sSearchString, len))
+		return;
+	pJob->offset_fnd = offset_fnd;
+	// the titles of a corrected string are also the titles of any shorter one it starts with
+	for (i = 0; i < nFuzzyJobs; i++)
+	{
+		if (pFuzzyJobs[i].len <= pJob->len && !memcmp(pFuzzyJobs[i].sPrefix, pJob->sPrefix, pFuzzyJobs[i].len))
+			return;
+		if (pFuzzyJobs[i].len > pJob->len && !memcmp(pFuzzyJobs[i].sPrefix, pJob->sPrefix, pJob->len))
+		{
+			if (pJob->offset_fnd > pFuzzyJobs[i].offset_fnd)
+				pJob->offset_fnd = pFuzzyJobs[i].offset_fnd;
+			pFuzzyJobs[i] = pFuzzyJobs[--nFuzzyJobs];
+			pFuzzyJobs[nFuzzyJobs] = *pJob;
+			pJob = &pFuzzyJobs[nFuzzyJobs];
+			i--;
+		}
+	}
+	nFuzzyJobs++;
+}
+
+static void normalise_title(unsigned char *sOut, const unsigned char *sTitleSearch)
+{
+	unsigned char c;
+	int len = 0;
+
+	while ((c = *sTitleSearch++) && len < MAX_TITLE_SEARCH - 1)
+	{
+		if (is_supported_search_char(c))
+			sOut[len++] = ('A' <= c && c <= 'Z') ? c + 32 : c;
+	}
+	sOut[len] = '\0';
+}
+
+// read the record at offset_fnd, return the offset of the next record or 0 at the end of the titles
+static long read_fuzzy_title(long offset_fnd, long *idxArticle, unsigned char *sTitleSearch, unsigned char *sTitleActual)
+{
+	TITLE_SEARCH titleSearch;
+	uint32_t idx;
+	int len;
+
+	if (copy_fnd_to_buf(offset_fnd, (unsigned char *)&titleSearch, sizeof(TITLE_SEARCH)) <
+	    (int)(sizeof(titleSearch.idxArticle) + sizeof(titleSearch.cZero) + 2))
+		return 0;
+	retrieve_titles_from_fnd(offset_fnd, sTitleSearch, sTitleActual);
+	memcpy(&idx, &titleSearch.idxArticle, sizeof(idx));
+	*idxArticle = idx;
+	len = ustrlen(titleSearch.sTitleSearch);
+	return offset_fnd + sizeof(titleSearch.idxArticle) + len + 2 + ustrlen(&titleSearch.sTitleSearch[len + 1]) + 1;
+}
+
+// length of the longest start of the search string that some title starts with
+static int fuzzy_exact_length(const unsigned char *sSearchString, int len)
+{
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
+	unsigned char sTitleActual[MAX_TITLE_ACTUAL];
+	unsigned char sTitle[MAX_TITLE_SEARCH];
+	long offset_fnd;
+	long idxArticle;
+	int lenMatched = 0;
+	int i;
+	int j;
+
+	// the titles around the place of the search string have the longest common start with it
+	offset_fnd = locate_fnd_restart_point(sSearchString, len, SIZE_BIGRAM_BUF, -1);
+	for (i = 0; i < FUZZY_MAX_SCAN && offset_fnd > 0; i++)
+	{
+		offset_fnd = read_fuzzy_title(offset_fnd, &idxArticle, sTitleSearch, sTitleActual);
+		if (!offset_fnd)
+			break;
+		normalise_title(sTitle, sTitleSearch);
+		for (j = 0; j < len && sTitle[j] == sSearchString[j]; j++)
+			;
+		if (j > lenMatched)
+			lenMatched = j;
+		if (search_string_cmp(sTitle, sSearchString, len) > 0)
+			break;
+	}
+	return lenMatched;
+}
+
+// prepare the corrected strings, return 0 if the wiki has no fuzzy index
+int search_fuzzy_start(const unsigned char *sSearchString, int len)
+{
+	uint32_t aPrefixes[FUZZY_MAX_PREFIXES];
+	uint32_t aVariants[FUZZY_KEY_LEN * 2 + 2];
+	unsigned char sVariant[FUZZY_KEY_LEN + 1];
+	unsigned char sPrefix[FUZZY_KEY_LEN];
+	unsigned char sCorrected[MAX_TITLE_SEARCH];
+	FUZZY_ENTRY entry;
+	int nPrefixes = 0;
+	int nVariants = 0;
+	int lenMatched;
+	int lenPrefix;
+	int lenKey;
+	int i;
+	int j;
+	int t;
+
+	nFuzzyJobs = 0;
+	idxFuzzyJob = 0;
+	offset_fuzzy_next = -1;
+	if (len < FUZZY_KEY_LEN || !fnd_has_directory() || !init_search_fuzzy())
+		return 0;
+
+	// a typo after the start covered by the index: at the first char not matching any title
+	lenMatched = fuzzy_exact_length(sSearchString, len);
+	if (lenMatched >= FUZZY_KEY_LEN)
+	{
+		// extra char typed
+		add_fuzzy_job(sSearchString, lenMatched, &sSearchString[lenMatched + 1], len - lenMatched - 1,
+			      sSearchString, len, SIZE_BIGRAM_BUF);
+		for (i = 1; i < SEARCH_CHR_COUNT; i++)
+		{
+			// wrong char typed
+			memcpy(sCorrected, sSearchString, lenMatched);
+			sCorrected[lenMatched] = aIdxChar[i];
+			add_fuzzy_job(sCorrected, lenMatched + 1, &sSearchString[lenMatched + 1], len - lenMatched - 1,
+				      sSearchString, len, SIZE_BIGRAM_BUF);
+			// char missed
+			add_fuzzy_job(sCorrected, lenMatched + 1, &sSearchString[lenMatched], len - lenMatched,
+				      sSearchString, len, SIZE_BIGRAM_BUF);
+		}
+	}
+
+	// a typo at the start: the key of the search string, its deletions and the deletions of one char more
+	aVariants[nVariants++] = pack_fuzzy_key(sSearchString, FUZZY_KEY_LEN);
+	for (lenKey = FUZZY_KEY_LEN; lenKey <= FUZZY_KEY_LEN + 1 && lenKey <= len; lenKey++)
+	{
+		for (i = 0; i < lenKey; i++)
+		{
+			memcpy(sVariant, sSearchString, i);
+			memcpy(&sVariant[i], &sSearchString[i + 1], lenKey - i - 1);
+			aVariants[nVariants] = pack_fuzzy_key(sVariant, lenKey - 1);
+			for (j = 0; j < nVariants && aVariants[j] != aVariants[nVariants]; j++)
+				;
+			if (j == nVariants)
+				nVariants++;
+		}
+	}
+	for (i = 0; i < nVariants; i++)
+		lookup_fuzzy_variant(aVariants[i], aPrefixes, &nPrefixes);
+
+	// each prefix found takes the place of the start of the search string with or without the char after
+	for (i = 0; i < nPrefixes; i++)
+	{
+		if (!read_fuzzy_entry(pFuzzyInfo[nCurrentWiki].header.offset_prefixes + aPrefixes[i] * sizeof(FUZZY_ENTRY), &entry))
+			continue;
+		lenPrefix = unpack_fuzzy_key(entry.key, sPrefix);
+		for (t = FUZZY_KEY_LEN - 1; t <= FUZZY_KEY_LEN + 1 && t <= len; t++)
+			add_fuzzy_job(sPrefix, lenPrefix, &sSearchString[t], len - t, sSearchString, len, entry.value);
+	}
+	return 1;
+}
+
+// return 1 and the next title found, 0 if there are no more, -1 if a corrected string is done without a title
+int search_fuzzy_next(long *idxArticle, unsigned char *sTitleActual)
+{
+	unsigned char sTitleSearch[MAX_TITLE_SEARCH];
+	FUZZY_JOB *pJob;
+	long offset_fnd;
+	int rc;
+
+	if (idxFuzzyJob >= nFuzzyJobs)
+		return 0;
+	pJob = &pFuzzyJobs[idxFuzzyJob];
+	if (offset_fuzzy_next < 0)
+	{
+		offset_fuzzy_next = locate_fnd_restart_point(pJob->sPrefix, pJob->len, pJob->offset_fnd, -1);
+		nFuzzyScanned = 0;
+	}
+	while (offset_fuzzy_next > 0 && nFuzzyScanned++ < FUZZY_MAX_SCAN)
+	{
+		offset_fnd = offset_fuzzy_next;
+		offset_fuzzy_next = read_fuzzy_title(offset_fnd, idxArticle, sTitleSearch, sTitleActual);
+		if (!offset_fuzzy_next)
+			break;
+		rc = search_string_cmp(sTitleSearch, pJob->sPrefix, pJob->len);
+		if (!rc)
+			return 1;
+		if (rc > 0)
+			break;
+	}
+	idxFuzzyJob++;
+	offset_fuzzy_next = -1;
+	return -1;
+}
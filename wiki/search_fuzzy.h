@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_FUZZY_H
+#define WL_SEARCH_FUZZY_H
+
+#include <inttypes.h>
+
+// FZY file (host-tools/offline-renderer/ArticleIndex.py) - symmetric delete index of the title prefixes:
+//   FUZZY_HEADER
+//   nPrefixes * [FUZZY_ENTRY] - key: the first nKeyLen chars of a search title,
+//                               value: offset (wiki.fnd) of the first title starting with them
+//   nVariants * [FUZZY_ENTRY] - key: a prefix or the prefix with one char deleted,
+//                               value: index of the prefix, sorted by key (aligned to the block size)
+//   [uint32_t] - the first key of each nVariantsPerBlock variants
+// keys are the chars packed in base SEARCH_CHR_COUNT using bigram_char_idx(), first char most significant
+// and zero for the missing chars of shorter strings
+#define FUZZY_MAGIC 0x31595a46	// "FZY1"
+#define FUZZY_VERSION 1
+#define FUZZY_KEY_LEN 4
+
+typedef struct __attribute__((packed)) _FUZZY_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nKeyLen;
+	uint32_t nCharCount;
+	uint32_t nPrefixes;
+	uint32_t offset_prefixes;
+	uint32_t nVariants;
+	uint32_t offset_variants;
+	uint32_t nVariantsPerBlock;
+	uint32_t offset_block_index;
+} FUZZY_HEADER;
+
+typedef struct __attribute__((packed)) _FUZZY_ENTRY {
+	uint32_t key;
+	uint32_t value;
+} FUZZY_ENTRY;
+
+int search_fuzzy_start(const unsigned char *sSearchString, int len);
+int search_fuzzy_next(long *idxArticle, unsigned char *sTitleActual);
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// ARTICLE_PTR records of wiki.idx read a page at a time into a block cache shared by all the
+// lookups, the neighbouring articles (e.g. the probes of random_article()) then cost no read.
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "wikilib.h"
+#include "search_idx.h"
+
+BLOCK_CACHE idx_cache;
+
+static void init_search_idx(void)
+{
+	static int bFirstCall = 1;
+
+	if (bFirstCall)
+	{
+		if (block_cache_init(&idx_cache, IDX_PAGE_COUNT, IDX_PAGE_SIZE, "searchidx1"))
+			fatal_error("init_search_idx malloc error");
+		bFirstCall = 0;
+	}
+}
+
+static uint32_t article_ptr_offset(uint32_t idx_article)
+{
+	return sizeof(uint32_t) + (idx_article - 1) * sizeof(ARTICLE_PTR);
+}
+
+// copy len bytes of wiki.idx from offset through the cache, a record may span two pages
+static int copy_idx_to_buf(int fd_idx, int nWikiIdx, uint32_t offset, unsigned char *buf, uint32_t len)
+{
+	uint32_t page_offset;
+	uint32_t nPageLen;
+	uint32_t nCopyLen;
+	unsigned char *pPage;
+	int nRead;
+
+	while (len)
+	{
+		page_offset = offset & ~(IDX_PAGE_SIZE - 1);
+		pPage = block_cache_get(&idx_cache, nWikiIdx, page_offset, &nPageLen);
+		if (!pPage)
+		{
+			pPage = block_cache_add(&idx_cache, nWikiIdx, page_offset);
+			file_lseek(fd_idx, page_offset);
+			nRead = file_read(fd_idx, pPage, IDX_PAGE_SIZE);
+			// a read that fails or stops before the record is not kept, the next lookup reads it again
+			if (nRead <= 0 || offset - page_offset >= (uint32_t)nRead)
+			{
+				block_cache_commit(&idx_cache, 0);
+				return -1;
+			}
+			nPageLen = nRead;
+			block_cache_commit(&idx_cache, nPageLen);
+		}
+		if (offset - page_offset >= nPageLen)
+			return -1;
+		nCopyLen = nPageLen - (offset - page_offset);
+		if (nCopyLen > len)
+			nCopyLen = len;
+		memcpy(buf, &pPage[offset - page_offset], nCopyLen);
+		buf += nCopyLen;
+		offset += nCopyLen;
+		len -= nCopyLen;
+	}
+	return 0;
+}
+
+// Look up n articles, the pages are read in file order whatever the order of the ids.
+// The records that cannot be read are zeroed, return the number of them.
+int search_idx_read(int fd_idx, int nWikiIdx, const uint32_t *idx_articles, ARTICLE_PTR *article_ptrs, int n)
+{
+	uint8_t order[IDX_BATCH_MAX];
+	int nFailed = 0;
+	int nBatch;
+	int i, j, k;
+
+	init_search_idx();
+	for (; n > 0; n -= nBatch, idx_articles += nBatch, article_ptrs += nBatch)
+	{
+		nBatch = n < IDX_BATCH_MAX ? n : IDX_BATCH_MAX;
+		// insertion sort by offset, the batches are short
+		for (i = 0; i < nBatch; i++)
+		{
+			for (j = i; j > 0 && idx_articles[order[j - 1]] > idx_articles[i]; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+		for (i = 0; i < nBatch; i++)
+		{
+			k = order[i];
+			if (!idx_articles[k] ||
+			    copy_idx_to_buf(fd_idx, nWikiIdx, article_ptr_offset(idx_articles[k]),
+					    (unsigned char *)&article_ptrs[k], sizeof(ARTICLE_PTR)))
+			{
+				memset(&article_ptrs[k], 0, sizeof(ARTICLE_PTR));
+				nFailed++;
+			}
+		}
+	}
+	return nFailed;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_IDX_H
+#define WL_SEARCH_IDX_H
+
+#include <inttypes.h>
+
+#include "search.h"
+#include "block_cache.h"
+
+// IDX file: uint32_t #entries, #entries * [ARTICLE_PTR], cached IDX_PAGE_SIZE aligned pages
+// (a page holds 455 records) keyed by (wiki index, offset)
+#define IDX_PAGE_SIZE 4096
+#define IDX_PAGE_COUNT 16
+#define IDX_BATCH_MAX 64	// ids sorted together by search_idx_read()
+
+extern BLOCK_CACHE idx_cache;
+
+int search_idx_read(int fd_idx, int nWikiIdx, const uint32_t *idx_articles, ARTICLE_PTR *article_ptrs, int n);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The prefix table of each wiki. A version 1 file is small enough to be read once when the wiki
+// is opened and kept for all its searches. The original layout is read a block of
+// SEARCH_CHR_COUNT^2 entries (one first char) at a time into a table shared by all the wikis.
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "bigram.h"
+#include "wikilib.h"
+#include "wiki_info.h"
+#include "search_pfx.h"
+
+#define PFX_PAIR_COUNT (SEARCH_CHR_COUNT * SEARCH_CHR_COUNT)
+#define PFX_LEGACY_BLOCK_ENTRIES (SEARCH_CHR_COUNT * SEARCH_CHR_COUNT)
+
+typedef struct _PFX_INFO {
+	int fd;
+	uint32_t nOffsets;
+	PFX_PAIR *pPairs;	// NULL for the original layout
+	uint32_t *pOffsets;
+} PFX_INFO, *PPFX_INFO;
+
+static PPFX_INFO pPfxInfo;
+
+static uint32_t *pfx_legacy_table;
+static int nPfxLegacyWiki = -1;	// the wiki the loaded blocks belong to
+static uint8_t pfx_legacy_block_loaded[SEARCH_CHR_COUNT];
+
+extern int search_interrupted;
+
+static uint32_t popcount32(uint32_t x)
+{
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0f0f0f0f;
+	return (x * 0x01010101) >> 24;
+}
+
+static int read_compact_table(PPFX_INFO pInfo, const PFX_HEADER *pHeader)
+{
+	int nPairsSize = PFX_PAIR_COUNT * sizeof(PFX_PAIR);
+	int nOffsetsSize = pHeader->nOffsets * sizeof(uint32_t);
+
+	pInfo->pPairs = (PFX_PAIR *)memory_allocate(nPairsSize, "searchpfx2");
+	pInfo->pOffsets = (uint32_t *)memory_allocate(nOffsetsSize ? nOffsetsSize : sizeof(uint32_t), "searchpfx3");
+	if (!pInfo->pPairs || !pInfo->pOffsets)
+		fatal_error("search_pfx_open malloc error");
+	pInfo->nOffsets = pHeader->nOffsets;
+
+	file_lseek(pInfo->fd, pHeader->offset_pairs);
+	if (file_read(pInfo->fd, pInfo->pPairs, nPairsSize) != nPairsSize)
+		return -1;
+	file_lseek(pInfo->fd, pHeader->offset_offsets);
+	if (nOffsetsSize && file_read(pInfo->fd, pInfo->pOffsets, nOffsetsSize) != nOffsetsSize)
+		return -1;
+	return 0;
+}
+
+void search_pfx_open(int nWikiIdx)
+{
+	static int bFirstCall = 1;
+	PPFX_INFO pInfo;
+	PFX_HEADER header;
+
+	if (bFirstCall)
+	{
+		pPfxInfo = (PPFX_INFO)memory_allocate(sizeof(PFX_INFO) * get_wiki_count(), "searchpfx1");
+		if (!pPfxInfo)
+			fatal_error("search_pfx_open malloc error");
+		bFirstCall = 0;
+	}
+
+	pInfo = &pPfxInfo[nWikiIdx];
+	pInfo->pPairs = NULL;
+	pInfo->pOffsets = NULL;
+	pInfo->nOffsets = 0;
+	pInfo->fd = file_open(get_wiki_file_path(nWikiIdx, "wiki.pfx"), FILE_OPEN_READ);
+	if (pInfo->fd < 0)
+		fatal_error("index file open error");
+
+	if (file_read(pInfo->fd, &header, sizeof(header)) == sizeof(header) &&
+	    header.magic == PFX_MAGIC && header.version == PFX_VERSION && header.nCharCount == SEARCH_CHR_COUNT)
+	{
+		if (read_compact_table(pInfo, &header))
+			fatal_error("index file read error");
+		file_close(pInfo->fd);
+		pInfo->fd = -1;
+	}
+	else if (!pfx_legacy_table)
+	{
+		pfx_legacy_table = (uint32_t *)memory_allocate(sizeof(uint32_t) * SEARCH_CHR_COUNT * PFX_LEGACY_BLOCK_ENTRIES, "searchpfx4");
+		if (!pfx_legacy_table)
+			fatal_error("search_pfx_open malloc error");
+	}
+}
+
+static uint32_t legacy_offset(int nWikiIdx, int idx_prefix_index_table)
+{
+	int idxBlock = idx_prefix_index_table / PFX_LEGACY_BLOCK_ENTRIES;
+	event_t ev;
+
+	if (nPfxLegacyWiki != nWikiIdx)
+	{
+		memset(pfx_legacy_block_loaded, 0, sizeof(pfx_legacy_block_loaded));
+		nPfxLegacyWiki = nWikiIdx;
+	}
+	if (!pfx_legacy_block_loaded[idxBlock])
+	{
+		if (event_peek(&ev) != EVENT_NONE)
+			search_interrupted = 1;
+		file_lseek(pPfxInfo[nWikiIdx].fd, idxBlock * PFX_LEGACY_BLOCK_ENTRIES * sizeof(uint32_t));
+		file_read(pPfxInfo[nWikiIdx].fd, &pfx_legacy_table[idxBlock * PFX_LEGACY_BLOCK_ENTRIES],
+			  PFX_LEGACY_BLOCK_ENTRIES * sizeof(uint32_t));
+		pfx_legacy_block_loaded[idxBlock] = 1;
+	}
+	return pfx_legacy_table[idx_prefix_index_table];
+}
+
+// offset (wiki.fnd) of the first title starting with the prefix, 0 if none
+uint32_t search_pfx_offset(int nWikiIdx, int idx_prefix_index_table)
+{
+	PPFX_INFO pInfo = &pPfxInfo[nWikiIdx];
+	PFX_PAIR *pPair;
+	int c3;
+	uint32_t word;
+	uint32_t bit;
+	uint32_t rank;
+
+	if (!pInfo->pPairs)
+		return legacy_offset(nWikiIdx, idx_prefix_index_table);
+
+	pPair = &pInfo->pPairs[idx_prefix_index_table / SEARCH_CHR_COUNT];
+	c3 = idx_prefix_index_table % SEARCH_CHR_COUNT;
+	word = pPair->bits[c3 >> 5];
+	bit = 1 << (c3 & 31);
+	if (!(word & bit))
+		return 0;
+	rank = pPair->first + popcount32(word & (bit - 1));
+	if (c3 >= 32)
+		rank += popcount32(pPair->bits[0]);
+	if (rank >= pInfo->nOffsets)
+		return 0;
+	return pInfo->pOffsets[rank];
+}
+
+// the prefixes starting with the char can be looked up without reading the file
+int search_pfx_resident(int nWikiIdx, int idxFirstChar)
+{
+	if (pPfxInfo[nWikiIdx].pPairs)
+		return 1;
+	return nPfxLegacyWiki == nWikiIdx && pfx_legacy_block_loaded[idxFirstChar];
+}
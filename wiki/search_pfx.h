@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_PFX_H
+#define WL_SEARCH_PFX_H
+
+#include <inttypes.h>
+
+// PFX file - offset (wiki.fnd) of the first title starting with each prefix of up to 3 chars,
+// indexed by c1 * SEARCH_CHR_COUNT^2 + c2 * SEARCH_CHR_COUNT + c3 using bigram_char_idx(),
+// zero for the missing chars of shorter prefixes and for the prefixes without a title.
+// The original layout is the whole table: SEARCH_CHR_COUNT^3 * [uint32_t]
+// Version 1 (host-tools/offline-renderer/ArticleIndex.py) only stores the prefixes with a title:
+//   PFX_HEADER
+//   SEARCH_CHR_COUNT^2 * [PFX_PAIR] - one for each c1, c2
+//   nOffsets * [uint32_t]           - the non-zero entries of the table in index order
+#define PFX_MAGIC 0x31584650	// "PFX1"
+#define PFX_VERSION 1
+
+typedef struct __attribute__((packed)) _PFX_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nCharCount;
+	uint32_t nOffsets;
+	uint32_t offset_pairs;
+	uint32_t offset_offsets;
+} PFX_HEADER;
+
+typedef struct __attribute__((packed)) _PFX_PAIR {
+	uint32_t bits[2];	// bit c3 is set if the prefix has a title
+	uint32_t first;		// index (offsets) of the first prefix of the pair with a title
+} PFX_PAIR;
+
+void search_pfx_open(int nWikiIdx);
+uint32_t search_pfx_offset(int nWikiIdx, int idx_prefix_index_table);
+int search_pfx_resident(int nWikiIdx, int idxFirstChar);
+
+#endif
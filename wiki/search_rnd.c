@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Uniformly random article: the rank of the article is drawn among the articles with a title,
+// a binary search of the ranks finds its superblock and the bits of that give the article number.
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "wikilib.h"
+#include "wiki_info.h"
+#include "search_rnd.h"
+
+typedef struct _RND_INFO {
+	int bInited;
+	int fd;			// -1 if the wiki has no usable RND file
+	RND_HEADER header;
+	uint32_t *pRanks;
+} RND_INFO, *PRND_INFO;
+
+static PRND_INFO pRndInfo;
+
+static int init_search_rnd(int nWikiIdx)
+{
+	static int bFirstCall = 1;
+	PRND_INFO pInfo;
+	uint32_t nSuperblocks;
+	int i;
+
+	if (bFirstCall)
+	{
+		pRndInfo = (PRND_INFO)memory_allocate(sizeof(RND_INFO) * get_wiki_count(), "searchrnd1");
+		if (!pRndInfo)
+			fatal_error("init_search_rnd malloc error");
+		for (i = 0; i < get_wiki_count(); i++)
+			pRndInfo[i].bInited = 0;
+		bFirstCall = 0;
+	}
+
+	pInfo = &pRndInfo[nWikiIdx];
+	if (!pInfo->bInited)
+	{
+		pInfo->bInited = 1;
+		pInfo->pRanks = NULL;
+		pInfo->fd = file_open(get_wiki_file_path(nWikiIdx, "wiki.rnd"), FILE_OPEN_READ);
+		if (pInfo->fd < 0)
+			return 0;
+		if (file_read(pInfo->fd, &pInfo->header, sizeof(pInfo->header)) != sizeof(pInfo->header))
+			memset(&pInfo->header, 0, sizeof(pInfo->header));
+		nSuperblocks = (pInfo->header.nArticles + RND_SUPERBLOCK_BITS - 1) / RND_SUPERBLOCK_BITS;
+		if (pInfo->header.magic != RND_MAGIC || pInfo->header.version != RND_VERSION ||
+		    pInfo->header.nSuperblockBits != RND_SUPERBLOCK_BITS || !pInfo->header.nSet ||
+		    !(pInfo->pRanks = (uint32_t *)memory_allocate(sizeof(uint32_t) * (nSuperblocks + 1), "searchrnd2")))
+		{
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+			return 0;
+		}
+		file_lseek(pInfo->fd, pInfo->header.offset_ranks);
+		if (file_read(pInfo->fd, pInfo->pRanks, sizeof(uint32_t) * (nSuperblocks + 1)) != sizeof(uint32_t) * (nSuperblocks + 1))
+		{
+			memory_free(pInfo->pRanks, "searchrnd2");
+			pInfo->pRanks = NULL;
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+		}
+	}
+	return pInfo->fd >= 0;
+}
+
+static int count_bits(uint32_t n)
+{
+	n = n - ((n >> 1) & 0x55555555);
+	n = (n & 0x33333333) + ((n >> 2) & 0x33333333);
+	return (((n + (n >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+// return -1 if the wiki has no RND file, otherwise 0 with an article picked by nRandom
+// (0 if the file is corrupt)
+int search_rnd_select(int nWikiIdx, uint32_t nRandom, uint32_t *pIdxArticle)
+{
+	PRND_INFO pInfo;
+	uint32_t words[RND_SUPERBLOCK_BITS / 32];
+	uint32_t nRank;
+	uint32_t lo, hi, mid;
+	int nBits;
+	int i, j;
+
+	if (!init_search_rnd(nWikiIdx))
+		return -1;
+	pInfo = &pRndInfo[nWikiIdx];
+	*pIdxArticle = 0;
+
+	// the article of rank nRank is in the last superblock with at most nRank articles set before it
+	nRank = nRandom % pInfo->header.nSet;
+	lo = 0;
+	hi = (pInfo->header.nArticles + RND_SUPERBLOCK_BITS - 1) / RND_SUPERBLOCK_BITS;
+	while (hi - lo > 1)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (pInfo->pRanks[mid] <= nRank)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	nRank -= pInfo->pRanks[lo];
+
+	file_lseek(pInfo->fd, pInfo->header.offset_bits + lo * sizeof(words));
+	if (file_read(pInfo->fd, words, sizeof(words)) != sizeof(words))
+		return 0;
+	for (i = 0; i < RND_SUPERBLOCK_BITS / 32; i++)
+	{
+		nBits = count_bits(words[i]);
+		if (nRank < (uint32_t)nBits)
+		{
+			for (j = 0; j < 32; j++)
+			{
+				if ((words[i] >> j) & 1 && !nRank--)
+				{
+					*pIdxArticle = lo * RND_SUPERBLOCK_BITS + i * 32 + j + 1;
+					return 0;
+				}
+			}
+		}
+		nRank -= nBits;
+	}
+	return 0;
+}
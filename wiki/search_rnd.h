@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_RND_H
+#define WL_SEARCH_RND_H
+
+#include <inttypes.h>
+
+// RND file (host-tools/offline-renderer/combine_idx.py) - the articles random_article() may pick
+// (the ones with a title in wiki.fnd) as a bitmap over the article numbers:
+//   RND_HEADER
+//   (nSuperblocks + 1) * [uint32_t] - number of the articles set before each superblock, then nSet
+//   nSuperblocks * RND_SUPERBLOCK_BITS / 32 * [uint32_t] - bit (n - 1) % 32 of word (n - 1) / 32 is article n
+// The ranks are kept in memory, so the n-th article set costs one read of its superblock.
+#define RND_MAGIC 0x31444e52	// "RND1"
+#define RND_VERSION 1
+#define RND_SUPERBLOCK_BITS 512
+
+typedef struct __attribute__((packed)) _RND_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nArticles;
+	uint32_t nSet;
+	uint32_t nSuperblockBits;
+	uint32_t offset_ranks;
+	uint32_t offset_bits;
+} RND_HEADER;
+
+int search_rnd_select(int nWikiIdx, uint32_t nRandom, uint32_t *pIdxArticle);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Exact title to article number without going through the search: one read for the displacement
+// of the bucket and one for the slot. A title that is not in the wiki lands on some slot as well,
+// the 32 bit fingerprint tells them apart.
+
+#include <grifo.h>
+
+#include "wikilib.h"
+#include "wiki_info.h"
+#include "search_ttl.h"
+
+typedef struct _TTL_INFO {
+	int bInited;
+	int fd;			// -1 if the wiki has no usable TTL file
+	TTL_HEADER header;
+} TTL_INFO, *PTTL_INFO;
+
+static PTTL_INFO pTtlInfo;
+
+static uint32_t ttl_hash(const unsigned char *s, uint32_t seed)
+{
+	uint32_t h = seed;
+
+	while (*s)
+	{
+		h ^= *s++;
+		h *= 0x01000193;
+	}
+	return h;
+}
+
+static int init_search_ttl(int nWikiIdx)
+{
+	static int bFirstCall = 1;
+	PTTL_INFO pInfo;
+	int i;
+
+	if (bFirstCall)
+	{
+		pTtlInfo = (PTTL_INFO)memory_allocate(sizeof(TTL_INFO) * get_wiki_count(), "searchttl1");
+		if (!pTtlInfo)
+			fatal_error("init_search_ttl malloc error");
+		for (i = 0; i < get_wiki_count(); i++)
+			pTtlInfo[i].bInited = 0;
+		bFirstCall = 0;
+	}
+
+	pInfo = &pTtlInfo[nWikiIdx];
+	if (!pInfo->bInited)
+	{
+		pInfo->bInited = 1;
+		pInfo->fd = file_open(get_wiki_file_path(nWikiIdx, "wiki.ttl"), FILE_OPEN_READ);
+		if (pInfo->fd < 0)
+			return 0;
+		if (file_read(pInfo->fd, &pInfo->header, sizeof(pInfo->header)) != sizeof(pInfo->header) ||
+		    pInfo->header.magic != TTL_MAGIC || pInfo->header.version != TTL_VERSION ||
+		    !pInfo->header.nBuckets || !pInfo->header.nSlots)
+		{
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+		}
+	}
+	return pInfo->fd >= 0;
+}
+
+// return -1 if the wiki has no title hash, otherwise 0 with the article number (0 if no such title)
+int search_ttl_lookup(int nWikiIdx, const unsigned char *sTitleActual, uint32_t *pIdxArticle)
+{
+	PTTL_INFO pInfo;
+	uint16_t displacement;
+	uint32_t check;
+	uint32_t slot;
+	TTL_SLOT entry;
+
+	if (!init_search_ttl(nWikiIdx))
+		return -1;
+	pInfo = &pTtlInfo[nWikiIdx];
+	*pIdxArticle = 0;
+
+	file_lseek(pInfo->fd, pInfo->header.offset_buckets +
+		   ttl_hash(sTitleActual, TTL_SEED_BUCKET) % pInfo->header.nBuckets * sizeof(displacement));
+	if (file_read(pInfo->fd, &displacement, sizeof(displacement)) != sizeof(displacement))
+		return -1;
+
+	check = ttl_hash(sTitleActual, TTL_SEED_CHECK);
+	slot = (ttl_hash(sTitleActual, TTL_SEED_SLOT) + displacement * (check | 1)) % pInfo->header.nSlots;
+	file_lseek(pInfo->fd, pInfo->header.offset_slots + slot * sizeof(TTL_SLOT));
+	if (file_read(pInfo->fd, &entry, sizeof(entry)) != sizeof(entry))
+		return -1;
+
+	if (entry.idxArticle && entry.fingerprint == check)
+		*pIdxArticle = entry.idxArticle;
+	return 0;
+}
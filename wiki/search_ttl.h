@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_TTL_H
+#define WL_SEARCH_TTL_H
+
+#include <inttypes.h>
+
+// TTL file (host-tools/offline-renderer/ArticleIndex.py) - minimal perfect hash of the actual titles
+// of wiki.fnd (utf-8, as stored in the FND records) to the article number:
+//   TTL_HEADER
+//   nBuckets * [uint16_t] - displacement of each bucket
+//   nSlots * [TTL_SLOT]   - idxArticle is zero for the unused slots
+// all hashes are FNV-1a over the title bytes with a different offset basis:
+//   bucket      = hash(TTL_SEED_BUCKET) % nBuckets
+//   slot        = (hash(TTL_SEED_SLOT) + displacement * (hash(TTL_SEED_CHECK) | 1)) % nSlots  (32 bit arithmetic)
+//   fingerprint = hash(TTL_SEED_CHECK)
+#define TTL_MAGIC 0x314c5454	// "TTL1"
+#define TTL_VERSION 1
+#define TTL_SEED_BUCKET 0x811c9dc5
+#define TTL_SEED_SLOT 0x9e3779b9
+#define TTL_SEED_CHECK 0x7f4a7c15
+
+typedef struct __attribute__((packed)) _TTL_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nTitles;
+	uint32_t nBuckets;
+	uint32_t offset_buckets;
+	uint32_t nSlots;
+	uint32_t offset_slots;
+} TTL_HEADER;
+
+typedef struct __attribute__((packed)) _TTL_SLOT {
+	uint32_t fingerprint;
+	uint32_t idxArticle;
+} TTL_SLOT;
+
+int search_ttl_lookup(int nWikiIdx, const unsigned char *sTitleActual, uint32_t *pIdxArticle);
+
+#endif
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <grifo.h>
+
+#include "bigram.h"
+#include "wikilib.h"
+#include "wiki_info.h"
+#include "block_cache.h"
+#include "search_wrd.h"
+
+#define WRD_BUF_COUNT 32
+#define WRD_BUF_BLOCK_SIZE 4096
+// the term index and the block cache together take no more than the prefix index table
+#define WRD_MEMORY_BUDGET (SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * SEARCH_CHR_COUNT * sizeof(uint32_t))
+#define WRD_MAX_TERM_INDEX_SIZE (WRD_MEMORY_BUDGET - WRD_BUF_COUNT * WRD_BUF_BLOCK_SIZE)
+
+typedef struct _WRD_INFO {
+	int bInited;
+	int fd;			// -1 if the wiki has no usable WRD file
+	WRD_HEADER header;
+} WRD_INFO, *PWRD_INFO;
+
+// position in the postings of one term
+typedef struct _WRD_CURSOR {
+	uint32_t nArticles;	// document frequency
+	uint32_t nGroups;	// 1 if there is no skip table
+	uint32_t offset_skip;
+	uint32_t offset_groups;
+	uint32_t idxNextGroup;
+	uint32_t nLeftInGroup;	// articles of the current group not read yet
+	uint32_t offset;	// next varint of the current group
+	uint32_t idxArticle;	// current article, 0 before the first and after the last
+} WRD_CURSOR;
+
+static PWRD_INFO pWrdInfo;
+static BLOCK_CACHE wrd_cache;
+static char (*wrd_term_index)[WRD_TERM_LEN];	// shared by all wikis, reloaded on wiki change
+static uint32_t nWrdTermIndexSize;		// bytes allocated, the term index of the largest wiki loaded
+static int nWrdTermIndexWiki = -1;
+
+// the block read last, most reads are sequential
+static const unsigned char *wrd_block;
+static uint32_t wrd_block_offset;
+static uint32_t wrd_block_len;
+static int nWrdBlockWiki = -1;
+
+// cursors of the current query, the rarest term first
+static WRD_CURSOR wrd_cursors[WRD_MAX_QUERY_TERMS];
+static int nWrdCursors;
+
+static int init_search_wrd(void)
+{
+	static int bFirstCall = 1;
+	PWRD_INFO pInfo;
+	int i;
+
+	if (bFirstCall)
+	{
+		pWrdInfo = (PWRD_INFO)memory_allocate(sizeof(WRD_INFO) * get_wiki_count(), "searchwrd1");
+		if (!pWrdInfo)
+			return 0;
+		for (i = 0; i < get_wiki_count(); i++)
+			pWrdInfo[i].bInited = 0;
+		bFirstCall = 0;
+	}
+
+	pInfo = &pWrdInfo[nCurrentWiki];
+	if (!pInfo->bInited)
+	{
+		pInfo->bInited = 1;
+		pInfo->fd = file_open(get_wiki_file_path(nCurrentWiki, "wiki.wrd"), FILE_OPEN_READ);
+		if (pInfo->fd < 0)
+			return 0;
+		if (file_read(pInfo->fd, &pInfo->header, sizeof(pInfo->header)) != sizeof(pInfo->header) ||
+		    pInfo->header.magic != WRD_MAGIC || pInfo->header.version != WRD_VERSION ||
+		    !pInfo->header.nTermBlocks || !pInfo->header.nPostingsPerSkip ||
+		    pInfo->header.nTermBlocks * WRD_TERM_LEN > WRD_MAX_TERM_INDEX_SIZE)
+		{
+			file_close(pInfo->fd);
+			pInfo->fd = -1;
+			return 0;
+		}
+		// the block cache is only needed once a wiki with a word index is used
+		if (!wrd_cache.bufs)
+		{
+			if (block_cache_init(&wrd_cache, WRD_BUF_COUNT, WRD_BUF_BLOCK_SIZE, "searchwrd2"))
+				fatal_error("init_search_wrd malloc error");
+		}
+	}
+	if (pInfo->fd < 0)
+		return 0;
+
+	if (nWrdTermIndexWiki != nCurrentWiki)
+	{
+		nWrdTermIndexWiki = -1;
+		// sized for the wiki opened, not WRD_MAX_TERM_INDEX_SIZE
+		if (pInfo->header.nTermBlocks * WRD_TERM_LEN > nWrdTermIndexSize)
+		{
+			if (wrd_term_index)
+				memory_free(wrd_term_index, "searchwrd3");
+			nWrdTermIndexSize = pInfo->header.nTermBlocks * WRD_TERM_LEN;
+			wrd_term_index = memory_allocate(nWrdTermIndexSize, "searchwrd3");
+			if (!wrd_term_index)
+				fatal_error("init_search_wrd malloc error");
+		}
+		file_lseek(pInfo->fd, pInfo->header.offset_term_index);
+		if (file_read(pInfo->fd, wrd_term_index, pInfo->header.nTermBlocks * WRD_TERM_LEN) !=
+		    pInfo->header.nTermBlocks * WRD_TERM_LEN)
+			return 0;
+		nWrdTermIndexWiki = nCurrentWiki;
+	}
+	return 1;
+}
+
+// return the byte at the offset of wiki.wrd, -1 past the end of file
+static int wrd_read_byte(uint32_t offset)
+{
+	uint32_t blocked_offset = offset - offset % WRD_BUF_BLOCK_SIZE;
+	unsigned char *pBlock;
+	uint32_t len;
+	int32_t nRead;
+
+	if (!wrd_block || nWrdBlockWiki != nCurrentWiki || wrd_block_offset != blocked_offset)
+	{
+		pBlock = block_cache_get(&wrd_cache, nCurrentWiki, blocked_offset, &len);
+		if (!pBlock)
+		{
+			pBlock = block_cache_add(&wrd_cache, nCurrentWiki, blocked_offset);
+			file_lseek(pWrdInfo[nCurrentWiki].fd, blocked_offset);
+			nRead = file_read(pWrdInfo[nCurrentWiki].fd, pBlock, WRD_BUF_BLOCK_SIZE);
+			len = nRead > 0 ? nRead : 0;
+			block_cache_commit(&wrd_cache, len);
+			if (!len)
+			{
+				wrd_block = NULL;
+				return -1;
+			}
+		}
+		wrd_block = pBlock;
+		wrd_block_offset = blocked_offset;
+		wrd_block_len = len;
+		nWrdBlockWiki = nCurrentWiki;
+	}
+	if (offset - blocked_offset >= wrd_block_len)
+		return -1;
+	return wrd_block[offset - blocked_offset];
+}
+
+static uint32_t wrd_read_varint(uint32_t *pOffset)
+{
+	uint32_t n = 0;
+	int shift = 0;
+	int c;
+
+	do {
+		c = wrd_read_byte((*pOffset)++);
+		if (c < 0)
+			return 0;
+		n |= (uint32_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while ((c & 0x80) && shift < 32);
+	return n;
+}
+
+static uint32_t wrd_read_uint32(uint32_t offset)
+{
+	uint32_t n = 0;
+	int i;
+
+	for (i = 3; i >= 0; i--)
+		n = (n << 8) | (wrd_read_byte(offset + i) & 0xff);
+	return n;
+}
+
+// set up the cursor for the postings of the term, return 0 if the term is not indexed
+static int wrd_find_term(const char *sTerm, WRD_CURSOR *pCursor)
+{
+	WRD_HEADER *pHeader = &pWrdInfo[nCurrentWiki].header;
+	char sEntry[WRD_TERM_LEN];
+	uint32_t offset;
+	uint32_t offset_end;
+	uint32_t offset_postings;
+	int nShared;
+	int nSuffix;
+	int lo = 0;
+	int hi = pHeader->nTermBlocks;
+	int mid;
+	int rc;
+	int i;
+
+	// the last block starting with a term not after sTerm
+	while (hi - lo > 1)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(wrd_term_index[mid], sTerm, WRD_TERM_LEN) <= 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	offset = pHeader->offset_term_blocks + lo * pHeader->nTermBlockSize;
+	offset_end = offset + pHeader->nTermBlockSize;
+	while (offset + 2 <= offset_end)
+	{
+		nShared = wrd_read_byte(offset++);
+		nSuffix = wrd_read_byte(offset++);
+		if (nShared < 0 || nSuffix <= 0 || nShared + nSuffix >= WRD_TERM_LEN)
+			return 0;
+		for (i = 0; i < nSuffix; i++)
+			sEntry[nShared + i] = wrd_read_byte(offset++);
+		sEntry[nShared + nSuffix] = '\0';
+		pCursor->nArticles = wrd_read_varint(&offset);
+		offset_postings = wrd_read_varint(&offset);
+
+		rc = strcmp(sEntry, sTerm);
+		if (rc > 0)
+			return 0;
+		if (!rc)
+		{
+			pCursor->nGroups = (pCursor->nArticles + pHeader->nPostingsPerSkip - 1) / pHeader->nPostingsPerSkip;
+			pCursor->offset_skip = offset_postings;
+			if (pCursor->nGroups > 1)
+				pCursor->offset_groups = offset_postings + pCursor->nGroups * 2 * sizeof(uint32_t);
+			else
+				pCursor->offset_groups = offset_postings;
+			pCursor->idxNextGroup = 0;
+			pCursor->nLeftInGroup = 0;
+			pCursor->idxArticle = 0;
+			return pCursor->nArticles > 0;
+		}
+	}
+	return 0;
+}
+
+static uint32_t wrd_group_first_article(WRD_CURSOR *pCursor, uint32_t idxGroup)
+{
+	return wrd_read_uint32(pCursor->offset_skip + idxGroup * 2 * sizeof(uint32_t));
+}
+
+static uint32_t wrd_cursor_open_group(WRD_CURSOR *pCursor, uint32_t idxGroup)
+{
+	uint32_t nPerGroup = pWrdInfo[nCurrentWiki].header.nPostingsPerSkip;
+
+	if (pCursor->nGroups > 1)
+	{
+		pCursor->idxArticle = wrd_group_first_article(pCursor, idxGroup);
+		pCursor->offset = pCursor->offset_groups +
+			wrd_read_uint32(pCursor->offset_skip + idxGroup * 2 * sizeof(uint32_t) + sizeof(uint32_t));
+	}
+	else
+	{
+		pCursor->offset = pCursor->offset_groups;
+		pCursor->idxArticle = wrd_read_varint(&pCursor->offset);
+	}
+	if (pCursor->nArticles - idxGroup * nPerGroup < nPerGroup)
+		pCursor->nLeftInGroup = pCursor->nArticles - idxGroup * nPerGroup - 1;
+	else
+		pCursor->nLeftInGroup = nPerGroup - 1;
+	pCursor->idxNextGroup = idxGroup + 1;
+	return pCursor->idxArticle;
+}
+
+// the next article of the postings, 0 after the last one
+static uint32_t wrd_cursor_next(WRD_CURSOR *pCursor)
+{
+	if (pCursor->nLeftInGroup)
+	{
+		pCursor->nLeftInGroup--;
+		pCursor->idxArticle += wrd_read_varint(&pCursor->offset);
+	}
+	else if (pCursor->idxNextGroup < pCursor->nGroups)
+		wrd_cursor_open_group(pCursor, pCursor->idxNextGroup);
+	else
+		pCursor->idxArticle = 0;
+	return pCursor->idxArticle;
+}
+
+// the first article not before idxTarget, 0 if there is none
+static uint32_t wrd_cursor_advance(WRD_CURSOR *pCursor, uint32_t idxTarget)
+{
+	uint32_t lo;
+	uint32_t hi;
+	uint32_t mid;
+	uint32_t step;
+
+	if (pCursor->idxArticle >= idxTarget)
+		return pCursor->idxArticle;
+
+	// gallop over the skip table to the last group starting before the target,
+	// only the articles within that group have to be decoded
+	if (pCursor->idxNextGroup < pCursor->nGroups && pCursor->nGroups > 1 &&
+	    wrd_group_first_article(pCursor, pCursor->idxNextGroup) <= idxTarget)
+	{
+		lo = pCursor->idxNextGroup;
+		step = 1;
+		while (lo + step < pCursor->nGroups && wrd_group_first_article(pCursor, lo + step) <= idxTarget)
+		{
+			lo += step;
+			step <<= 1;
+		}
+		hi = lo + step < pCursor->nGroups ? lo + step : pCursor->nGroups;
+		while (hi - lo > 1)
+		{
+			mid = lo + (hi - lo) / 2;
+			if (wrd_group_first_article(pCursor, mid) <= idxTarget)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		wrd_cursor_open_group(pCursor, lo);
+	}
+
+	while (pCursor->idxArticle < idxTarget)
+	{
+		if (!wrd_cursor_next(pCursor))
+			break;
+	}
+	return pCursor->idxArticle;
+}
+
+// start a query of the words in sQuery, return 0 if the wiki has no word index or no word is usable
+int search_wrd_start(const unsigned char *sQuery, int len)
+{
+	char sTerm[WRD_TERM_LEN];
+	WRD_CURSOR cursor;
+	int nTermLen = 0;
+	int nTerms = 0;
+	int bFound = 1;
+	int i;
+	int j;
+
+	nWrdCursors = 0;
+	if (!init_search_wrd())
+		return 0;
+
+	for (i = 0; i <= len; i++)
+	{
+		if (i < len && ((sQuery[i] >= 'a' && sQuery[i] <= 'z') || (sQuery[i] >= '0' && sQuery[i] <= '9')))
+		{
+			// words are indexed truncated to the longest term
+			if (nTermLen < WRD_TERM_LEN - 1)
+				sTerm[nTermLen++] = sQuery[i];
+			continue;
+		}
+		if (nTermLen >= WRD_MIN_TERM_LEN && nTerms < WRD_MAX_QUERY_TERMS)
+		{
+			sTerm[nTermLen] = '\0';
+			nTerms++;
+			if (bFound && wrd_find_term(sTerm, &cursor))
+			{
+				// keep the cursors sorted by the number of articles
+				for (j = nWrdCursors; j > 0 && wrd_cursors[j - 1].nArticles > cursor.nArticles; j--)
+					wrd_cursors[j] = wrd_cursors[j - 1];
+				wrd_cursors[j] = cursor;
+				nWrdCursors++;
+			}
+			else
+				bFound = 0;
+		}
+		nTermLen = 0;
+	}
+
+	if (!bFound)
+		nWrdCursors = 0;
+	return nTerms > 0;
+}
+
+// the next article (in article number order) containing all the words of the query, 0 if no more
+uint32_t search_wrd_next(void)
+{
+	uint32_t idxCandidate;
+	uint32_t idxArticle;
+	int i;
+
+	if (!nWrdCursors)
+		return 0;
+
+	// the rarest term proposes, the others confirm or move the candidate forward
+	idxCandidate = wrd_cursor_next(&wrd_cursors[0]);
+	i = 1;
+	while (idxCandidate && i < nWrdCursors)
+	{
+		idxArticle = wrd_cursor_advance(&wrd_cursors[i], idxCandidate);
+		if (idxArticle == idxCandidate)
+			i++;
+		else
+		{
+			idxCandidate = idxArticle ? wrd_cursor_advance(&wrd_cursors[0], idxArticle) : 0;
+			i = 1;
+		}
+	}
+	if (!idxCandidate)
+		nWrdCursors = 0;
+	return idxCandidate;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2010 Openmoko Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WL_SEARCH_WRD_H
+#define WL_SEARCH_WRD_H
+
+#include <inttypes.h>
+
+// a search string starting with this char is a list of words that must all be in the article text
+#define WRD_QUERY_PREFIX '?'
+
+// WRD file (host-tools/offline-renderer/combine_wrd.py):
+//   WRD_HEADER
+//   postings of each term: article numbers in ascending order
+//       df <= nPostingsPerSkip: varint first article, varint deltas...
+//       otherwise: skip table of df / nPostingsPerSkip (rounded up) * [uint32_t first article, uint32_t offset]
+//                  then the groups of nPostingsPerSkip articles as varint deltas after the first article
+//                  (offsets are relative to the end of the skip table)
+//   nTermBlocks * nTermBlockSize term blocks, sorted entries of
+//       uint8_t shared prefix length, uint8_t suffix length, suffix, varint df, varint postings offset
+//       a zero suffix length ends the block
+//   nTermBlocks * [WRD_TERM_LEN] - the first term of each block, null padded
+// varints are little endian base 128
+#define WRD_MAGIC 0x31445257	// "WRD1"
+#define WRD_VERSION 1
+#define WRD_TERM_LEN 16		// longest word + '\0'
+#define WRD_MIN_TERM_LEN 2
+#define WRD_MAX_QUERY_TERMS 8
+
+typedef struct __attribute__((packed)) _WRD_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nTerms;
+	uint32_t nTermBlocks;
+	uint32_t offset_term_blocks;
+	uint32_t nTermBlockSize;
+	uint32_t offset_term_index;
+	uint32_t nPostingsPerSkip;
+} WRD_HEADER;
+
+int search_wrd_start(const unsigned char *sQuery, int len);
+uint32_t search_wrd_next(void);
+
+#endif
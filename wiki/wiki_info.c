@@ -29,6 +29,7 @@
 #include "wiki_info.h"
 #include "search.h"
 #include "search_fnd.h"
+#include "file_pool.h"
 #include "guilib.h"
 
 WIKI_LIST wiki_list_default[] = {
@@ -760,6 +761,8 @@ void set_wiki(int idx)
 	int fd;
 
 	nCurrentWiki = idx;
+	file_pool_invalidate(nCurrentWiki);
+	retrieve_article_release();
 	reset_search_info(nCurrentWiki);
 	if (!ustrcmp(wiki_list[aActiveWikis[nCurrentWiki].WikiInfoIdx].wiki_lang, "ja"))
 		bWikiIsJapanese = true;
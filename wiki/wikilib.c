@@ -1499,6 +1499,14 @@ int wikilib_run(void)
 		if (check_invert_link()) // check if need to invert link
 			sleep = 0;
 
+		// use the idle time to read ahead the search data for the next keystroke
+		if (sleep && display_mode == DISPLAY_MODE_INDEX && search_prefetch())
+			sleep = 0;
+
+		// and the articles likely opened next from the article on the screen
+		if (sleep && display_mode == DISPLAY_MODE_ARTICLE && article_prefetch())
+			sleep = 0;
+
 		if (sleep)
 		{
 			if (time_diff(timer_get(), last_event_time) > seconds_to_ticks(5))